@@ -10,6 +10,10 @@
 #include "liborkh_clang_offload_packager.h"
 #include "liborkh_clang_offload_bundler.h"
 #include "liborkh_kernel_metadata.h"
+#include "liborkh_stats.h"
+#include "liborkh_trace.h"
+#include "liborkh_budget.h"
+#include "liborkh_parallel.h"
 
 #define LIBORKH_HIP_FATBIN_SECTION_NAME             ".hip_fatbin"
 #define LIBORKH_LLVM_OFFLOADING_FATBIN_SECTION_NAME ".llvm.offloading"
@@ -27,9 +31,26 @@ typedef struct {
 } liborkh_offload_buffer;
 
 #include "liborkh_io.h"
+#include "liborkh_archive.h"
+#include "liborkh_process.h"
+#include "liborkh_deps.h"
+#include "liborkh_snapshot.h"
+#include "liborkh_target_id.h"
+#include "liborkh_binary.h"
+#include "liborkh_shm_cache.h"
+#include "liborkh_catalog.h"
+#include "liborkh_diff.h"
+#include "liborkh_strip.h"
+#include "liborkh_kernel_descriptor.h"
+#include "liborkh_pool_index.h"
 
 liborkh_status_t liborkh_get_gpu_elfs(liborkh_offload_buffer *buf, liborkh_gpu_elf_pool_t *pool, liborkh_entry_filter_t* filter);
+liborkh_status_t liborkh_visit_gpu_elfs(liborkh_offload_buffer *buf, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data);
+liborkh_status_t liborkh_get_gpu_elf_inventory(liborkh_offload_buffer *buf, liborkh_gpu_elf_pool_t *pool, liborkh_entry_filter_t* filter);
+liborkh_status_t liborkh_visit_gpu_elf_inventory(liborkh_offload_buffer *buf, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data);
+liborkh_status_t liborkh_has_gpu_elf(liborkh_offload_buffer *buf, const liborkh_entry_filter_t* filter, bool *found);
 liborkh_status_t liborkh_extract_gpu_fatbin(Elf *elf, liborkh_offload_buffer *out);
+liborkh_status_t liborkh_get_gpu_fatbin_view(Elf *elf, liborkh_offload_buffer *out);
 
 const char* liborkh_offload_kind_to_string(offload_kind_t ofk);
 offload_kind_t liborkh_string_to_offload_kind(const char *str, const size_t len);
@@ -0,0 +1,73 @@
+#ifndef LIBORKH_ALLOC_H
+#define LIBORKH_ALLOC_H
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+
+typedef enum {
+    LIBORKH_ALLOC_STAGE_POOL = 0,
+    LIBORKH_ALLOC_STAGE_ENTRY,
+    LIBORKH_ALLOC_STAGE_ENTRY_ID,
+    LIBORKH_ALLOC_STAGE_DECOMPRESS,
+    LIBORKH_ALLOC_STAGE_FATBIN,
+    LIBORKH_ALLOC_STAGE_IMAGE,
+    LIBORKH_ALLOC_STAGE_SECTION,
+    LIBORKH_ALLOC_STAGE_NOTE,
+    LIBORKH_ALLOC_STAGE_IO,
+    LIBORKH_ALLOC_STAGE_COUNT
+} liborkh_alloc_stage_t;
+
+typedef struct {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t bytes;
+    uint64_t live_bytes;
+    uint64_t peak_bytes;
+} liborkh_alloc_counter_t;
+
+typedef struct {
+    liborkh_alloc_counter_t total;
+    liborkh_alloc_counter_t stages[LIBORKH_ALLOC_STAGE_COUNT];
+} liborkh_alloc_profile_t;
+
+/*
+ * Allocation wrappers used by every allocation site of the library.
+ * Configure with -DLIBORKH_ALLOC_PROFILING=ON to route them through the
+ * profiler, otherwise they expand to the plain libc calls.
+ */
+#ifdef LIBORKH_ALLOC_PROFILING
+#define liborkh_malloc(stage, size)       __liborkh_prof_malloc(stage, size, __FILE__, __func__, __LINE__)
+#define liborkh_calloc(stage, n, size)    __liborkh_prof_calloc(stage, n, size, __FILE__, __func__, __LINE__)
+#define liborkh_realloc(stage, ptr, size) __liborkh_prof_realloc(stage, ptr, size, __FILE__, __func__, __LINE__)
+#define liborkh_strdup(stage, str)        __liborkh_prof_strdup(stage, str, __FILE__, __func__, __LINE__)
+#define liborkh_free(ptr)                 __liborkh_prof_free(ptr)
+#else
+#define liborkh_malloc(stage, size)       malloc(size)
+#define liborkh_calloc(stage, n, size)    calloc(n, size)
+#define liborkh_realloc(stage, ptr, size) realloc(ptr, size)
+#define liborkh_strdup(stage, str)        strdup(str)
+#define liborkh_free(ptr)                 free(ptr)
+#endif
+
+void* __liborkh_prof_malloc(liborkh_alloc_stage_t stage, size_t size, const char* file, const char* func, int line);
+void* __liborkh_prof_calloc(liborkh_alloc_stage_t stage, size_t n, size_t size, const char* file, const char* func, int line);
+void* __liborkh_prof_realloc(liborkh_alloc_stage_t stage, void* ptr, size_t size, const char* file, const char* func, int line);
+char* __liborkh_prof_strdup(liborkh_alloc_stage_t stage, const char* str, const char* file, const char* func, int line);
+void  __liborkh_prof_free(void* ptr);
+
+/**
+ * Release a buffer handed out by liborkh (fatbin copy, metadata, names...).
+ * Equivalent to free() but keeps the profiler's live bytes accurate.
+ */
+void liborkh_alloc_free(void* ptr);
+
+bool liborkh_alloc_profile_enabled(void);
+void liborkh_alloc_profile_reset(void);
+void liborkh_alloc_profile_get(liborkh_alloc_profile_t* out);
+void liborkh_alloc_profile_print(FILE* out, const char* label, bool with_sites);
+const char* liborkh_alloc_stage_to_string(liborkh_alloc_stage_t stage);
+
+#endif // LIBORKH_ALLOC_H
@@ -0,0 +1,40 @@
+#ifndef LIBORKH_ARCHIVE_H
+#define LIBORKH_ARCHIVE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+#define LIBORKH_AR_MAGIC            "!<arch>\n"
+#define LIBORKH_AR_MAGIC_SIZE       (sizeof(LIBORKH_AR_MAGIC) - 1)
+#define LIBORKH_AR_HEADER_SIZE      60
+
+typedef struct {
+    char* name;
+    size_t offset; // offset of the member data in the archive
+    size_t size;
+} liborkh_archive_member_t;
+
+// Static archive (.a) mapped in memory, members are listed from the ar headers
+typedef struct {
+    uint8_t* map;
+    size_t size;
+    size_t count;
+    liborkh_archive_member_t* members;
+} liborkh_archive_t;
+
+bool             liborkh_is_archive_file(const char* filename);
+liborkh_status_t liborkh_archive_open(const char* filename, liborkh_archive_t** archive);
+liborkh_status_t liborkh_archive_close(liborkh_archive_t* archive);
+
+/*
+ * Decode the offload sections of every ELF member, using num_threads workers
+ * (0 = one per online CPU). Entries are appended to the pool in member order
+ * and tagged with member_name / member_offset. Members without offload section
+ * are skipped; the first member failing to decode fails the call.
+ */
+liborkh_status_t liborkh_get_gpu_elfs_from_archive(const liborkh_archive_t* archive, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter, size_t num_threads);
+
+#endif // LIBORKH_ARCHIVE_H
@@ -0,0 +1,75 @@
+#ifndef LIBORKH_BINARY_H
+#define LIBORKH_BINARY_H
+
+#include <stdint.h>
+#include <pthread.h>
+
+#include "liborkh_utils.h"
+#include "liborkh.h"
+
+// Results derived from one entry, computed on first query
+typedef struct {
+    uint32_t state;           // 0 = not computed yet, 1 = computed (read with acquire semantics)
+    liborkh_status_t status;
+    size_t metadata_offset;   // msgpack metadata (AMDGPU note descriptor) in the image
+    size_t metadata_size;
+    size_t num_kernels;
+} liborkh_binary_entry_info_t;
+
+// Entries of one bundle, decoded on first lookup
+typedef struct {
+    uint32_t state;           // 0 = not decoded yet, 1 = decoded (read with acquire semantics)
+    liborkh_status_t status;
+    liborkh_gpu_elf_pool_t* pool;
+} liborkh_binary_bundle_t;
+
+/*
+ * "Open once, query many" handle on a host binary: the file stays mapped by
+ * libelf, the offload section is decoded once into `pool` (images of plain
+ * bundles and packager blobs are views of the mapping) and per-entry results
+ * are memoized. Queries may be issued concurrently from any number of threads.
+ */
+typedef struct {
+    char* path;
+    Elf* elf;
+    liborkh_offload_buffer fatbin;  // view of the offload section in the mapping
+    liborkh_elf_section_table_t* sections;
+    liborkh_gpu_elf_pool_t* pool;
+    liborkh_binary_entry_info_t* infos;
+    uint32_t total_state;
+    size_t total_kernels;
+    uint32_t index_state;
+    liborkh_status_t index_status;
+    liborkh_bundle_index_t* index;  // bundle offsets of a .hip_fatbin section
+    liborkh_binary_bundle_t* bundles;
+    pthread_mutex_t lock;
+} liborkh_binary_t;
+
+liborkh_status_t liborkh_binary_open(const char* filename, liborkh_entry_filter_t* filter, liborkh_binary_t** binary);
+/*
+ * Open a binary without decoding its offload section: only the bundle index
+ * is built, in one pass, and entries are reached with
+ * liborkh_binary_get_bundle_entry(). The pool of the handle stays empty unless
+ * the section is a packager section, which is then decoded as by
+ * liborkh_binary_open().
+ */
+liborkh_status_t liborkh_binary_open_indexed(const char* filename, liborkh_binary_t** binary);
+liborkh_status_t liborkh_binary_close(liborkh_binary_t* binary);
+
+size_t           liborkh_binary_get_number_entries(const liborkh_binary_t* binary);
+liborkh_status_t liborkh_binary_get_entry(liborkh_binary_t* binary, size_t index, const liborkh_gpu_elf_entry_t** entry);
+liborkh_status_t liborkh_binary_get_metadata(liborkh_binary_t* binary, size_t index, const uint8_t** metadata, size_t* size);
+liborkh_status_t liborkh_binary_get_number_kernels(liborkh_binary_t* binary, size_t index, size_t* num_kernels);
+liborkh_status_t liborkh_binary_get_total_number_kernels(liborkh_binary_t* binary, size_t* num_kernels);
+
+// Zero-copy view of a section of the host binary, looked up in the section table of the handle
+liborkh_status_t liborkh_binary_get_section(liborkh_binary_t* binary, const char* name, const uint8_t** data, size_t* size);
+
+/*
+ * Entry of bundle `bundle_id` (the <id> of the extract_gpu_elf file names) for
+ * an architecture, NULL for the first device entry. Only that bundle is decoded,
+ * once; `entry` is NULL when the bundle has no such entry.
+ */
+liborkh_status_t liborkh_binary_get_bundle_entry(liborkh_binary_t* binary, size_t bundle_id, const char* arch, const liborkh_gpu_elf_entry_t** entry);
+
+#endif // LIBORKH_BINARY_H
@@ -0,0 +1,48 @@
+#ifndef LIBORKH_BUDGET_H
+#define LIBORKH_BUDGET_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <pthread.h>
+
+#include "liborkh_utils.h"
+
+#define LIBORKH_BUDGET_ENV                     "LIBORKH_MEMORY_BUDGET"
+#define LIBORKH_BUDGET_SPILL_DIR_ENV           "LIBORKH_SPILL_DIR"
+#define LIBORKH_BUDGET_DEFAULT_SPILL_THRESHOLD (1UL << 20)
+#define LIBORKH_BUDGET_DEFAULT_WAIT_MS         200
+
+typedef struct {
+    size_t limit;            // heap bytes allowed for decompressed bundles and images, 0 = unlimited
+    size_t spill_threshold;  // buffers at least this large are spilled right away when over budget
+    uint32_t wait_ms;        // how long a smaller buffer waits for other workers to release memory
+    const char* spill_dir;   // directory of the temporary files, NULL = $LIBORKH_SPILL_DIR, $TMPDIR or /tmp
+    size_t used;             // accounted heap bytes
+    size_t transient;        // part of used held by in-flight decompressions
+    size_t peak;
+    size_t num_spilled;
+    size_t spilled_bytes;
+    pthread_mutex_t lock;
+    pthread_cond_t released;
+} liborkh_budget_t;
+
+/*
+ * Memory budget of decode calls. Decompressed bundles and entry images are
+ * accounted to the budget bound to the calling thread (worker threads of the
+ * library inherit the caller's), or to the process budget set through the
+ * LIBORKH_MEMORY_BUDGET=<bytes>[K|M|G] environment variable.
+ * When a buffer does not fit, it waits for in-flight decompressions of other
+ * threads to complete (backpressure) or is placed in an unlinked temporary
+ * file (O_TMPFILE) mapped in memory, whose pages the kernel can write back.
+ * A budget must outlive the buffers accounted to it.
+ */
+liborkh_status_t liborkh_budget_init(liborkh_budget_t* budget, size_t limit);
+liborkh_status_t liborkh_budget_destroy(liborkh_budget_t* budget);
+void             liborkh_budget_bind(liborkh_budget_t* budget);
+liborkh_budget_t* liborkh_budget_current(void);
+
+void* liborkh_budget_alloc(liborkh_alloc_stage_t stage, size_t size);
+void  liborkh_budget_free(void* ptr);
+bool  liborkh_budget_is_spilled(const void* ptr);
+
+#endif // LIBORKH_BUDGET_H
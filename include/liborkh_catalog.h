@@ -0,0 +1,110 @@
+#ifndef LIBORKH_CATALOG_H
+#define LIBORKH_CATALOG_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+// Numeric columns, values of the AMDGPU kernel metadata
+typedef enum {
+    LIBORKH_CATALOG_SGPR = 0,        // .sgpr_count
+    LIBORKH_CATALOG_VGPR,            // .vgpr_count
+    LIBORKH_CATALOG_AGPR,            // .agpr_count
+    LIBORKH_CATALOG_LDS,             // .group_segment_fixed_size
+    LIBORKH_CATALOG_SCRATCH,         // .private_segment_fixed_size
+    LIBORKH_CATALOG_KERNARG,         // .kernarg_segment_size
+    LIBORKH_CATALOG_WAVEFRONT,       // .wavefront_size
+    LIBORKH_CATALOG_COLUMN_COUNT
+} liborkh_catalog_column_t;
+
+// Dictionary encoded columns, rows hold a code into the dictionary
+typedef enum {
+    LIBORKH_CATALOG_ARCH = 0,        // target architecture of the code object
+    LIBORKH_CATALOG_SOURCE,          // file or archive member the kernel comes from
+    LIBORKH_CATALOG_DICT_COUNT
+} liborkh_catalog_dict_t;
+
+typedef enum {
+    LIBORKH_CATALOG_EQ = 0,
+    LIBORKH_CATALOG_NE,
+    LIBORKH_CATALOG_LT,
+    LIBORKH_CATALOG_LE,
+    LIBORKH_CATALOG_GT,
+    LIBORKH_CATALOG_GE
+} liborkh_catalog_op_t;
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    char** values;
+} liborkh_catalog_dictionary_t;
+
+/*
+ * Kernels stored column by column: one array per attribute, row i of every
+ * array describes the same kernel. Names live in a single string arena.
+ */
+typedef struct {
+    size_t count;
+    size_t capacity;
+    uint32_t* name;                                    // offsets into names
+    uint64_t* entry_id;
+    uint32_t* codes[LIBORKH_CATALOG_DICT_COUNT];
+    uint32_t* columns[LIBORKH_CATALOG_COLUMN_COUNT];
+    liborkh_catalog_dictionary_t dicts[LIBORKH_CATALOG_DICT_COUNT];
+    char* names;
+    size_t names_size;
+    size_t names_capacity;
+} liborkh_catalog_t;
+
+typedef struct {
+    size_t count;
+    uint64_t sum;
+    uint32_t min;
+    uint32_t max;
+} liborkh_catalog_group_t;
+
+liborkh_status_t liborkh_catalog_init(liborkh_catalog_t** catalog);
+liborkh_status_t liborkh_catalog_free(liborkh_catalog_t* catalog);
+
+/*
+ * Parse the metadata of every code object of the pool and append its kernels.
+ * @param source Source label of the rows, NULL to use the archive member name
+ */
+liborkh_status_t liborkh_catalog_add_pool(liborkh_catalog_t* catalog, const liborkh_gpu_elf_pool_t* pool, const char* source);
+liborkh_status_t liborkh_catalog_add_file(liborkh_catalog_t* catalog, const char* filename, liborkh_entry_filter_t* filter);
+
+static inline const char* liborkh_catalog_get_name(const liborkh_catalog_t* catalog, size_t row) {
+    return catalog->names + catalog->name[row];
+}
+
+static inline const char* liborkh_catalog_get_string(const liborkh_catalog_t* catalog, liborkh_catalog_dict_t dict, size_t row) {
+    return catalog->dicts[dict].values[catalog->codes[dict][row]];
+}
+
+const char* liborkh_catalog_column_to_string(liborkh_catalog_column_t column);
+
+/*
+ * Query primitives. A mask holds one byte per row (1 = selected); filters
+ * clear the rows that do not match, so successive calls combine with AND.
+ * A NULL mask selects every row.
+ */
+liborkh_status_t liborkh_catalog_mask_init(const liborkh_catalog_t* catalog, uint8_t** mask);
+liborkh_status_t liborkh_catalog_filter(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, liborkh_catalog_op_t op, uint32_t value, uint8_t* mask);
+liborkh_status_t liborkh_catalog_filter_string(const liborkh_catalog_t* catalog, liborkh_catalog_dict_t dict, const char* value, uint8_t* mask);
+
+/*
+ * Aggregate a column per dictionary value; groups has one slot per value of
+ * the dictionary (catalog->dicts[dict].count).
+ */
+liborkh_status_t liborkh_catalog_group_by(const liborkh_catalog_t* catalog, liborkh_catalog_dict_t dict, liborkh_catalog_column_t column, const uint8_t* mask, liborkh_catalog_group_t* groups);
+
+// Rows of the k largest values of a column, largest first (ties by row order)
+liborkh_status_t liborkh_catalog_top_k(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, const uint8_t* mask, size_t k, size_t* rows, size_t* num_rows);
+
+// Distribution of a column in power of two buckets: bucket b counts values in [2^(b-1), 2^b), bucket 0 counts zeros
+#define LIBORKH_CATALOG_HISTOGRAM_SIZE 33
+liborkh_status_t liborkh_catalog_histogram(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, const uint8_t* mask, uint64_t buckets[LIBORKH_CATALOG_HISTOGRAM_SIZE]);
+
+#endif // LIBORKH_CATALOG_H
@@ -2,6 +2,7 @@
 #define LIBORKH_CLANG_OFFLOAD_BUNDLER_H
 
 #include <stdint.h>
+#include <stdbool.h>
 #include "liborkh_utils.h"
 #include "liborkh_gpu_elf_pool.h"
 
@@ -11,6 +12,12 @@
 #define COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC "CCOB"
 #define COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE sizeof(COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC) - 1
 
+typedef enum {
+    CCOB_COMPRESSION_ZLIB = 0,
+    CCOB_COMPRESSION_ZSTD = 1,
+    CCOB_COMPRESSION_COUNT
+} liborkh_ccob_compression_t;
+
 typedef struct {
     uint16_t version;
     uint16_t compression_type;
@@ -20,6 +27,33 @@ typedef struct {
     uint8_t *uncompressed_data;
 } liborkh_compressed_bundle_entry_t;
 
+// Location of one bundle of an offload section, found without decompressing it
+typedef struct {
+    size_t offset;          // bundle, or CCOB header, in the offload buffer
+    size_t size;            // bytes the scan steps over to reach the next bundle
+    size_t table_offset;    // entry table of a plain bundle, compressed payload of a CCOB
+    uint64_t num_entries;   // entries of a plain bundle, 0 for a CCOB (table is compressed)
+    bool compressed;
+} liborkh_bundle_index_item_t;
+
+/*
+ * Offsets of the bundles of an offload section: item i is the bundle whose
+ * entries get id i when the section is decoded.
+ */
+typedef struct {
+    size_t count;
+    size_t capacity;
+    liborkh_bundle_index_item_t* items;
+} liborkh_bundle_index_t;
+
+liborkh_status_t __liborkh_visit_clang_offload_bundler(const uint8_t *buf, const size_t size, __liborkh_visit_ctx_t* ctx);
+liborkh_status_t liborkh_visit_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data);
 liborkh_status_t liborkh_decode_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter);
 
+
+liborkh_status_t liborkh_bundle_index_build(const uint8_t *buf, const size_t size, liborkh_bundle_index_t** index);
+liborkh_status_t liborkh_bundle_index_free(liborkh_bundle_index_t* index);
+liborkh_status_t liborkh_bundle_index_visit(const uint8_t *buf, const size_t size, const liborkh_bundle_index_t* index, size_t bundle_id, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data);
+liborkh_status_t liborkh_bundle_index_decode(const uint8_t *buf, const size_t size, const liborkh_bundle_index_t* index, size_t bundle_id, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter);
+
 #endif // LIBORKH_CLANG_OFFLOAD_BUNDLER_H
\ No newline at end of file
@@ -32,6 +32,8 @@ typedef struct __attribute__((packed)) {
 } __liborkh_offload_string_entry_t;
 
 
+liborkh_status_t __liborkh_visit_clang_offload_packager(const uint8_t *buf, const size_t size, __liborkh_visit_ctx_t* ctx);
+liborkh_status_t liborkh_visit_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data);
 liborkh_status_t liborkh_decode_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter);
 
 #endif // LIBORKH_CLANG_OFFLOAD_PACKAGER_H
\ No newline at end of file
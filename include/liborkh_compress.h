@@ -0,0 +1,46 @@
+#ifndef LIBORKH_COMPRESS_H
+#define LIBORKH_COMPRESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_clang_offload_bundler.h"
+
+#define LIBORKH_CCOB_HEADER_SIZE_V2 24
+#define LIBORKH_CCOB_HEADER_SIZE_V3 32
+
+#define LIBORKH_CCOB_DEFAULT_ZLIB_LEVEL 9
+#define LIBORKH_CCOB_DEFAULT_ZSTD_LEVEL 19
+
+typedef struct {
+    liborkh_ccob_compression_t codec;
+    uint16_t version;            // 2 or 3, version 2 is promoted to 3 when sizes exceed 32 bits
+    int level;                   // 0 for the codec default used by liborkh
+    int num_threads;             // zstd workers, 0 compresses on the calling thread
+    bool long_distance;          // zstd long distance matching
+} liborkh_ccob_options_t;
+
+/*
+ * Compress an uncompressed bundle into a CCOB blob (header + payload).
+ * The header hash is the truncated MD5 of the uncompressed bundle, as clang
+ * does, unless `hash` is given (e.g. the hash of the bundle being transcoded).
+ */
+liborkh_status_t liborkh_ccob_compress_ex(const liborkh_ccob_options_t* options, const uint8_t* data, size_t size, const uint64_t* hash, uint8_t** out, size_t* out_size);
+liborkh_status_t liborkh_ccob_compress(liborkh_ccob_compression_t codec, uint16_t version, int level, const uint8_t* data, size_t size, uint8_t** out, size_t* out_size);
+
+uint64_t liborkh_md5_low64(const uint8_t* data, size_t size);
+
+// Outcome of recompressing the CCOB bundles of an offload section
+typedef struct {
+    size_t num_transcoded;
+    size_t num_kept;      // recompressed bundle larger than its slot
+    size_t old_bytes;     // compressed bundle bytes before and after
+    size_t new_bytes;
+    size_t old_size;      // section size before and after
+    size_t new_size;
+} liborkh_transcode_result_t;
+
+liborkh_status_t liborkh_transcode_clang_offload_bundler(const uint8_t *buf, const size_t size, const liborkh_ccob_options_t* options, uint8_t* out, liborkh_transcode_result_t* result);
+
+#endif // LIBORKH_COMPRESS_H
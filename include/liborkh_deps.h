@@ -0,0 +1,43 @@
+#ifndef LIBORKH_DEPS_H
+#define LIBORKH_DEPS_H
+
+#include <stdint.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+typedef struct {
+    char* name;           // DT_NEEDED name, file name for the executable
+    char* path;           // resolved path, NULL when the library was not found
+    uint64_t dev;
+    uint64_t inode;
+    size_t first_entry;   // entries of this library in the program pool
+    size_t num_entries;
+    size_t num_kernels;
+    liborkh_status_t status;
+} liborkh_program_library_t;
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    liborkh_program_library_t* libraries; // executable first, then libraries in breadth-first load order
+    liborkh_gpu_elf_pool_t* pool;          // aggregated inventory, entries carry no image
+    size_t num_kernels;
+} liborkh_program_t;
+
+/*
+ * Resolve the DT_NEEDED closure of an executable the way the dynamic loader
+ * does: DT_RPATH (when there is no DT_RUNPATH), LD_LIBRARY_PATH, DT_RUNPATH,
+ * /etc/ld.so.conf directories and default paths, with $ORIGIN and $LIB
+ * expansion. Libraries are deduplicated by (dev, inode).
+ */
+liborkh_status_t liborkh_program_open(const char* filename, liborkh_program_t** program);
+
+/*
+ * Decode the offload sections of every library (num_threads workers, 0 = one
+ * per online CPU) into program->pool and count their kernels.
+ */
+liborkh_status_t liborkh_program_scan(liborkh_program_t* program, liborkh_entry_filter_t* filter, size_t num_threads);
+liborkh_status_t liborkh_program_close(liborkh_program_t* program);
+
+#endif // LIBORKH_DEPS_H
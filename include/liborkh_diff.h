@@ -0,0 +1,48 @@
+#ifndef LIBORKH_DIFF_H
+#define LIBORKH_DIFF_H
+
+#include <stdint.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+typedef enum {
+    LIBORKH_DIFF_ADDED = 0,
+    LIBORKH_DIFF_REMOVED,
+    LIBORKH_DIFF_CHANGED
+} liborkh_diff_kind_t;
+
+/*
+ * One difference, keyed by (ofk, triple, arch, kernel). kernel is NULL for a
+ * code object record. Entries sharing the same key are paired in order.
+ */
+typedef struct {
+    liborkh_diff_kind_t kind;
+    offload_kind_t ofk;
+    char* target_triple;
+    char* target_arch;
+    char* kernel;
+    size_t old_id;                   // entry ids, SIZE_MAX on the missing side
+    size_t new_id;
+} liborkh_diff_record_t;
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    liborkh_diff_record_t* records;  // code object record first, then its kernels
+    size_t num_unchanged_entries;    // skipped on hash equality
+    size_t num_unchanged_kernels;    // in changed entries
+} liborkh_diff_t;
+
+/*
+ * Compare the device code of two pools. Code objects are compared by content
+ * hash only; the kernels of changed objects are compared by the hash of their
+ * .text range (function symbols with a <name>.kd descriptor).
+ */
+liborkh_status_t liborkh_diff_pools(liborkh_gpu_elf_pool_t* old_pool, liborkh_gpu_elf_pool_t* new_pool, liborkh_diff_t** diff);
+liborkh_status_t liborkh_diff_files(const char* old_filename, const char* new_filename, liborkh_entry_filter_t* filter, liborkh_diff_t** diff);
+liborkh_status_t liborkh_diff_free(liborkh_diff_t* diff);
+
+const char* liborkh_diff_kind_to_string(liborkh_diff_kind_t kind);
+
+#endif // LIBORKH_DIFF_H
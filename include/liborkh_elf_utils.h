@@ -15,11 +15,43 @@ typedef struct {
     uint8_t* desc;
 } elf_note_t;
 
+typedef struct {
+    const char* name;     // points into the section header string table of the ELF
+    uint32_t hash;
+    uint32_t type;
+    uint64_t flags;
+    uint64_t addr;
+    uint64_t offset;
+    uint64_t size;
+    size_t index;         // section header index
+    Elf_Scn* scn;
+} liborkh_elf_section_t;
+
+/*
+ * Section headers of one ELF read once, with a name hash table for lookups.
+ * Valid as long as the ELF is open.
+ */
+typedef struct {
+    Elf* elf;
+    size_t count;
+    liborkh_elf_section_t* sections;   // section header order, without the null section
+    uint32_t* buckets;                 // index + 1 into sections, 0 = empty slot
+    size_t num_buckets;                // power of two
+} liborkh_elf_section_table_t;
 
+
+liborkh_status_t liborkh_elf_init(void);
 liborkh_status_t liborkh_open_elf(const char* filename, Elf **elf);
 liborkh_status_t liborkh_open_elf_from_memory(const uint8_t* buf, size_t size, Elf **elf);
 liborkh_status_t liborkh_close_elf(Elf *elf);
 liborkh_status_t liborkh_get_note_data(Elf *elf, elf_note_t* out);
+liborkh_status_t liborkh_get_section_view(Elf *elf, const char* section_name, const uint8_t** out_data, size_t* out_size);
 liborkh_status_t liborkh_extract_section_data(Elf *elf, const char* section_name, uint8_t** out_data, size_t* out_size);
 
+
+liborkh_status_t liborkh_elf_section_table_build(Elf *elf, liborkh_elf_section_table_t** table);
+liborkh_status_t liborkh_elf_section_table_free(liborkh_elf_section_table_t* table);
+const liborkh_elf_section_t* liborkh_elf_section_table_find(const liborkh_elf_section_table_t* table, const char* name);
+liborkh_status_t liborkh_elf_section_table_get_data(const liborkh_elf_section_table_t* table, const char* name, const uint8_t** out_data, size_t* out_size);
+
 #endif // LIBORKH_ELF_UTILS_H
\ No newline at end of file
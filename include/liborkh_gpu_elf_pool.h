@@ -12,6 +12,42 @@ typedef struct {
 
 typedef liborkh_status_t (*liborkh_gpu_elf_pool_iterate_cb_t)(liborkh_gpu_elf_entry_t *entry, void *user_data);
 
+/*
+ * Streaming decode: the visitor is called for each matching entry while the
+ * offload buffer is being decoded. The entry's image is a borrowed view that
+ * is only valid during the call.
+ *  - LIBORKH_VISIT_TAKE: the visitor keeps the entry (free it with liborkh_free_entry),
+ *                        its image is copied into memory owned by the entry
+ *  - LIBORKH_VISIT_SKIP: the entry is released, decoding continues
+ *  - LIBORKH_VISIT_STOP: the entry is released, decoding stops
+ */
+typedef enum {
+    LIBORKH_VISIT_TAKE = 0,
+    LIBORKH_VISIT_SKIP,
+    LIBORKH_VISIT_STOP
+} liborkh_visit_action_t;
+
+typedef liborkh_visit_action_t (*liborkh_gpu_elf_visit_cb_t)(liborkh_gpu_elf_entry_t *entry, void *user_data);
+
+typedef struct {
+    liborkh_gpu_elf_pool_t *pool;
+    liborkh_status_t status;
+} __liborkh_pool_push_ctx_t;
+
+// Decoder state shared by the visit functions of each offload format
+typedef struct {
+    liborkh_entry_filter_t *filter;
+    liborkh_gpu_elf_visit_cb_t func;
+    void *user_data;
+    bool headers_only; // entries are visited with elf == NULL, images are never read nor decompressed
+    size_t matched;
+    bool stop;
+    liborkh_status_t status; // first visit failure (e.g. image copy), stops decoding and is returned
+} __liborkh_visit_ctx_t;
+
+liborkh_visit_action_t __liborkh_pool_push_visitor(liborkh_gpu_elf_entry_t *entry, void *user_data);
+liborkh_status_t __liborkh_visit_entry(liborkh_gpu_elf_entry_t *entry, liborkh_gpu_elf_visit_cb_t func, void *user_data, liborkh_visit_action_t *action);
+
 liborkh_status_t liborkh_gpu_elf_pool_init(liborkh_gpu_elf_pool_t **pool, size_t initial_capacity);
 liborkh_status_t liborkh_gpu_elf_pool_free(liborkh_gpu_elf_pool_t *pool);
 liborkh_status_t liborkh_gpu_elf_pool_pop(liborkh_gpu_elf_pool_t *pool, liborkh_gpu_elf_entry_t **entry);
@@ -19,5 +55,52 @@ liborkh_status_t liborkh_gpu_elf_pool_push(liborkh_gpu_elf_pool_t *pool, liborkh
 liborkh_status_t liborkh_gpu_elf_pool_iterate(liborkh_gpu_elf_pool_t *pool, liborkh_gpu_elf_pool_iterate_cb_t func, void *user_data);
 liborkh_status_t liborkh_new_entry(liborkh_gpu_elf_entry_t **entry);
 liborkh_status_t liborkh_free_entry(liborkh_gpu_elf_entry_t *entry);
+liborkh_status_t liborkh_entry_own_image(liborkh_gpu_elf_entry_t *entry);
+liborkh_status_t liborkh_entry_own_strings(liborkh_gpu_elf_entry_t *entry);
+liborkh_status_t liborkh_entry_share_image(liborkh_gpu_elf_entry_t *dst, liborkh_gpu_elf_entry_t *src);
+liborkh_status_t liborkh_entry_compute_hash(liborkh_gpu_elf_entry_t *entry);
+
+/*
+ * Content-addressed deduplication: byte-identical images end up sharing one
+ * reference counted buffer (same entry->elf pointer), entries keep their own ids.
+ */
+liborkh_status_t liborkh_gpu_elf_pool_dedupe(liborkh_gpu_elf_pool_t *pool, size_t *num_shared);
+
+/*
+ * Concurrent pool: producers append from any thread without a lock. Storage is
+ * a list of segments of doubling size that never move, so slots (and the entry
+ * pointers they hold) stay valid while the pool grows. Each entry is appended
+ * with an order key (e.g. the index of the file or bundle it comes from);
+ * finalize hands the entries to a regular pool sorted by key, entries of the
+ * same key keeping their append order.
+ */
+#define LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS 40
+
+typedef struct {
+    liborkh_gpu_elf_entry_t *entry; // NULL until published
+    uint64_t key;
+} liborkh_concurrent_pool_slot_t;
+
+typedef struct {
+    size_t first_segment_size; // power of two, segment k holds first_segment_size << k slots
+    size_t next;               // next slot to reserve
+    liborkh_concurrent_pool_slot_t *segments[LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS];
+} liborkh_gpu_elf_concurrent_pool_t;
+
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_init(liborkh_gpu_elf_concurrent_pool_t **pool, size_t initial_capacity);
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_free(liborkh_gpu_elf_concurrent_pool_t *pool);
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_push(liborkh_gpu_elf_concurrent_pool_t *pool, uint64_t key, liborkh_gpu_elf_entry_t *entry);
+
+// Number of reserved slots, some of them may not be published yet
+size_t liborkh_gpu_elf_concurrent_pool_count(const liborkh_gpu_elf_concurrent_pool_t *pool);
+
+// Entry of a slot, NULL if the slot is not published yet
+liborkh_gpu_elf_entry_t *liborkh_gpu_elf_concurrent_pool_get(const liborkh_gpu_elf_concurrent_pool_t *pool, size_t index);
+
+/*
+ * Move every entry to the end of pool in (key, append order) order and empty
+ * the concurrent pool. Must not run concurrently with push.
+ */
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_finalize(liborkh_gpu_elf_concurrent_pool_t *cpool, liborkh_gpu_elf_pool_t *pool);
 
 #endif // LIBORKH_GPU_ELF_POOL_H
\ No newline at end of file
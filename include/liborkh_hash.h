@@ -0,0 +1,33 @@
+#ifndef LIBORKH_HASH_H
+#define LIBORKH_HASH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <stdbool.h>
+
+#define LIBORKH_HASH128_STRING_SIZE 33
+
+typedef struct {
+    uint64_t lo;
+    uint64_t hi;
+} liborkh_hash128_t;
+
+/*
+ * Fast 128-bit non-cryptographic content hash (XXH3-like stripe accumulation
+ * over 8 independent 64-bit lanes, which compilers vectorize). Used to detect
+ * identical code objects; the value is not compatible with XXH3.
+ */
+liborkh_hash128_t liborkh_hash128(const void* data, size_t size, uint64_t seed);
+void              liborkh_hash128_to_string(liborkh_hash128_t hash, char out[LIBORKH_HASH128_STRING_SIZE]);
+
+static inline bool liborkh_hash128_equal(liborkh_hash128_t a, liborkh_hash128_t b) {
+    return a.lo == b.lo && a.hi == b.hi;
+}
+
+static inline int liborkh_hash128_compare(liborkh_hash128_t a, liborkh_hash128_t b) {
+    if (a.hi != b.hi) return a.hi < b.hi ? -1 : 1;
+    if (a.lo != b.lo) return a.lo < b.lo ? -1 : 1;
+    return 0;
+}
+
+#endif // LIBORKH_HASH_H
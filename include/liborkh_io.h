@@ -1,6 +1,8 @@
 #ifndef LIBORKH_IO_H
 #define LIBORKH_IO_H
 
+#include <sys/types.h>
+
 #include "liborkh_utils.h"
 #include "liborkh.h"
 
@@ -28,6 +30,10 @@
 
 char* liborkh_get_elf_name(const liborkh_gpu_elf_entry_t* entry, const char* prefix);
 liborkh_status_t liborkh_write_elf_to_file(const liborkh_gpu_elf_entry_t* entry, const char* prefix);
+liborkh_status_t liborkh_write_pool_to_files(const liborkh_gpu_elf_pool_t* pool, const char* prefix, size_t* num_linked);
 liborkh_status_t liborkh_write_fatbin_to_file(const liborkh_offload_buffer* buf, const char* filename);
 
+// Exclusive, no-follow creation of a temporary file, -1 (errno set) on failure
+int __liborkh_open_temp_file(const char* tmp_filename, mode_t mode);
+
 #endif // LIBORKH_IO_H
\ No newline at end of file
@@ -0,0 +1,78 @@
+#ifndef LIBORKH_KERNEL_DESCRIPTOR_H
+#define LIBORKH_KERNEL_DESCRIPTOR_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+#define LIBORKH_KERNEL_DESCRIPTOR_SIZE   64
+#define LIBORKH_KERNEL_DESCRIPTOR_SUFFIX ".kd"
+
+// amdhsa_kernel_descriptor_t, as laid out in .rodata
+#define LIBORKH_KD_GROUP_SEGMENT_FIXED_SIZE      0
+#define LIBORKH_KD_PRIVATE_SEGMENT_FIXED_SIZE    4
+#define LIBORKH_KD_KERNARG_SIZE                  8
+#define LIBORKH_KD_KERNEL_CODE_ENTRY_BYTE_OFFSET 16
+#define LIBORKH_KD_COMPUTE_PGM_RSRC3             44
+#define LIBORKH_KD_COMPUTE_PGM_RSRC1             48
+#define LIBORKH_KD_COMPUTE_PGM_RSRC2             52
+#define LIBORKH_KD_KERNEL_CODE_PROPERTIES        56
+#define LIBORKH_KD_KERNARG_PRELOAD               58
+
+/*
+ * One kernel descriptor: the raw fields, then the values decoded from them
+ * for the processor of the code object.
+ */
+typedef struct {
+    uint32_t name;                          // offset into names, without the .kd suffix
+    uint64_t entry_id;
+    uint32_t group_segment_fixed_size;      // LDS bytes
+    uint32_t private_segment_fixed_size;    // scratch bytes per work-item
+    uint32_t kernarg_size;
+    int64_t  kernel_code_entry_byte_offset;
+    uint32_t compute_pgm_rsrc1;
+    uint32_t compute_pgm_rsrc2;
+    uint32_t compute_pgm_rsrc3;
+    uint16_t kernel_code_properties;
+    uint16_t kernarg_preload;
+
+    uint32_t vgpr_count;                    // allocated, VGPRs and AGPRs on gfx90a and gfx94x
+    uint32_t sgpr_count;                    // allocated, 0 from gfx10 on where it is not encoded
+    uint32_t accum_offset;                  // first AGPR, gfx90a and gfx94x only
+    uint32_t user_sgpr_count;
+    uint32_t wavefront_size;
+    uint8_t  workgroup_ids;                 // bit i set when the workgroup id of dimension i is enabled
+    uint8_t  workitem_id_dims;              // 1 to 3 dimensions of work-item ids in VGPRs
+    bool     private_segment;               // scratch enabled
+    bool     dynamic_stack;
+} liborkh_kernel_descriptor_t;
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    liborkh_kernel_descriptor_t* kernels;
+    char* names;
+    size_t names_size;
+    size_t names_capacity;
+} liborkh_kernel_descriptors_t;
+
+liborkh_status_t liborkh_kernel_descriptors_init(liborkh_kernel_descriptors_t** descriptors);
+liborkh_status_t liborkh_kernel_descriptors_free(liborkh_kernel_descriptors_t* descriptors);
+
+/*
+ * Decode every <name>.kd symbol of the code objects, independently of the
+ * metadata note. Entries without symbol table or descriptors add nothing.
+ */
+liborkh_status_t liborkh_kernel_descriptors_add_entry(liborkh_kernel_descriptors_t* descriptors, const liborkh_gpu_elf_entry_t* entry);
+liborkh_status_t liborkh_kernel_descriptors_add_pool(liborkh_kernel_descriptors_t* descriptors, const liborkh_gpu_elf_pool_t* pool);
+
+// Decode a 64 byte descriptor for a processor (e.g. "gfx90a", target features are ignored)
+liborkh_status_t liborkh_kernel_descriptor_decode(const uint8_t* raw, const char* processor, liborkh_kernel_descriptor_t* out);
+
+static inline const char* liborkh_kernel_descriptors_get_name(const liborkh_kernel_descriptors_t* descriptors, size_t index) {
+    return descriptors->names + descriptors->kernels[index].name;
+}
+
+#endif // LIBORKH_KERNEL_DESCRIPTOR_H
@@ -11,6 +11,7 @@
 
 liborkh_status_t liborkh_get_kernels_metadata(Elf* elf, uint8_t** out_metadata, size_t* out_size);
 liborkh_status_t liborkh_get_number_kernels(const uint8_t* metadata, size_t metadata_size, size_t* out_num_kernels);
+liborkh_status_t liborkh_get_number_kernels_in_entry(const liborkh_gpu_elf_entry_t* entry, size_t* out_num_kernels);
 liborkh_status_t liborkh_get_number_kernels_in_pool(liborkh_gpu_elf_pool_t* pool, size_t* out_num_kernels);
 
 #endif // LIBORKH_KERNEL_METADATA_H
\ No newline at end of file
@@ -3,6 +3,7 @@
 
 #include <stdio.h>
 #include <stdarg.h>
+#include <stdint.h>
 #include <time.h>
 #include <stdlib.h>
 
@@ -11,13 +12,88 @@
 #define COLOR_YELLOW  "\033[33m"
 #define COLOR_GREEN   "\033[32m"
 
-typedef enum { LOG_INFO, LOG_WARN, LOG_ERROR } log_level_t;
+#define LIBORKH_LOG_LEVEL_INFO  0
+#define LIBORKH_LOG_LEVEL_WARN  1
+#define LIBORKH_LOG_LEVEL_ERROR 2
+#define LIBORKH_LOG_LEVEL_NONE  3
+
+// Calls below this level are compiled out (-DLIBORKH_LOG_MIN_LEVEL=WARN with CMake)
+#ifndef LIBORKH_LOG_MIN_LEVEL
+#define LIBORKH_LOG_MIN_LEVEL LIBORKH_LOG_LEVEL_INFO
+#endif
+
+#define LIBORKH_LOG_ENV              "LIBORKH_LOG_LEVEL"
+#define LIBORKH_LOG_MSG_SIZE         512
+#define LIBORKH_LOG_RING_SIZE        1024
+#define LIBORKH_LOG_DEFAULT_RATE     10
+
+typedef enum {
+    LOG_INFO  = LIBORKH_LOG_LEVEL_INFO,
+    LOG_WARN  = LIBORKH_LOG_LEVEL_WARN,
+    LOG_ERROR = LIBORKH_LOG_LEVEL_ERROR,
+    LOG_NONE  = LIBORKH_LOG_LEVEL_NONE
+} log_level_t;
+
+typedef enum {
+    LIBORKH_LOG_SINK_STDERR = 0,
+    LIBORKH_LOG_SINK_RING
+} liborkh_log_sink_t;
+
+// Per call site rate limiting state, one static instance per warning and error macro expansion
+typedef struct liborkh_log_site {
+    uint64_t window_start_ns;
+    uint32_t count;
+    uint32_t suppressed;
+    // Filled when the site first suppresses a message, to report it at exit
+    struct liborkh_log_site* next;
+    int registered;
+    log_level_t level;
+    const char* file;
+    const char* func;
+    int line;
+} liborkh_log_site_t;
+
+typedef void (*liborkh_log_callback_t)(log_level_t level, const char* msg, void* user_data);
+
+extern int __liborkh_log_level;
 
 void liborkh_log(log_level_t level, const char* file, const char* func, int line, const char* fmt, ...);
+void liborkh_log_site(liborkh_log_site_t* site, log_level_t level, const char* file, const char* func, int line, const char* fmt, ...);
+
+void        liborkh_log_set_level(log_level_t level);
+log_level_t liborkh_log_get_level(void);
+void        liborkh_log_set_rate_limit(uint32_t per_second);
+
+// Report the messages suppressed by the rate limit so far, also done at exit
+void        liborkh_log_flush_suppressed(void);
+
+/*
+ * With LIBORKH_LOG_SINK_RING, messages are formatted into a lock-free ring
+ * buffer instead of being written to stderr; they are delivered by
+ * liborkh_log_drain() or by the drain thread. Messages are dropped (and
+ * counted) when the ring is full.
+ */
+void   liborkh_log_set_sink(liborkh_log_sink_t sink);
+size_t liborkh_log_drain(liborkh_log_callback_t func, void* user_data);
+int    liborkh_log_start_drain_thread(liborkh_log_callback_t func, void* user_data);
+void   liborkh_log_stop_drain_thread(void);
+
+// Only warnings and errors are rate limited, informational messages are results and always delivered
+#define __liborkh_log_at(level, fmt, ...)                                                         \
+    do {                                                                                          \
+        if ((level) >= LIBORKH_LOG_MIN_LEVEL && (int)(level) >= __liborkh_log_level) {            \
+            if ((level) >= LOG_WARN) {                                                            \
+                static liborkh_log_site_t __site;                                                 \
+                liborkh_log_site(&__site, level, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__); \
+            } else {                                                                              \
+                liborkh_log(level, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__);             \
+            }                                                                                     \
+        }                                                                                         \
+    } while (0)
 
 // Macro to automatically fill file, func, line
-#define liborkh_log_err(fmt, ...)  liborkh_log(LOG_ERROR, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
-#define liborkh_log_warn(fmt, ...) liborkh_log(LOG_WARN, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
-#define liborkh_log_info(fmt, ...) liborkh_log(LOG_INFO, __FILE__, __func__, __LINE__, fmt, ##__VA_ARGS__)
+#define liborkh_log_err(fmt, ...)  __liborkh_log_at(LOG_ERROR, fmt, ##__VA_ARGS__)
+#define liborkh_log_warn(fmt, ...) __liborkh_log_at(LOG_WARN,  fmt, ##__VA_ARGS__)
+#define liborkh_log_info(fmt, ...) __liborkh_log_at(LOG_INFO,  fmt, ##__VA_ARGS__)
 
-#endif // LIBORKH_LOG_H
\ No newline at end of file
+#endif // LIBORKH_LOG_H
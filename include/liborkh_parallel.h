@@ -0,0 +1,19 @@
+#ifndef LIBORKH_PARALLEL_H
+#define LIBORKH_PARALLEL_H
+
+#include <stddef.h>
+
+#include "liborkh_utils.h"
+
+typedef void (*liborkh_parallel_cb_t)(size_t index, void* user_data);
+
+/*
+ * Call func for every index in [0, count) from a pool of worker threads that
+ * take the next index as they become free. Workers account into the caller's
+ * statistics and memory budget. When no thread can be created, the indices
+ * are processed on the calling thread.
+ * @param num_threads Number of workers, 0 for one per online CPU (at most count)
+ */
+liborkh_status_t liborkh_parallel_for(size_t count, size_t num_threads, liborkh_parallel_cb_t func, void* user_data);
+
+#endif // LIBORKH_PARALLEL_H
@@ -0,0 +1,61 @@
+#ifndef LIBORKH_POOL_INDEX_H
+#define LIBORKH_POOL_INDEX_H
+
+#include <stdint.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+typedef enum {
+    LIBORKH_POOL_KEY_ARCH = 0,
+    LIBORKH_POOL_KEY_TRIPLE,
+    LIBORKH_POOL_KEY_OFK,
+    LIBORKH_POOL_KEY_IMG,
+    LIBORKH_POOL_KEY_ID,             // bundle or blob id
+    LIBORKH_POOL_KEY_COUNT
+} liborkh_pool_key_t;
+
+/*
+ * Posting lists of one key: the distinct values in ascending order and, for
+ * value v, the pool rows rows[offsets[v]] .. rows[offsets[v + 1] - 1] in
+ * ascending order. Entries without a string value are not listed.
+ */
+typedef struct {
+    size_t num_values;
+    const char** strings;            // ARCH and TRIPLE, borrowed from the entries
+    uint64_t* numbers;               // OFK, IMG and ID
+    uint32_t* offsets;
+    uint32_t* rows;
+} liborkh_pool_key_index_t;
+
+/*
+ * Secondary indexes of a pool, built once. The pool must not change while
+ * the index is in use; rebuild it after a push, pop or dedupe.
+ */
+typedef struct {
+    const liborkh_gpu_elf_pool_t* pool;
+    size_t count;                    // number of rows, pool->count at build time
+    liborkh_pool_key_index_t keys[LIBORKH_POOL_KEY_COUNT];
+} liborkh_pool_index_t;
+
+#define LIBORKH_POOL_INDEX_ANY_ID SIZE_MAX
+
+liborkh_status_t liborkh_pool_index_build(const liborkh_gpu_elf_pool_t* pool, liborkh_pool_index_t** index);
+liborkh_status_t liborkh_pool_index_free(liborkh_pool_index_t* index);
+
+// Rows of one value (NULL/0 rows when the value is absent), valid as long as the index
+liborkh_status_t liborkh_pool_index_find_string(const liborkh_pool_index_t* index, liborkh_pool_key_t key, const char* value, const uint32_t** rows, size_t* num_rows);
+liborkh_status_t liborkh_pool_index_find_number(const liborkh_pool_index_t* index, liborkh_pool_key_t key, uint64_t value, const uint32_t** rows, size_t* num_rows);
+
+/*
+ * Rows matching every predicate of the filter (img, ofk, triple, arch, limit)
+ * and the bundle id, LIBORKH_POOL_INDEX_ANY_ID for any. Posting lists are
+ * intersected shortest first, entries are never read.
+ * @param rows Room for index->count rows, ascending on return
+ */
+liborkh_status_t liborkh_pool_index_query(const liborkh_pool_index_t* index, const liborkh_entry_filter_t* filter, size_t id, uint32_t* rows, size_t* num_rows);
+
+// Same selection as a bitmap of (index->count + 63) / 64 words, bit i of word i / 64 for row i
+liborkh_status_t liborkh_pool_index_query_bitmap(const liborkh_pool_index_t* index, const liborkh_entry_filter_t* filter, size_t id, uint64_t* bitmap);
+
+#endif // LIBORKH_POOL_INDEX_H
@@ -0,0 +1,53 @@
+#ifndef LIBORKH_PROCESS_H
+#define LIBORKH_PROCESS_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+typedef struct {
+    uintptr_t start;
+    uintptr_t end;
+    uint64_t offset;
+    uint64_t dev;
+    uint64_t inode;
+} liborkh_process_mapping_t;
+
+// ELF file mapped in the process, its offload section is read once and cached
+typedef struct {
+    char* path;
+    uintptr_t start; // address of the mapping of file offset 0
+    uint64_t dev;
+    uint64_t inode;
+    bool loaded;
+    bool seen;
+    liborkh_offload_buffer fatbin;
+} liborkh_process_image_t;
+
+typedef struct {
+    pid_t pid;
+    size_t count;
+    size_t capacity;
+    liborkh_process_image_t* images;
+    size_t num_mappings;
+    liborkh_process_mapping_t* mappings;
+} liborkh_process_t;
+
+/*
+ * Live process extraction: mapped ELF images are listed from /proc/<pid>/maps,
+ * their offload sections are located from the in-memory ELF/program headers
+ * and read with process_vm_readv. Only the section header table (which is
+ * never loaded) is read from the file backing each image.
+ * liborkh_process_refresh() re-reads the maps and keeps the cached sections of
+ * mappings that are still present.
+ */
+liborkh_status_t liborkh_process_open(pid_t pid, liborkh_process_t** process);
+liborkh_status_t liborkh_process_refresh(liborkh_process_t* process);
+liborkh_status_t liborkh_process_close(liborkh_process_t* process);
+liborkh_status_t liborkh_process_read_fatbin(liborkh_process_t* process, size_t index, const liborkh_offload_buffer** fatbin);
+liborkh_status_t liborkh_process_get_gpu_elfs(liborkh_process_t* process, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter);
+
+#endif // LIBORKH_PROCESS_H
@@ -0,0 +1,31 @@
+#ifndef LIBORKH_SHM_CACHE_H
+#define LIBORKH_SHM_CACHE_H
+
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_snapshot.h"
+
+#define LIBORKH_SHM_CACHE_DIR_ENV     "LIBORKH_SHM_CACHE_DIR"
+#define LIBORKH_SHM_CACHE_DEFAULT_DIR "/dev/shm"
+
+/*
+ * Node-local cache of decoded host binaries. The first process decodes the
+ * offload section and publishes it as a snapshot in shared memory (tmpfs),
+ * concurrent callers wait on a lock file and then attach read-only to the same
+ * pages. Objects are keyed by user and file identity (device, inode, size and
+ * modification time), a modified binary gets a new object.
+ * @param created Optional, set to true when this call decoded the binary
+ */
+liborkh_status_t liborkh_shm_cache_open(const char* filename, liborkh_snapshot_t** snapshot, bool* created);
+liborkh_status_t liborkh_shm_cache_remove(const char* filename);
+liborkh_status_t liborkh_shm_cache_get_path(const char* filename, char* path, size_t size);
+
+/*
+ * Publishing a binary removes the objects of its previous versions; purge
+ * removes every object of the calling user. Objects are created with mode 0600.
+ * Lock files are never removed, a process may be waiting on them.
+ */
+liborkh_status_t liborkh_shm_cache_purge(size_t* num_removed);
+
+#endif // LIBORKH_SHM_CACHE_H
@@ -0,0 +1,70 @@
+#ifndef LIBORKH_SNAPSHOT_H
+#define LIBORKH_SNAPSHOT_H
+
+#include <stdint.h>
+#include <stdbool.h>
+#include <sys/types.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+#define LIBORKH_SNAPSHOT_MAGIC      "ORKHSNAP"
+#define LIBORKH_SNAPSHOT_MAGIC_SIZE 8
+#define LIBORKH_SNAPSHOT_VERSION    1
+
+/*
+ * Snapshot file layout (host byte order):
+ *   header | entry table | string table | page aligned image blobs
+ * Strings are NUL terminated, offset 0 of the string table encodes NULL.
+ * Images shared by several entries (see liborkh_gpu_elf_pool_dedupe) are stored once.
+ */
+typedef struct {
+    char magic[LIBORKH_SNAPSHOT_MAGIC_SIZE];
+    uint32_t version;
+    uint32_t page_size;          // alignment of the image blobs
+    uint64_t num_entries;
+    uint64_t entry_table_offset;
+    uint64_t string_table_offset;
+    uint64_t string_table_size;
+    uint64_t file_size;
+    uint64_t reserved;
+} liborkh_snapshot_header_t;
+
+typedef struct {
+    uint64_t id;
+    uint32_t img;
+    uint32_t ofk;
+    uint32_t flags;              // LIBORKH_ENTRY_COMPRESSED | LIBORKH_ENTRY_HASHED
+    uint32_t reserved;
+    uint64_t target_triple;      // string table offsets
+    uint64_t target_arch;
+    uint64_t member_name;
+    uint64_t member_offset;
+    uint64_t bundle_offset;
+    uint64_t image_offset;
+    uint64_t elf_offset;         // offset of the image in the file, 0 when the entry has no image
+    uint64_t elf_size;
+    uint64_t hash_lo;
+    uint64_t hash_hi;
+} liborkh_snapshot_entry_t;
+
+// Snapshot file mapped in memory, pool entries borrow their image and strings from the mapping
+typedef struct {
+    uint8_t* map;
+    size_t size;
+    liborkh_gpu_elf_pool_t* pool;
+} liborkh_snapshot_t;
+
+bool             liborkh_is_snapshot_file(const char* filename);
+liborkh_status_t liborkh_write_pool_to_snapshot(const liborkh_gpu_elf_pool_t* pool, const char* filename);
+liborkh_status_t __liborkh_write_pool_to_snapshot(const liborkh_gpu_elf_pool_t* pool, const char* filename, mode_t mode);
+
+/*
+ * Map a snapshot and expose its entries without copying. Entries stay valid
+ * until liborkh_snapshot_close(); entries that must outlive the snapshot
+ * need liborkh_entry_own_image() and liborkh_entry_own_strings().
+ */
+liborkh_status_t liborkh_snapshot_open(const char* filename, liborkh_snapshot_t** snapshot);
+liborkh_status_t liborkh_snapshot_close(liborkh_snapshot_t* snapshot);
+
+#endif // LIBORKH_SNAPSHOT_H
@@ -0,0 +1,60 @@
+#ifndef LIBORKH_STATS_H
+#define LIBORKH_STATS_H
+
+#include <stdio.h>
+#include <stdint.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_clang_offload_bundler.h"
+
+typedef struct {
+    uint64_t count;
+    uint64_t bytes;
+    uint64_t ns;
+} liborkh_stats_counter_t;
+
+typedef struct {
+    liborkh_stats_counter_t offload_read;                          // offload sections copied out of the host ELF
+    liborkh_stats_counter_t magic_scan;                            // decoder passes, bytes compared against magics, ns of the whole pass
+    liborkh_stats_counter_t bundles;                               // clang-offload-bundler bundles decoded
+    liborkh_stats_counter_t blobs;                                 // clang-offload-packager blobs decoded
+    liborkh_stats_counter_t decompress[CCOB_COMPRESSION_COUNT];    // CCOB bundles, bytes = uncompressed size
+    uint64_t                decompress_in_bytes[CCOB_COMPRESSION_COUNT];
+    liborkh_stats_counter_t entries_decoded;                       // entries matching the filter
+    liborkh_stats_counter_t entries_rejected;                      // entries rejected by the filter
+    liborkh_stats_counter_t images_copied;
+    liborkh_stats_counter_t gpu_elfs_opened;
+    liborkh_stats_counter_t kernels_counted;                       // count = kernels, bytes = metadata scanned
+    liborkh_stats_counter_t spilled;                               // buffers placed in temporary files by the memory budget
+    liborkh_stats_counter_t budget_waits;                          // allocations that waited for the memory budget
+} liborkh_stats_t;
+
+/*
+ * Statistics are accumulated into the calling thread's own liborkh_stats_t,
+ * unless a caller-owned context was bound with liborkh_stats_bind().
+ * Counters are updated atomically so one context can be bound by several threads.
+ */
+liborkh_stats_t* __liborkh_stats(void);
+
+void liborkh_stats_bind(liborkh_stats_t* ctx);
+void liborkh_stats_get(liborkh_stats_t* out);
+void liborkh_stats_reset(void);
+void liborkh_stats_merge(liborkh_stats_t* dst, const liborkh_stats_t* src);
+void liborkh_stats_print(FILE* out, const liborkh_stats_t* stats);
+const char* liborkh_compression_to_string(liborkh_ccob_compression_t codec);
+
+#define __liborkh_stats_add(field, value) __atomic_fetch_add(&(field), (value), __ATOMIC_RELAXED)
+
+#define LIBORKH_STATS_ADD(counter, n, nbytes)                     \
+    do {                                                          \
+        liborkh_stats_t* __st = __liborkh_stats();                \
+        __liborkh_stats_add(__st->counter.count, (uint64_t)(n));      \
+        __liborkh_stats_add(__st->counter.bytes, (uint64_t)(nbytes)); \
+    } while (0)
+
+#define LIBORKH_STATS_TIMER_START(timer) uint64_t timer = liborkh_now_ns()
+
+#define LIBORKH_STATS_TIMER_STOP(counter, timer) \
+    __liborkh_stats_add(__liborkh_stats()->counter.ns, liborkh_now_ns() - (timer))
+
+#endif // LIBORKH_STATS_H
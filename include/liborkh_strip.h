@@ -0,0 +1,38 @@
+#ifndef LIBORKH_STRIP_H
+#define LIBORKH_STRIP_H
+
+#include "liborkh_utils.h"
+#include "liborkh_compress.h"
+
+// Outcome of rewriting an offload section with only the entries matching a filter
+typedef struct {
+    size_t num_kept;
+    size_t num_removed;
+    size_t old_size;      // section size before and after
+    size_t new_size;
+} liborkh_strip_result_t;
+
+// Strip one offload section into `out` (same size), see liborkh_strip_gpu_elfs()
+liborkh_status_t liborkh_strip_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, uint8_t* out, liborkh_strip_result_t* result);
+liborkh_status_t liborkh_strip_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, uint8_t* out, liborkh_strip_result_t* result);
+
+/*
+ * Write a copy of a host ELF whose offload section (.hip_fatbin or
+ * .llvm.offloading) only holds the device code matching the filter.
+ * Bundles and blobs keep their offset since host code points to them: the
+ * removed bytes are zeroed (holes are punched in the output when the file
+ * system supports it) and the section size is reduced to its last used byte.
+ * The output is written to a temporary file and renamed once complete.
+ */
+liborkh_status_t liborkh_strip_gpu_elfs(const char* input, const char* output, liborkh_entry_filter_t* filter, liborkh_strip_result_t* result);
+
+/*
+ * Write a copy of a host ELF whose compressed bundles (.hip_fatbin) are
+ * recompressed with the given codec, level and CCOB version, e.g. to move
+ * zlib bundles to zstd. Bundle order, offsets and hashes are preserved.
+ * Fails with LIBORKH_ERROR_OUT_OF_BOUNDS, without writing the output, when a
+ * recompressed bundle does not fit in place (result->num_kept > 0).
+ */
+liborkh_status_t liborkh_transcode_gpu_elfs(const char* input, const char* output, const liborkh_ccob_options_t* options, liborkh_transcode_result_t* result);
+
+#endif // LIBORKH_STRIP_H
@@ -0,0 +1,63 @@
+#ifndef LIBORKH_TARGET_ID_H
+#define LIBORKH_TARGET_ID_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+#include "liborkh_gpu_elf_pool.h"
+
+#define LIBORKH_TARGET_ID_PROCESSOR_SIZE 32
+
+typedef enum {
+    LIBORKH_TARGET_FEATURE_SRAMECC = 0,
+    LIBORKH_TARGET_FEATURE_XNACK,
+    LIBORKH_TARGET_FEATURE_COUNT
+} liborkh_target_feature_t;
+
+/*
+ * Target ID ("gfx90a:sramecc+:xnack-") in (processor, feature mask) form.
+ * A feature is either on (bit set in `on`), off (bit set in `off`) or any.
+ */
+typedef struct {
+    char processor[LIBORKH_TARGET_ID_PROCESSOR_SIZE];
+    uint32_t on;
+    uint32_t off;
+} liborkh_target_id_t;
+
+liborkh_status_t liborkh_target_id_parse(const char* str, liborkh_target_id_t* out);
+liborkh_status_t liborkh_target_id_to_string(const liborkh_target_id_t* id, char* buf, size_t size);
+const char*      liborkh_target_feature_to_string(liborkh_target_feature_t feature);
+
+/*
+ * Clang offload rules: same processor, and every feature the code object sets
+ * (+ or -) must be set to the same value by the device. A feature left to
+ * `any` by the code object is compatible with every device setting.
+ */
+bool liborkh_target_id_is_compatible(const liborkh_target_id_t* code_object, const liborkh_target_id_t* device);
+
+typedef struct {
+    liborkh_target_id_t id;
+    uint32_t num_features; // features set by the code object, more is a better match
+    liborkh_gpu_elf_entry_t* entry;
+    size_t index;          // position of the entry in the pool
+} liborkh_target_table_item_t;
+
+/*
+ * Lookup table over the target IDs of a pool, sorted by processor then best
+ * match first. Only bundle IDs are used, entries can come from an inventory.
+ * The pool must outlive the table.
+ */
+typedef struct {
+    size_t count;
+    liborkh_target_table_item_t* items;
+} liborkh_target_table_t;
+
+liborkh_status_t liborkh_target_table_build(const liborkh_gpu_elf_pool_t* pool, const char* target_triple, liborkh_target_table_t** table);
+liborkh_status_t liborkh_target_table_free(liborkh_target_table_t* table);
+
+// *entry is NULL when no code object is compatible with the device
+liborkh_status_t liborkh_target_table_lookup(const liborkh_target_table_t* table, const char* device_id, liborkh_gpu_elf_entry_t** entry);
+liborkh_status_t liborkh_target_table_lookup_many(const liborkh_target_table_t* table, const char* const* device_ids, size_t num_devices, liborkh_gpu_elf_entry_t** entries);
+
+#endif // LIBORKH_TARGET_ID_H
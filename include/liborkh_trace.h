@@ -0,0 +1,47 @@
+#ifndef LIBORKH_TRACE_H
+#define LIBORKH_TRACE_H
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#include "liborkh_utils.h"
+
+#define LIBORKH_TRACE_ENV             "LIBORKH_TRACE"
+#define LIBORKH_TRACE_BUFFER_ENV      "LIBORKH_TRACE_BUFFER_EVENTS"
+#define LIBORKH_TRACE_DEFAULT_EVENTS  4096
+#define LIBORKH_TRACE_ARCH_SIZE       48
+
+typedef struct {
+    const char* name;
+    uint64_t ts_ns;
+    uint64_t dur_ns;
+    uint64_t size;
+    int32_t codec; // liborkh_ccob_compression_t, or -1
+    char arch[LIBORKH_TRACE_ARCH_SIZE];
+} liborkh_trace_event_t;
+
+/*
+ * Chrome Trace Event / Perfetto output. Spans are recorded in a fixed-size
+ * ring buffer owned by each thread (oldest events are overwritten) and only
+ * written out as JSON by liborkh_trace_stop(), or at exit when tracing was
+ * enabled through the LIBORKH_TRACE=<file> environment variable.
+ */
+liborkh_status_t liborkh_trace_start(const char* filename);
+liborkh_status_t liborkh_trace_stop(void);
+
+extern int __liborkh_trace_enabled;
+
+static inline bool liborkh_trace_is_enabled(void) {
+    return __atomic_load_n(&__liborkh_trace_enabled, __ATOMIC_RELAXED) != 0;
+}
+
+void __liborkh_trace_record(const char* name, uint64_t start_ns, uint64_t size, int32_t codec, const char* arch);
+
+#define LIBORKH_TRACE_BEGIN(span) uint64_t span = liborkh_trace_is_enabled() ? liborkh_now_ns() : 0
+
+#define LIBORKH_TRACE_END(span, name, size, codec, arch)                        \
+    do {                                                                        \
+        if (span) __liborkh_trace_record(name, span, (uint64_t)(size), codec, arch); \
+    } while (0)
+
+#endif // LIBORKH_TRACE_H
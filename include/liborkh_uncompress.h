@@ -1,54 +1,43 @@
 #ifndef LIBORKH_UNCOMPRESS_H
 #define LIBORKH_UNCOMPRESS_H
 
-#include <stdio.h>
 #include <stdint.h>
-#include <stdlib.h>
-#include <string.h>
+#include <stdbool.h>
 #include <zlib.h>
 #include <zstd.h>
 
 #include "liborkh_utils.h"
-
-liborkh_status_t libokrh_uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
-    uint8_t *out = (uint8_t*) malloc(uncompressed_size);
-    if (!out) return LIBORKH_ERROR_OUT_OF_MEMORY;
-
-    uLongf dest_len = uncompressed_size;
-
-    int ret = uncompress(out, &dest_len, buf, compressed_size);
-
-    if (ret != Z_OK) {
-        free(out);
-        return LIBORKH_ERROR_DECOMPRESSION_FAILED;
-    }
-
-    if (dest_len != uncompressed_size) {
-        liborkh_log_warn("Size mismatch after zlib decompress\n");
-    }
-
-    *out_buf = out;
-    *out_size = dest_len;
-    return LIBORKH_SUCCESS;
-}
-
-
-liborkh_status_t libokrh_uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
-    uint8_t *out = (uint8_t*) malloc(uncompressed_size);
-    if (!out) return LIBORKH_ERROR_OUT_OF_MEMORY;
-
-    size_t ret = ZSTD_decompress(out, uncompressed_size, buf, compressed_size);
-
-    if (ZSTD_isError(ret)) {
-        liborkh_log_warn("ZSTD error: %s\n", ZSTD_getErrorName(ret));
-        free(out);
-        return LIBORKH_ERROR_DECOMPRESSION_FAILED;
-    }
-
-    *out_buf = out;
-    *out_size = ret;
-    return LIBORKH_SUCCESS;
-
-}
-
-#endif // LIBORKH_UNCOMPRESS_H
\ No newline at end of file
+#include "liborkh_clang_offload_bundler.h"
+
+// Output is released with liborkh_free()
+liborkh_status_t libokrh_uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size);
+liborkh_status_t libokrh_uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size);
+
+// Same, with the output taken from the memory budget and released with liborkh_budget_free()
+liborkh_status_t __liborkh_uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size);
+liborkh_status_t __liborkh_uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size);
+
+/*
+ * Incremental decompression of a CCOB payload, used to decode only the
+ * beginning of a compressed bundle (e.g. its entry table). Output is
+ * accumulated in `out`, `out_size` bytes are valid.
+ */
+typedef struct {
+    liborkh_ccob_compression_t codec;
+    const uint8_t *in;
+    size_t in_size;
+    size_t in_pos;
+    size_t total_size;   // uncompressed size announced by the CCOB header
+    uint8_t *out;
+    size_t out_size;
+    size_t out_capacity;
+    bool finished;
+    z_stream zs;
+    ZSTD_DCtx *zds;
+} liborkh_uncompress_stream_t;
+
+liborkh_status_t liborkh_uncompress_stream_init(liborkh_uncompress_stream_t *stream, liborkh_ccob_compression_t codec, const uint8_t *buf, size_t compressed_size, size_t uncompressed_size);
+liborkh_status_t liborkh_uncompress_stream_fill(liborkh_uncompress_stream_t *stream, size_t min_size);
+void liborkh_uncompress_stream_free(liborkh_uncompress_stream_t *stream);
+
+#endif // LIBORKH_UNCOMPRESS_H
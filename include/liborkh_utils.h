@@ -5,8 +5,11 @@
 #include <stddef.h>
 #include <string.h>
 #include <stdbool.h>
+#include <time.h>
 
 #include "liborkh_log.h"
+#include "liborkh_alloc.h"
+#include "liborkh_hash.h"
 
 #define LIBORKH_CHECK_CALL(call, msg, ...)       \
     do {                                         \
@@ -74,6 +77,13 @@ typedef enum {
 } offload_kind_t;
 
 
+// liborkh_gpu_elf_entry_t flags
+#define LIBORKH_ENTRY_BORROWED_ELF 0x1 // elf points into memory owned by someone else
+#define LIBORKH_ENTRY_COMPRESSED   0x2 // image is stored in a compressed (CCOB) bundle
+#define LIBORKH_ENTRY_HASHED       0x4 // hash holds the content hash of the image
+#define LIBORKH_ENTRY_SHARED_ELF   0x8 // elf is a reference counted buffer, possibly shared with other entries
+#define LIBORKH_ENTRY_BORROWED_STRINGS 0x10 // target_triple, target_arch and member_name point into memory owned by someone else
+
 typedef struct {
     size_t id;
     image_kind_t img;
@@ -84,6 +94,12 @@ typedef struct {
     char* target_arch;
     size_t elf_size;
     uint8_t* elf;
+    uint32_t flags;
+    size_t bundle_offset; // offset of the bundle (CCOB header for compressed bundles) or packager blob in the offload buffer
+    size_t image_offset;  // offset of the image in the bundle once decompressed, or in the packager blob
+    liborkh_hash128_t hash;
+    char* member_name;    // static archive member the entry was found in, NULL otherwise
+    size_t member_offset; // offset of the member data in the archive
 } liborkh_gpu_elf_entry_t;
 
 
@@ -98,17 +114,29 @@ typedef struct {
     offload_kind_t ofk;
     const char* target_triple;
     const char* target_arch;
+    size_t limit; // stop decoding after this many matching entries, 0 = no limit
 } liborkh_entry_filter_t;
 
 
+// offset + len <= limit, without wrapping on untrusted offsets and lengths
 static inline liborkh_status_t check_bounds(size_t offset, size_t len, size_t limit) {
-    return (offset + len <= limit) ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_BOUNDS;
+    return (len <= limit && offset <= limit - len) ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_BOUNDS;
+}
+
+static inline uint64_t liborkh_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t) ts.tv_sec * 1000000000ULL + (uint64_t) ts.tv_nsec;
 }
 
 static inline bool liborkh_is_one_by_id_mode_filter(const liborkh_entry_filter_t *filter) {
     return filter && filter->id_mode == FILTER_ID_MODE_ONE_BY_ID;
 }
 
+static inline bool liborkh_is_filter_limit_reached(const liborkh_entry_filter_t *filter, size_t matched) {
+    return filter && filter->limit > 0 && matched >= filter->limit;
+}
+
 static inline bool liborkh_is_entry_matching_filter(const liborkh_gpu_elf_entry_t *entry, const liborkh_entry_filter_t *filter)
 {
     if (!entry)
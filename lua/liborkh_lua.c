@@ -54,6 +54,7 @@ static void parse_filter_from_table(lua_State* L, int index, liborkh_entry_filte
     filter->ofk           = OFK_None;
     filter->target_triple = NULL;
     filter->target_arch   = NULL;
+    filter->limit         = 0;
 
     if (!lua_istable(L, index)) {
         return;
@@ -67,6 +68,7 @@ static void parse_filter_from_table(lua_State* L, int index, liborkh_entry_filte
     filter->ofk           = (offload_kind_t)get_int_field(L, "ofk", filter->ofk);
     filter->target_triple = get_str_field(L, "target_triple");
     filter->target_arch   = get_str_field(L, "target_arch");
+    filter->limit         = (size_t)get_int_field(L, "limit", 0);
 
     lua_pop(L, 1);  // pop table
 }
@@ -113,17 +115,17 @@ static int get_gpu_elf_pool(lua_State* L, liborkh_offload_buffer* fatbin_buf, li
 
     liborkh_gpu_elf_pool_t *pool = NULL;
     if (liborkh_gpu_elf_pool_init(&pool, 4) != 0) {
-        free(fatbin_buf->buf);
+        liborkh_alloc_free(fatbin_buf->buf);
         return luaL_error(L, "failed to initialize GPU ELF pool");
     }
 
     if (liborkh_get_gpu_elfs(fatbin_buf, pool, filter) != 0) {
-        free(fatbin_buf->buf);
+        liborkh_alloc_free(fatbin_buf->buf);
         liborkh_gpu_elf_pool_free(pool);
         return luaL_error(L, "failed to get GPU ELFs");
     }
 
-    free(fatbin_buf->buf);
+    liborkh_alloc_free(fatbin_buf->buf);
 
     *out_pool = pool;
     return 0;
@@ -198,7 +200,7 @@ static liborkh_status_t set_metadata_buffer(liborkh_gpu_elf_entry_t *entry, void
     char* gpu_elf_name = liborkh_get_elf_name(entry, ctx->elf_filename);
 
     if (!entry->elf || entry->elf_size == 0) {
-        free(gpu_elf_name);
+        liborkh_alloc_free(gpu_elf_name);
         return LIBORKH_SUCCESS;
     }
 
@@ -207,7 +209,7 @@ static liborkh_status_t set_metadata_buffer(liborkh_gpu_elf_entry_t *entry, void
     status = liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &gpu_elf);
     if (status != LIBORKH_SUCCESS) {
         luaL_error(L, "Cannot open ELF from memory for entry %s\n", gpu_elf_name);
-        free(gpu_elf_name);
+        liborkh_alloc_free(gpu_elf_name);
         return status;
     }
 
@@ -215,7 +217,7 @@ static liborkh_status_t set_metadata_buffer(liborkh_gpu_elf_entry_t *entry, void
     if (status != LIBORKH_SUCCESS) {
         liborkh_close_elf(gpu_elf);
         luaL_error(L, "Cannot get kernel metadata from ELF in entry %s\n", gpu_elf_name);
-        free(gpu_elf_name);
+        liborkh_alloc_free(gpu_elf_name);
         return status;
     }
 
@@ -231,7 +233,7 @@ static liborkh_status_t set_metadata_buffer(liborkh_gpu_elf_entry_t *entry, void
 
     lua_settable(L, ctx->table_index);
 
-    free(gpu_elf_name);
+    liborkh_alloc_free(gpu_elf_name);
 
     return status;
 }
@@ -297,7 +299,160 @@ static int l_free_metadata_buffer(lua_State* L) {
     if (ptr == NULL)
         return luaL_error(L, "expected lightuserdata as argument");
 
-    free(ptr);
+    liborkh_alloc_free(ptr);
+    return 0;
+}
+
+
+/**
+ * Push a uint32 column of the catalog as a Lua array and set it in the table at the top of the stack
+ * @param L Lua state
+ * @param key Field key in the parent table
+ * @param values Column values
+ * @param count Number of rows
+ */
+static void set_catalog_column(lua_State* L, const char* key, const uint32_t* values, size_t count) {
+    lua_createtable(L, (int)count, 0);
+    for (size_t i = 0; i < count; i++) {
+        lua_pushinteger(L, (lua_Integer)values[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+    lua_setfield(L, -2, key);
+}
+
+
+/**
+ * Build the kernel catalog of one or more ELF files
+ * Lua arguments:
+ * 1. elf_filenames (string or table of strings): Paths to ELF files
+ * 2. filter (table or nil): Filter table
+ * Lua returns:
+ * 1. table of columns {count, name, arch, source, entry_id, sgpr, vgpr, agpr, lds,
+ *    scratch, kernarg, wavefront}, each column is an array indexed by row
+ */
+static int l_get_kernel_catalog(lua_State* L) {
+    liborkh_entry_filter_t filter = {0};
+    parse_filter_from_table(L, 2, &filter);
+
+    liborkh_catalog_t *catalog = NULL;
+    if (liborkh_catalog_init(&catalog) != 0) {
+        return luaL_error(L, "failed to initialize kernel catalog");
+    }
+
+    size_t num_files = lua_istable(L, 1) ? lua_objlen(L, 1) : 1;
+    for (size_t i = 0; i < num_files; i++) {
+        const char *elf_filename = NULL;
+        if (lua_istable(L, 1)) {
+            lua_rawgeti(L, 1, (int)i + 1);
+            elf_filename = lua_tostring(L, -1);
+            lua_pop(L, 1);  // the string stays referenced by the table
+        } else {
+            elf_filename = luaL_checkstring(L, 1);
+        }
+
+        if (!elf_filename || liborkh_catalog_add_file(catalog, elf_filename, &filter) != 0) {
+            liborkh_catalog_free(catalog);
+            return luaL_error(L, "failed to add ELF file to kernel catalog: %s", elf_filename ? elf_filename : "?");
+        }
+    }
+
+    lua_newtable(L);
+    lua_pushinteger(L, (lua_Integer)catalog->count);
+    lua_setfield(L, -2, "count");
+
+    lua_createtable(L, (int)catalog->count, 0);
+    for (size_t i = 0; i < catalog->count; i++) {
+        lua_pushstring(L, liborkh_catalog_get_name(catalog, i));
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+    lua_setfield(L, -2, "name");
+
+    const char *dict_keys[LIBORKH_CATALOG_DICT_COUNT] = { "arch", "source" };
+    for (int d = 0; d < LIBORKH_CATALOG_DICT_COUNT; d++) {
+        lua_createtable(L, (int)catalog->count, 0);
+        for (size_t i = 0; i < catalog->count; i++) {
+            lua_pushstring(L, liborkh_catalog_get_string(catalog, (liborkh_catalog_dict_t)d, i));
+            lua_rawseti(L, -2, (int)i + 1);
+        }
+        lua_setfield(L, -2, dict_keys[d]);
+    }
+
+    lua_createtable(L, (int)catalog->count, 0);
+    for (size_t i = 0; i < catalog->count; i++) {
+        lua_pushinteger(L, (lua_Integer)catalog->entry_id[i]);
+        lua_rawseti(L, -2, (int)i + 1);
+    }
+    lua_setfield(L, -2, "entry_id");
+
+    for (int c = 0; c < LIBORKH_CATALOG_COLUMN_COUNT; c++) {
+        set_catalog_column(L, liborkh_catalog_column_to_string((liborkh_catalog_column_t)c), catalog->columns[c], catalog->count);
+    }
+
+    liborkh_catalog_free(catalog);
+    return 1;
+}
+
+/**
+ * Push a stats counter as a Lua table {count, bytes, ns} and set it in the table at the top of the stack
+ * @param L Lua state
+ * @param key Field key in the parent table
+ * @param counter Counter to push
+ */
+static void set_stats_counter(lua_State* L, const char* key, const liborkh_stats_counter_t* counter) {
+    lua_newtable(L);
+    lua_pushinteger(L, (lua_Integer)counter->count);
+    lua_setfield(L, -2, "count");
+    lua_pushinteger(L, (lua_Integer)counter->bytes);
+    lua_setfield(L, -2, "bytes");
+    lua_pushinteger(L, (lua_Integer)counter->ns);
+    lua_setfield(L, -2, "ns");
+    lua_setfield(L, -2, key);
+}
+
+
+/**
+ * Get liborkh runtime statistics of the calling thread
+ * Lua returns:
+ * 1. table mapping each stage to {count, bytes, ns}, decompression stages are
+ *    grouped by codec under "decompress" and also carry "in_bytes"
+ */
+static int l_get_stats(lua_State* L) {
+    liborkh_stats_t stats;
+    liborkh_stats_get(&stats);
+
+    lua_newtable(L);
+    set_stats_counter(L, "offload_read",     &stats.offload_read);
+    set_stats_counter(L, "magic_scan",       &stats.magic_scan);
+    set_stats_counter(L, "bundles",          &stats.bundles);
+    set_stats_counter(L, "blobs",            &stats.blobs);
+    set_stats_counter(L, "entries_decoded",  &stats.entries_decoded);
+    set_stats_counter(L, "entries_rejected", &stats.entries_rejected);
+    set_stats_counter(L, "images_copied",    &stats.images_copied);
+    set_stats_counter(L, "gpu_elfs_opened",  &stats.gpu_elfs_opened);
+    set_stats_counter(L, "kernels_counted",  &stats.kernels_counted);
+    set_stats_counter(L, "spilled",          &stats.spilled);
+    set_stats_counter(L, "budget_waits",     &stats.budget_waits);
+
+    lua_newtable(L);
+    for (int i = 0; i < CCOB_COMPRESSION_COUNT; i++) {
+        const char *codec = liborkh_compression_to_string((liborkh_ccob_compression_t)i);
+        set_stats_counter(L, codec, &stats.decompress[i]);
+        lua_getfield(L, -1, codec);
+        lua_pushinteger(L, (lua_Integer)stats.decompress_in_bytes[i]);
+        lua_setfield(L, -2, "in_bytes");
+        lua_pop(L, 1);
+    }
+    lua_setfield(L, -2, "decompress");
+
+    return 1;
+}
+
+
+/**
+ * Reset liborkh runtime statistics of the calling thread
+ */
+static int l_reset_stats(lua_State* L) {
+    liborkh_stats_reset();
     return 0;
 }
 
@@ -310,6 +465,9 @@ int luaopen_liborkh_lua(lua_State *L) {
         {"get_kernel_count", l_get_kernel_count},
         {"get_metadata_buffer", l_get_metadata_buffer},
         {"free_metadata_buffer", l_free_metadata_buffer},
+        {"get_kernel_catalog", l_get_kernel_catalog},
+        {"get_stats", l_get_stats},
+        {"reset_stats", l_reset_stats},
         {NULL, NULL}
     };
 
@@ -17,7 +17,69 @@ liborkh_status_t liborkh_get_gpu_elfs(liborkh_offload_buffer *buf, liborkh_gpu_e
     return LIBORKH_SUCCESS;
 }
 
-liborkh_status_t liborkh_extract_gpu_fatbin(Elf *elf, liborkh_offload_buffer *out) {
+static liborkh_status_t __liborkh_visit(liborkh_offload_buffer *buf, __liborkh_visit_ctx_t *ctx) {
+    switch (buf->kind) {
+        case CLANG_OFFLOAD_BUNDLER_KIND:  return __liborkh_visit_clang_offload_bundler(buf->buf, buf->size, ctx);
+        case CLANG_OFFLOAD_PACKAGER_KIND: return __liborkh_visit_clang_offload_packager(buf->buf, buf->size, ctx);
+        default: liborkh_log_warn("Unknown offload kind : %d\n", buf->kind); break;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_visit_gpu_elfs(liborkh_offload_buffer *buf, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data) {
+    LIBORKH_CHECK_ARGUMENTS(!buf || !func);
+
+    __liborkh_visit_ctx_t ctx = { .filter = filter, .func = func, .user_data = user_data };
+    return __liborkh_visit(buf, &ctx);
+}
+
+/**
+ * Same as liborkh_visit_gpu_elfs() but entries carry no image (elf == NULL), only their
+ * size and offsets. Compressed bundles are only decompressed up to their entry table.
+ */
+liborkh_status_t liborkh_visit_gpu_elf_inventory(liborkh_offload_buffer *buf, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data) {
+    LIBORKH_CHECK_ARGUMENTS(!buf || !func);
+
+    __liborkh_visit_ctx_t ctx = { .filter = filter, .func = func, .user_data = user_data, .headers_only = true };
+    return __liborkh_visit(buf, &ctx);
+}
+
+liborkh_status_t liborkh_get_gpu_elf_inventory(liborkh_offload_buffer *buf, liborkh_gpu_elf_pool_t *pool, liborkh_entry_filter_t* filter) {
+    LIBORKH_CHECK_ARGUMENTS(!buf || !pool);
+
+    __liborkh_pool_push_ctx_t ctx = { .pool = pool, .status = LIBORKH_SUCCESS };
+    LIBORKH_CHECK_CALL(liborkh_visit_gpu_elf_inventory(buf, filter, __liborkh_pool_push_visitor, &ctx), "Failed to build inventory\n");
+    return ctx.status;
+}
+
+static liborkh_visit_action_t __liborkh_found_visitor(liborkh_gpu_elf_entry_t *entry, void *user_data) {
+    (void) entry;
+    *(bool *) user_data = true;
+    return LIBORKH_VISIT_SKIP;
+}
+
+/**
+ * Check whether the offload buffer contains at least one entry matching the filter.
+ * Only entry tables are read and decoding stops at the first match.
+ */
+liborkh_status_t liborkh_has_gpu_elf(liborkh_offload_buffer *buf, const liborkh_entry_filter_t* filter, bool *found) {
+    LIBORKH_CHECK_ARGUMENTS(!buf || !found);
+
+    liborkh_entry_filter_t first_match = {0};
+    if (filter) {
+        first_match = *filter;
+    }
+    first_match.limit = 1;
+
+    *found = false;
+    return liborkh_visit_gpu_elf_inventory(buf, &first_match, __liborkh_found_visitor, found);
+}
+
+/**
+ * Locate the offload section without copying it: out->buf points into the data
+ * of the Elf handle and is only valid until it is closed.
+ */
+liborkh_status_t liborkh_get_gpu_fatbin_view(Elf *elf, liborkh_offload_buffer *out) {
     LIBORKH_CHECK_ARGUMENTS(!elf || !out);
 
     size_t shstrndx = 0;
@@ -60,17 +122,40 @@ liborkh_status_t liborkh_extract_gpu_fatbin(Elf *elf, liborkh_offload_buffer *ou
             return LIBORKH_ERROR_ELF;
         } 
 
-        unsigned char *buf = malloc(data->d_size);
-        LIBORKH_CHECK_ALLOC(buf);
-
-        memcpy(buf, data->d_buf, data->d_size);
-        out->buf  = buf;
+        out->buf  = (uint8_t *) data->d_buf;
         out->size = data->d_size;
         break;
     }
     return LIBORKH_SUCCESS;
 }
 
+liborkh_status_t liborkh_extract_gpu_fatbin(Elf *elf, liborkh_offload_buffer *out) {
+    LIBORKH_CHECK_ARGUMENTS(!elf || !out);
+
+    LIBORKH_TRACE_BEGIN(span);
+
+    liborkh_offload_buffer view;
+    LIBORKH_CHECK_CALL(liborkh_get_gpu_fatbin_view(elf, &view), "Cannot locate offload section\n");
+
+    *out = view;
+    if (view.buf) {
+        LIBORKH_STATS_TIMER_START(read_timer);
+
+        unsigned char *buf = liborkh_malloc(LIBORKH_ALLOC_STAGE_FATBIN, view.size);
+        if (!buf) out->buf = NULL;
+        LIBORKH_CHECK_ALLOC(buf);
+
+        memcpy(buf, view.buf, view.size);
+        out->buf = buf;
+
+        LIBORKH_STATS_ADD(offload_read, 1, view.size);
+        LIBORKH_STATS_TIMER_STOP(offload_read, read_timer);
+    }
+
+    LIBORKH_TRACE_END(span, "liborkh_extract_gpu_fatbin", out->size, -1, NULL);
+    return LIBORKH_SUCCESS;
+}
+
 const char* liborkh_image_kind_to_string(image_kind_t img) {
     switch (img) {
         case IMG_None:      return "none";
@@ -0,0 +1,320 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "liborkh_alloc.h"
+
+const char* liborkh_alloc_stage_to_string(liborkh_alloc_stage_t stage) {
+    switch (stage) {
+        case LIBORKH_ALLOC_STAGE_POOL:       return "pool";
+        case LIBORKH_ALLOC_STAGE_ENTRY:      return "entry";
+        case LIBORKH_ALLOC_STAGE_ENTRY_ID:   return "entry_id";
+        case LIBORKH_ALLOC_STAGE_DECOMPRESS: return "decompress";
+        case LIBORKH_ALLOC_STAGE_FATBIN:     return "fatbin";
+        case LIBORKH_ALLOC_STAGE_IMAGE:      return "image";
+        case LIBORKH_ALLOC_STAGE_SECTION:    return "section";
+        case LIBORKH_ALLOC_STAGE_NOTE:       return "note";
+        case LIBORKH_ALLOC_STAGE_IO:         return "io";
+        default:                             return "unknown";
+    }
+}
+
+#ifdef LIBORKH_ALLOC_PROFILING
+
+#define LIBORKH_ALLOC_MAX_SITES 128
+
+typedef struct {
+    const char* file;
+    const char* func;
+    int line;
+    liborkh_alloc_stage_t stage;
+    liborkh_alloc_counter_t counter;
+} __liborkh_alloc_site_t;
+
+// Live allocation record, stored in an open-addressing table keyed by pointer
+typedef struct {
+    void* ptr;
+    size_t size;
+    uint32_t site;
+} __liborkh_alloc_record_t;
+
+#define LIBORKH_ALLOC_TOMBSTONE ((void*) 1)
+
+static pthread_mutex_t          __prof_lock = PTHREAD_MUTEX_INITIALIZER;
+static __liborkh_alloc_site_t   __prof_sites[LIBORKH_ALLOC_MAX_SITES];
+static size_t                   __prof_num_sites = 0;
+static liborkh_alloc_profile_t  __prof = {0};
+static __liborkh_alloc_record_t *__prof_records = NULL;
+static size_t                   __prof_records_capacity = 0;
+static size_t                   __prof_records_used = 0;
+
+static inline size_t __hash_ptr(const void* ptr, size_t capacity) {
+    uint64_t h = (uint64_t)(uintptr_t) ptr;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return (size_t)(h & (capacity - 1));
+}
+
+static void __counter_alloc(liborkh_alloc_counter_t* c, size_t size) {
+    c->allocs++;
+    c->bytes += size;
+    c->live_bytes += size;
+    if (c->live_bytes > c->peak_bytes) c->peak_bytes = c->live_bytes;
+}
+
+static void __counter_free(liborkh_alloc_counter_t* c, size_t size) {
+    c->frees++;
+    c->live_bytes = c->live_bytes >= size ? c->live_bytes - size : 0;
+}
+
+static uint32_t __find_site(liborkh_alloc_stage_t stage, const char* file, const char* func, int line) {
+    for (size_t i = 0; i < __prof_num_sites; i++) {
+        if (__prof_sites[i].line == line && __prof_sites[i].file == file) return (uint32_t) i;
+    }
+    if (__prof_num_sites == LIBORKH_ALLOC_MAX_SITES) {
+        return LIBORKH_ALLOC_MAX_SITES - 1; // last slot collects overflowing sites
+    }
+    __liborkh_alloc_site_t* site = &__prof_sites[__prof_num_sites];
+    site->file  = file;
+    site->func  = func;
+    site->line  = line;
+    site->stage = stage;
+    return (uint32_t) __prof_num_sites++;
+}
+
+// Rehash without tombstones, the table only doubles when live records fill a quarter of it
+static int __grow_records(void) {
+    size_t live = 0;
+    for (size_t i = 0; i < __prof_records_capacity; i++) {
+        void* ptr = __prof_records[i].ptr;
+        if (ptr && ptr != LIBORKH_ALLOC_TOMBSTONE) live++;
+    }
+
+    size_t new_capacity = __prof_records_capacity;
+    if (new_capacity == 0) new_capacity = 1024;
+    else if ((live + 1) * 4 > new_capacity) new_capacity *= 2;
+
+    __liborkh_alloc_record_t* records = calloc(new_capacity, sizeof(*records));
+    if (!records) return -1;
+
+    for (size_t i = 0; i < __prof_records_capacity; i++) {
+        void* ptr = __prof_records[i].ptr;
+        if (!ptr || ptr == LIBORKH_ALLOC_TOMBSTONE) continue;
+        size_t slot = __hash_ptr(ptr, new_capacity);
+        while (records[slot].ptr) slot = (slot + 1) & (new_capacity - 1);
+        records[slot] = __prof_records[i];
+    }
+    free(__prof_records);
+    __prof_records = records;
+    __prof_records_capacity = new_capacity;
+    __prof_records_used = live; // tombstones are gone
+    return 0;
+}
+
+static void __track(void* ptr, size_t size, liborkh_alloc_stage_t stage, const char* file, const char* func, int line) {
+    if (!ptr) return;
+
+    if ((__prof_records_used + 1) * 2 > __prof_records_capacity && __grow_records() != 0) {
+        return; // profiler out of memory: allocation stays untracked
+    }
+
+    uint32_t site = __find_site(stage, file, func, line);
+    size_t slot = __hash_ptr(ptr, __prof_records_capacity);
+    while (__prof_records[slot].ptr && __prof_records[slot].ptr != LIBORKH_ALLOC_TOMBSTONE) {
+        slot = (slot + 1) & (__prof_records_capacity - 1);
+    }
+    if (!__prof_records[slot].ptr) __prof_records_used++;
+    __prof_records[slot].ptr  = ptr;
+    __prof_records[slot].size = size;
+    __prof_records[slot].site = site;
+
+    __counter_alloc(&__prof.total, size);
+    __counter_alloc(&__prof.stages[__prof_sites[site].stage], size);
+    __counter_alloc(&__prof_sites[site].counter, size);
+}
+
+static void __untrack(void* ptr) {
+    if (!ptr || __prof_records_capacity == 0) return;
+
+    size_t slot = __hash_ptr(ptr, __prof_records_capacity);
+    while (__prof_records[slot].ptr) {
+        if (__prof_records[slot].ptr == ptr) {
+            __liborkh_alloc_site_t* site = &__prof_sites[__prof_records[slot].site];
+            size_t size = __prof_records[slot].size;
+            __counter_free(&__prof.total, size);
+            __counter_free(&__prof.stages[site->stage], size);
+            __counter_free(&site->counter, size);
+            __prof_records[slot].ptr = LIBORKH_ALLOC_TOMBSTONE;
+            return;
+        }
+        slot = (slot + 1) & (__prof_records_capacity - 1);
+    }
+    // Not allocated by liborkh (or allocated before the profiler ran out of memory)
+}
+
+void* __liborkh_prof_malloc(liborkh_alloc_stage_t stage, size_t size, const char* file, const char* func, int line) {
+    void* ptr = malloc(size);
+    pthread_mutex_lock(&__prof_lock);
+    __track(ptr, size, stage, file, func, line);
+    pthread_mutex_unlock(&__prof_lock);
+    return ptr;
+}
+
+void* __liborkh_prof_calloc(liborkh_alloc_stage_t stage, size_t n, size_t size, const char* file, const char* func, int line) {
+    void* ptr = calloc(n, size);
+    pthread_mutex_lock(&__prof_lock);
+    __track(ptr, n * size, stage, file, func, line);
+    pthread_mutex_unlock(&__prof_lock);
+    return ptr;
+}
+
+void* __liborkh_prof_realloc(liborkh_alloc_stage_t stage, void* ptr, size_t size, const char* file, const char* func, int line) {
+    uintptr_t old_ptr = (uintptr_t) ptr; // only used as a lookup key once the block moved
+    void* new_ptr = realloc(ptr, size);
+    if (!new_ptr && size > 0) return NULL; // old block untouched
+
+    pthread_mutex_lock(&__prof_lock);
+    __untrack((void*) old_ptr);
+    __track(new_ptr, size, stage, file, func, line);
+    pthread_mutex_unlock(&__prof_lock);
+    return new_ptr;
+}
+
+char* __liborkh_prof_strdup(liborkh_alloc_stage_t stage, const char* str, const char* file, const char* func, int line) {
+    char* copy = strdup(str);
+    pthread_mutex_lock(&__prof_lock);
+    __track(copy, copy ? strlen(copy) + 1 : 0, stage, file, func, line);
+    pthread_mutex_unlock(&__prof_lock);
+    return copy;
+}
+
+void __liborkh_prof_free(void* ptr) {
+    if (!ptr) return;
+    pthread_mutex_lock(&__prof_lock);
+    __untrack(ptr);
+    pthread_mutex_unlock(&__prof_lock);
+    free(ptr);
+}
+
+bool liborkh_alloc_profile_enabled(void) {
+    return true;
+}
+
+void liborkh_alloc_profile_reset(void) {
+    pthread_mutex_lock(&__prof_lock);
+
+    // Keep live bytes so that frees of older allocations stay consistent
+    liborkh_alloc_counter_t* counters[2 + LIBORKH_ALLOC_STAGE_COUNT + LIBORKH_ALLOC_MAX_SITES];
+    size_t n = 0;
+    counters[n++] = &__prof.total;
+    for (size_t i = 0; i < LIBORKH_ALLOC_STAGE_COUNT; i++) counters[n++] = &__prof.stages[i];
+    for (size_t i = 0; i < __prof_num_sites; i++)         counters[n++] = &__prof_sites[i].counter;
+
+    for (size_t i = 0; i < n; i++) {
+        counters[i]->allocs = 0;
+        counters[i]->frees  = 0;
+        counters[i]->bytes  = 0;
+        counters[i]->peak_bytes = counters[i]->live_bytes;
+    }
+    pthread_mutex_unlock(&__prof_lock);
+}
+
+void liborkh_alloc_profile_get(liborkh_alloc_profile_t* out) {
+    if (!out) return;
+    pthread_mutex_lock(&__prof_lock);
+    *out = __prof;
+    pthread_mutex_unlock(&__prof_lock);
+}
+
+static void __print_counter(FILE* out, const char* name, const liborkh_alloc_counter_t* c) {
+    fprintf(out, "  %-56s %10lu %10lu %14lu %14lu %14lu\n", name,
+            (unsigned long) c->allocs, (unsigned long) c->frees, (unsigned long) c->bytes,
+            (unsigned long) c->live_bytes, (unsigned long) c->peak_bytes);
+}
+
+void liborkh_alloc_profile_print(FILE* out, const char* label, bool with_sites) {
+    out = out ? out : stderr;
+
+    pthread_mutex_lock(&__prof_lock);
+
+    fprintf(out, "liborkh allocations [%s]\n", label ? label : "all");
+    fprintf(out, "  %-56s %10s %10s %14s %14s %14s\n", "stage", "allocs", "frees", "bytes", "live", "peak");
+    for (size_t i = 0; i < LIBORKH_ALLOC_STAGE_COUNT; i++) {
+        if (__prof.stages[i].allocs == 0 && __prof.stages[i].live_bytes == 0) continue;
+        __print_counter(out, liborkh_alloc_stage_to_string((liborkh_alloc_stage_t) i), &__prof.stages[i]);
+    }
+    __print_counter(out, "total", &__prof.total);
+
+    if (with_sites) {
+        fprintf(out, "  %-56s %10s %10s %14s %14s %14s\n", "site", "allocs", "frees", "bytes", "live", "peak");
+        for (size_t i = 0; i < __prof_num_sites; i++) {
+            const __liborkh_alloc_site_t* site = &__prof_sites[i];
+            if (site->counter.allocs == 0 && site->counter.live_bytes == 0) continue;
+
+            const char* file = strrchr(site->file, '/');
+            char name[256];
+            snprintf(name, sizeof(name), "%s:%d %s()", file ? file + 1 : site->file, site->line, site->func);
+            __print_counter(out, name, &site->counter);
+        }
+    }
+
+    pthread_mutex_unlock(&__prof_lock);
+}
+
+// Report at exit for tools run against the instrumented build with LIBORKH_ALLOC_PROFILE set
+__attribute__((destructor))
+static void __liborkh_alloc_profile_at_exit(void) {
+    if (getenv("LIBORKH_ALLOC_PROFILE")) {
+        liborkh_alloc_profile_print(stderr, "process", true);
+    }
+}
+
+#else
+
+void* __liborkh_prof_malloc(liborkh_alloc_stage_t stage, size_t size, const char* file, const char* func, int line) {
+    (void) stage; (void) file; (void) func; (void) line;
+    return malloc(size);
+}
+
+void* __liborkh_prof_calloc(liborkh_alloc_stage_t stage, size_t n, size_t size, const char* file, const char* func, int line) {
+    (void) stage; (void) file; (void) func; (void) line;
+    return calloc(n, size);
+}
+
+void* __liborkh_prof_realloc(liborkh_alloc_stage_t stage, void* ptr, size_t size, const char* file, const char* func, int line) {
+    (void) stage; (void) file; (void) func; (void) line;
+    return realloc(ptr, size);
+}
+
+char* __liborkh_prof_strdup(liborkh_alloc_stage_t stage, const char* str, const char* file, const char* func, int line) {
+    (void) stage; (void) file; (void) func; (void) line;
+    return strdup(str);
+}
+
+void __liborkh_prof_free(void* ptr) {
+    free(ptr);
+}
+
+bool liborkh_alloc_profile_enabled(void) {
+    return false;
+}
+
+void liborkh_alloc_profile_reset(void) {
+}
+
+void liborkh_alloc_profile_get(liborkh_alloc_profile_t* out) {
+    if (out) memset(out, 0, sizeof(*out));
+}
+
+void liborkh_alloc_profile_print(FILE* out, const char* label, bool with_sites) {
+    (void) with_sites;
+    fprintf(out ? out : stderr, "liborkh allocations [%s]: profiling disabled (configure with -DLIBORKH_ALLOC_PROFILING=ON)\n", label ? label : "all");
+}
+
+#endif // LIBORKH_ALLOC_PROFILING
+
+void liborkh_alloc_free(void* ptr) {
+    liborkh_free(ptr);
+}
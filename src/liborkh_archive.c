@@ -0,0 +1,284 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "liborkh.h"
+#include "liborkh_archive.h"
+
+typedef struct {
+    char name[16];
+    char date[12];
+    char uid[6];
+    char gid[6];
+    char mode[8];
+    char size[10];
+    char fmag[2];
+} __liborkh_ar_header_t;
+
+bool liborkh_is_archive_file(const char* filename) {
+    if (!filename) return false;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    char magic[LIBORKH_AR_MAGIC_SIZE];
+    bool is_archive = read(fd, magic, sizeof(magic)) == (ssize_t) sizeof(magic)
+                   && memcmp(magic, LIBORKH_AR_MAGIC, LIBORKH_AR_MAGIC_SIZE) == 0;
+    close(fd);
+    return is_archive;
+}
+
+static size_t __parse_decimal(const char* field, size_t len) {
+    size_t value = 0;
+    for (size_t i = 0; i < len && field[i] >= '0' && field[i] <= '9'; i++) {
+        value = value * 10 + (size_t) (field[i] - '0');
+    }
+    return value;
+}
+
+static char* __dup_name(const char* name, size_t len) {
+    char* out = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, len + 1);
+    if (!out) return NULL;
+    memcpy(out, name, len);
+    out[len] = '\0';
+    return out;
+}
+
+/**
+ * Resolve the member name from its header: GNU short ("name/"), GNU long ("/<offset>"
+ * in the "//" table) or BSD ("#1/<len>", name stored at the start of the data).
+ */
+static liborkh_status_t __parse_member_name(const __liborkh_ar_header_t* hdr, const uint8_t* data, size_t* data_size, const char* long_names, size_t long_names_size, char** name, size_t* name_skip) {
+    *name_skip = 0;
+
+    if (hdr->name[0] == '/' && hdr->name[1] >= '0' && hdr->name[1] <= '9') {
+        size_t off = __parse_decimal(hdr->name + 1, sizeof(hdr->name) - 1);
+        if (!long_names || off >= long_names_size) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+        size_t len = 0;
+        while (off + len < long_names_size && long_names[off + len] != '\n') len++;
+        if (len > 0 && long_names[off + len - 1] == '/') len--;
+        *name = __dup_name(long_names + off, len);
+    } else if (memcmp(hdr->name, "#1/", 3) == 0) {
+        size_t len = __parse_decimal(hdr->name + 3, sizeof(hdr->name) - 3);
+        LIBORKH_CHECK_CALL(check_bounds(0, len, *data_size), "Truncated BSD member name\n");
+
+        *name = __dup_name((const char*) data, strnlen((const char*) data, len));
+        *name_skip = len;
+        *data_size -= len;
+    } else {
+        size_t len = sizeof(hdr->name);
+        while (len > 0 && hdr->name[len - 1] == ' ') len--;
+        if (len > 0 && hdr->name[len - 1] == '/') len--;
+        *name = __dup_name(hdr->name, len);
+    }
+
+    LIBORKH_CHECK_ALLOC(*name);
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __archive_add_member(liborkh_archive_t* archive, size_t* capacity, char* name, size_t offset, size_t size) {
+    if (archive->count >= *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        liborkh_archive_member_t* tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, archive->members, new_capacity * sizeof(liborkh_archive_member_t));
+        LIBORKH_CHECK_ALLOC(tmp);
+        archive->members = tmp;
+        *capacity = new_capacity;
+    }
+
+    archive->members[archive->count].name   = name;
+    archive->members[archive->count].offset = offset;
+    archive->members[archive->count].size   = size;
+    archive->count++;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __archive_walk(liborkh_archive_t* archive) {
+    const uint8_t* buf = archive->map;
+    size_t size = archive->size;
+    size_t capacity = 0;
+
+    const char* long_names = NULL;
+    size_t long_names_size = 0;
+
+    size_t pos = LIBORKH_AR_MAGIC_SIZE;
+    while (pos + LIBORKH_AR_HEADER_SIZE <= size) {
+        const __liborkh_ar_header_t* hdr = (const __liborkh_ar_header_t*) (buf + pos);
+        if (hdr->fmag[0] != '`' || hdr->fmag[1] != '\n') {
+            liborkh_log_err("Invalid archive member header at offset %zu\n", pos);
+            return LIBORKH_ERROR_ELF;
+        }
+
+        size_t data_off  = pos + LIBORKH_AR_HEADER_SIZE;
+        size_t data_size = __parse_decimal(hdr->size, sizeof(hdr->size));
+        LIBORKH_CHECK_CALL(check_bounds(data_off, data_size, size), "Archive member at offset %zu out of bounds\n", pos);
+
+        size_t next = data_off + data_size + (data_size & 1); // members are 2-byte aligned
+
+        if (memcmp(hdr->name, "// ", 3) == 0) {
+            long_names = (const char*) (buf + data_off);
+            long_names_size = data_size;
+        } else if (memcmp(hdr->name, "/ ", 2) == 0 || memcmp(hdr->name, "/SYM64/", 7) == 0
+                || memcmp(hdr->name, "__.SYMDEF", 9) == 0) {
+            // symbol table
+        } else {
+            char* name = NULL;
+            size_t name_skip = 0;
+            LIBORKH_CHECK_CALL(__parse_member_name(hdr, buf + data_off, &data_size, long_names, long_names_size, &name, &name_skip), "Invalid name for archive member at offset %zu\n", pos);
+
+            liborkh_status_t status = __archive_add_member(archive, &capacity, name, data_off + name_skip, data_size);
+            if (status != LIBORKH_SUCCESS) {
+                liborkh_free(name);
+                return status;
+            }
+        }
+        pos = next;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_archive_open(const char* filename, liborkh_archive_t** archive) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !archive);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        liborkh_log_err("Failed to open file: %s\n", filename);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < LIBORKH_AR_MAGIC_SIZE) {
+        liborkh_log_err("Not an archive: %s\n", filename);
+        close(fd);
+        return LIBORKH_ERROR_ELF;
+    }
+
+    uint8_t* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        liborkh_log_err("Failed to map file: %s\n", filename);
+        return LIBORKH_ERROR_IO;
+    }
+
+    if (memcmp(map, LIBORKH_AR_MAGIC, LIBORKH_AR_MAGIC_SIZE) != 0) {
+        liborkh_log_err("Not an archive (thin archives are not supported): %s\n", filename);
+        munmap(map, st.st_size);
+        return LIBORKH_ERROR_ELF;
+    }
+
+    *archive = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_archive_t));
+    if (!*archive) munmap(map, st.st_size);
+    LIBORKH_CHECK_ALLOC(*archive);
+
+    (*archive)->map  = map;
+    (*archive)->size = st.st_size;
+
+    liborkh_status_t status = __archive_walk(*archive);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_archive_close(*archive);
+        *archive = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_archive_close(liborkh_archive_t* archive) {
+    LIBORKH_CHECK_ARGUMENTS(!archive);
+
+    for (size_t i = 0; i < archive->count; i++) {
+        liborkh_free(archive->members[i].name);
+    }
+    liborkh_free(archive->members);
+    if (archive->map) munmap(archive->map, archive->size);
+    liborkh_free(archive);
+    return LIBORKH_SUCCESS;
+}
+
+
+typedef struct {
+    const liborkh_archive_t* archive;
+    liborkh_entry_filter_t* filter;
+    liborkh_gpu_elf_concurrent_pool_t* pool;
+    liborkh_status_t status; // first member failure
+} __liborkh_archive_scan_t;
+
+typedef struct {
+    liborkh_gpu_elf_concurrent_pool_t* pool;
+    const liborkh_archive_member_t* member;
+    size_t index;
+    liborkh_status_t status;
+} __liborkh_member_visit_t;
+
+// Tag the entry with its member and publish it, keyed by member index
+static liborkh_visit_action_t __member_visitor(liborkh_gpu_elf_entry_t* entry, void* user_data) {
+    __liborkh_member_visit_t* visit = (__liborkh_member_visit_t*) user_data;
+
+    entry->member_offset = visit->member->offset;
+    entry->member_name   = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, visit->member->name);
+    visit->status = entry->member_name ? liborkh_gpu_elf_concurrent_pool_push(visit->pool, visit->index, entry) : LIBORKH_ERROR_OUT_OF_MEMORY;
+    if (visit->status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to add entry to pool\n");
+        return LIBORKH_VISIT_STOP;
+    }
+    return LIBORKH_VISIT_TAKE;
+}
+
+static liborkh_status_t __decode_member(const liborkh_archive_t* archive, size_t index, liborkh_entry_filter_t* filter, liborkh_gpu_elf_concurrent_pool_t* pool) {
+    const liborkh_archive_member_t* member = &archive->members[index];
+    const uint8_t* data = archive->map + member->offset;
+
+    if (member->size < SELFMAG || memcmp(data, ELFMAG, SELFMAG) != 0) {
+        return LIBORKH_SUCCESS; // not an ELF object
+    }
+
+    Elf* elf = elf_memory((char*) data, member->size);
+    if (!elf) {
+        liborkh_log_warn("elf_memory() failed for member %s: %s\n", member->name, elf_errmsg(-1));
+        return LIBORKH_ERROR_ELF;
+    }
+
+    liborkh_offload_buffer fatbin_buf = {0};
+    liborkh_status_t status = liborkh_extract_gpu_fatbin(elf, &fatbin_buf);
+    elf_end(elf);
+    if (status != LIBORKH_SUCCESS || !fatbin_buf.buf) {
+        return status;
+    }
+
+    __liborkh_member_visit_t visit = { pool, member, index, LIBORKH_SUCCESS };
+    status = liborkh_visit_gpu_elfs(&fatbin_buf, filter, __member_visitor, &visit);
+    liborkh_free(fatbin_buf.buf);
+    return status != LIBORKH_SUCCESS ? status : visit.status;
+}
+
+static void __archive_worker(size_t index, void* user_data) {
+    __liborkh_archive_scan_t* scan = (__liborkh_archive_scan_t*) user_data;
+
+    liborkh_status_t status = __decode_member(scan->archive, index, scan->filter, scan->pool);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to decode archive member %s\n", scan->archive->members[index].name);
+        liborkh_status_t expected = LIBORKH_SUCCESS;
+        __atomic_compare_exchange_n(&scan->status, &expected, status, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED);
+    }
+}
+
+liborkh_status_t liborkh_get_gpu_elfs_from_archive(const liborkh_archive_t* archive, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter, size_t num_threads) {
+    LIBORKH_CHECK_ARGUMENTS(!archive || !pool);
+
+    if (archive->count == 0) return LIBORKH_SUCCESS;
+
+    LIBORKH_CHECK_CALL(liborkh_elf_init(), "Cannot decode archive members\n");
+
+    __liborkh_archive_scan_t scan = { archive, filter, NULL, LIBORKH_SUCCESS };
+    LIBORKH_CHECK_CALL(liborkh_gpu_elf_concurrent_pool_init(&scan.pool, archive->count * 4), "Failed to initialize pool\n");
+
+    liborkh_status_t status = liborkh_parallel_for(archive->count, num_threads, __archive_worker, &scan);
+    if (status == LIBORKH_SUCCESS) status = scan.status;
+
+    // Entries are keyed by member index so that the pool content does not depend on scheduling
+    if (status == LIBORKH_SUCCESS) status = liborkh_gpu_elf_concurrent_pool_finalize(scan.pool, pool);
+    liborkh_gpu_elf_concurrent_pool_free(scan.pool);
+    return status;
+}
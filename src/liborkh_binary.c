@@ -0,0 +1,318 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_binary.h"
+
+/**
+ * Keep entries of plain bundles and packager blobs as views of the offload
+ * section, which is mapped for the lifetime of the handle. Images of compressed
+ * bundles only live during the visit and are copied.
+ */
+static liborkh_visit_action_t __binary_visitor(liborkh_gpu_elf_entry_t *entry, void *user_data) {
+    __liborkh_pool_push_ctx_t *ctx = (__liborkh_pool_push_ctx_t *) user_data;
+
+    if (!(entry->flags & LIBORKH_ENTRY_BORROWED_ELF) || (entry->flags & LIBORKH_ENTRY_COMPRESSED)) {
+        return __liborkh_pool_push_visitor(entry, user_data);
+    }
+
+    liborkh_gpu_elf_entry_t *view = NULL;
+    ctx->status = liborkh_new_entry(&view);
+    if (ctx->status != LIBORKH_SUCCESS) return LIBORKH_VISIT_STOP;
+
+    // Move everything to the view, the visited entry is released empty
+    *view = *entry;
+    entry->target_triple = NULL;
+    entry->target_arch   = NULL;
+    entry->member_name   = NULL;
+    entry->elf           = NULL;
+    entry->flags         = 0;
+
+    ctx->status = liborkh_gpu_elf_pool_push(ctx->pool, view);
+    if (ctx->status != LIBORKH_SUCCESS) {
+        liborkh_free_entry(view);
+        return LIBORKH_VISIT_STOP;
+    }
+    return LIBORKH_VISIT_SKIP;
+}
+
+/**
+ * Build the bundle index of the handle once, along with one decode slot per bundle.
+ */
+static liborkh_status_t __bundle_index(liborkh_binary_t* binary, const liborkh_bundle_index_t** index) {
+    if (!__atomic_load_n(&binary->index_state, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&binary->lock);
+        if (!binary->index_state) {
+            binary->index_status = LIBORKH_SUCCESS;
+            if (binary->fatbin.kind != CLANG_OFFLOAD_BUNDLER_KIND || !binary->fatbin.buf) {
+                binary->index_status = LIBORKH_ERROR_SECTION_NOT_FOUND;
+            } else {
+                binary->index_status = liborkh_bundle_index_build(binary->fatbin.buf, binary->fatbin.size, &binary->index);
+            }
+            if (binary->index_status == LIBORKH_SUCCESS) {
+                binary->bundles = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, binary->index->count + 1, sizeof(liborkh_binary_bundle_t));
+                if (!binary->bundles) binary->index_status = LIBORKH_ERROR_OUT_OF_MEMORY;
+            }
+            __atomic_store_n(&binary->index_state, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&binary->lock);
+    }
+
+    *index = binary->index;
+    return binary->index_status;
+}
+
+static liborkh_status_t __binary_open(const char* filename, liborkh_entry_filter_t* filter, bool indexed, liborkh_binary_t** binary) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !binary);
+
+    *binary = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_binary_t));
+    LIBORKH_CHECK_ALLOC(*binary);
+
+    liborkh_binary_t* b = *binary;
+    pthread_mutex_init(&b->lock, NULL);
+
+    liborkh_status_t status = LIBORKH_ERROR_OUT_OF_MEMORY;
+    b->path = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, filename);
+    if (b->path) status = liborkh_open_elf(filename, &b->elf);
+    if (status == LIBORKH_SUCCESS) status = liborkh_elf_section_table_build(b->elf, &b->sections);
+    if (status == LIBORKH_SUCCESS) status = liborkh_get_gpu_fatbin_view(b->elf, &b->fatbin);
+    if (status == LIBORKH_SUCCESS) status = liborkh_gpu_elf_pool_init(&b->pool, 4);
+
+    indexed = indexed && b->fatbin.kind == CLANG_OFFLOAD_BUNDLER_KIND;
+    if (status == LIBORKH_SUCCESS && b->fatbin.buf && !indexed) {
+        __liborkh_pool_push_ctx_t ctx = { b->pool, LIBORKH_SUCCESS };
+        status = liborkh_visit_gpu_elfs(&b->fatbin, filter, __binary_visitor, &ctx);
+        if (status == LIBORKH_SUCCESS) status = ctx.status;
+    }
+
+    if (status == LIBORKH_SUCCESS) {
+        b->infos = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, b->pool->count + 1, sizeof(liborkh_binary_entry_info_t));
+        if (!b->infos) status = LIBORKH_ERROR_OUT_OF_MEMORY;
+    }
+
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to open binary %s\n", filename);
+        liborkh_binary_close(b);
+        *binary = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_binary_open(const char* filename, liborkh_entry_filter_t* filter, liborkh_binary_t** binary) {
+    return __binary_open(filename, filter, false, binary);
+}
+
+liborkh_status_t liborkh_binary_open_indexed(const char* filename, liborkh_binary_t** binary) {
+    liborkh_status_t status = __binary_open(filename, NULL, true, binary);
+    if (status == LIBORKH_SUCCESS && (*binary)->fatbin.kind == CLANG_OFFLOAD_BUNDLER_KIND) {
+        const liborkh_bundle_index_t* index = NULL;
+        status = __bundle_index(*binary, &index);
+        if (status != LIBORKH_SUCCESS) {
+            liborkh_binary_close(*binary);
+            *binary = NULL;
+        }
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_binary_close(liborkh_binary_t* binary) {
+    LIBORKH_CHECK_ARGUMENTS(!binary);
+
+    // Views point into the mapping, release the entries before closing the ELF
+    if (binary->pool) liborkh_gpu_elf_pool_free(binary->pool);
+    for (size_t i = 0; binary->bundles && i < binary->index->count; i++) {
+        if (binary->bundles[i].pool) liborkh_gpu_elf_pool_free(binary->bundles[i].pool);
+    }
+    if (binary->sections) liborkh_elf_section_table_free(binary->sections);
+    if (binary->elf) liborkh_close_elf(binary->elf);
+    liborkh_free(binary->infos);
+    liborkh_free(binary->bundles);
+    if (binary->index) liborkh_bundle_index_free(binary->index);
+    liborkh_free(binary->path);
+    pthread_mutex_destroy(&binary->lock);
+    liborkh_free(binary);
+    return LIBORKH_SUCCESS;
+}
+
+size_t liborkh_binary_get_number_entries(const liborkh_binary_t* binary) {
+    return binary ? binary->pool->count : 0;
+}
+
+liborkh_status_t liborkh_binary_get_entry(liborkh_binary_t* binary, size_t index, const liborkh_gpu_elf_entry_t** entry) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !entry || index >= binary->pool->count);
+
+    *entry = binary->pool->entries[index];
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_binary_get_section(liborkh_binary_t* binary, const char* name, const uint8_t** data, size_t* size) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !name || !data || !size);
+
+    // elf_getdata() loads the section data lazily on the shared Elf, it is not thread-safe
+    pthread_mutex_lock(&binary->lock);
+    liborkh_status_t status = liborkh_elf_section_table_get_data(binary->sections, name, data, size);
+    pthread_mutex_unlock(&binary->lock);
+    return status;
+}
+
+/**
+ * Locate the first note of the ".note" section of a GPU ELF and return the
+ * position of its descriptor in the image, without copying it.
+ */
+static liborkh_status_t __locate_metadata(const liborkh_gpu_elf_entry_t* entry, size_t* offset, size_t* size) {
+    Elf* elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &elf), "Cannot open ELF from memory\n");
+
+    size_t shstrndx = 0;
+    Elf_Scn* scn = NULL;
+    GElf_Shdr shdr;
+    liborkh_status_t status = LIBORKH_ERROR_SECTION_NOT_FOUND;
+
+    if (elf_getshdrstrndx(elf, &shstrndx) != 0) {
+        liborkh_close_elf(elf);
+        return LIBORKH_ERROR_ELF;
+    }
+
+    while ((scn = elf_nextscn(elf, scn)) != NULL) {
+        if (gelf_getshdr(scn, &shdr) != &shdr) {
+            status = LIBORKH_ERROR_ELF;
+            break;
+        }
+        const char* name = elf_strptr(elf, shstrndx, shdr.sh_name);
+        if (!name || strcmp(name, ".note") != 0) continue;
+
+        status = check_bounds(shdr.sh_offset, shdr.sh_size, entry->elf_size);
+        if (status != LIBORKH_SUCCESS || shdr.sh_size < sizeof(uint32_t) * 3) {
+            status = LIBORKH_ERROR_OUT_OF_BOUNDS;
+            break;
+        }
+
+        size_t pos = shdr.sh_offset;
+        uint32_t namesz = read_u32(entry->elf, &pos);
+        uint32_t descsz = read_u32(entry->elf, &pos);
+        pos += sizeof(uint32_t); // type
+        pos += ((size_t) namesz + 3) & ~(size_t) 3;
+
+        status = check_bounds(pos, descsz, shdr.sh_offset + shdr.sh_size);
+        *offset = pos;
+        *size   = descsz;
+        break;
+    }
+
+    liborkh_close_elf(elf);
+    return status;
+}
+
+/**
+ * Compute the derived results of one entry once. Readers that see state == 1
+ * (acquire) see the results; the computation itself is serialized by the lock.
+ */
+static liborkh_binary_entry_info_t* __entry_info(liborkh_binary_t* binary, size_t index) {
+    liborkh_binary_entry_info_t* info = &binary->infos[index];
+    if (__atomic_load_n(&info->state, __ATOMIC_ACQUIRE)) return info;
+
+    pthread_mutex_lock(&binary->lock);
+    if (!info->state) {
+        const liborkh_gpu_elf_entry_t* entry = binary->pool->entries[index];
+
+        if (!entry->elf || entry->elf_size == 0) {
+            info->status = LIBORKH_SUCCESS; // no image, no kernels
+        } else {
+            info->status = __locate_metadata(entry, &info->metadata_offset, &info->metadata_size);
+            if (info->status == LIBORKH_SUCCESS && info->metadata_size > 0) {
+                info->status = liborkh_get_number_kernels(entry->elf + info->metadata_offset, info->metadata_size, &info->num_kernels);
+            }
+        }
+        __atomic_store_n(&info->state, 1, __ATOMIC_RELEASE);
+    }
+    pthread_mutex_unlock(&binary->lock);
+    return info;
+}
+
+liborkh_status_t liborkh_binary_get_metadata(liborkh_binary_t* binary, size_t index, const uint8_t** metadata, size_t* size) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !metadata || !size || index >= binary->pool->count);
+
+    const liborkh_binary_entry_info_t* info = __entry_info(binary, index);
+    LIBORKH_CHECK_CALL(info->status, "Cannot get kernel metadata of entry %zu\n", index);
+
+    *metadata = info->metadata_size ? binary->pool->entries[index]->elf + info->metadata_offset : NULL;
+    *size = info->metadata_size;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_binary_get_number_kernels(liborkh_binary_t* binary, size_t index, size_t* num_kernels) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !num_kernels || index >= binary->pool->count);
+
+    const liborkh_binary_entry_info_t* info = __entry_info(binary, index);
+    LIBORKH_CHECK_CALL(info->status, "Cannot count kernels of entry %zu\n", index);
+
+    *num_kernels = info->num_kernels;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_binary_get_total_number_kernels(liborkh_binary_t* binary, size_t* num_kernels) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !num_kernels);
+
+    if (!__atomic_load_n(&binary->total_state, __ATOMIC_ACQUIRE)) {
+        size_t total = 0;
+        for (size_t i = 0; i < binary->pool->count; i++) {
+            size_t count = 0;
+            LIBORKH_CHECK_CALL(liborkh_binary_get_number_kernels(binary, i, &count), "Cannot count kernels of %s\n", binary->path);
+            total += count;
+        }
+
+        // Every thread computes the same value, the first store wins
+        pthread_mutex_lock(&binary->lock);
+        if (!binary->total_state) {
+            binary->total_kernels = total;
+            __atomic_store_n(&binary->total_state, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&binary->lock);
+    }
+
+    *num_kernels = binary->total_kernels;
+    return LIBORKH_SUCCESS;
+}
+
+static const liborkh_gpu_elf_entry_t* __find_arch(const liborkh_gpu_elf_pool_t* pool, size_t bundle_id, const char* arch) {
+    for (size_t i = 0; i < pool->count; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        if (entry->id != bundle_id || entry->ofk == OFK_HOST) continue;
+        if (!arch || (entry->target_arch && strcmp(entry->target_arch, arch) == 0)) return entry;
+    }
+    return NULL;
+}
+
+liborkh_status_t liborkh_binary_get_bundle_entry(liborkh_binary_t* binary, size_t bundle_id, const char* arch, const liborkh_gpu_elf_entry_t** entry) {
+    LIBORKH_CHECK_ARGUMENTS(!binary || !entry);
+
+    *entry = NULL;
+    if (binary->fatbin.kind != CLANG_OFFLOAD_BUNDLER_KIND) {
+        *entry = __find_arch(binary->pool, bundle_id, arch); // packager entries are all decoded at open
+        return LIBORKH_SUCCESS;
+    }
+
+    const liborkh_bundle_index_t* index = NULL;
+    LIBORKH_CHECK_CALL(__bundle_index(binary, &index), "Cannot index the bundles of %s\n", binary->path);
+    if (bundle_id >= index->count) return LIBORKH_SUCCESS;
+
+    liborkh_binary_bundle_t* bundle = &binary->bundles[bundle_id];
+    if (!__atomic_load_n(&bundle->state, __ATOMIC_ACQUIRE)) {
+        pthread_mutex_lock(&binary->lock);
+        if (!bundle->state) {
+            bundle->status = liborkh_gpu_elf_pool_init(&bundle->pool, 4);
+            if (bundle->status == LIBORKH_SUCCESS) {
+                __liborkh_pool_push_ctx_t ctx = { bundle->pool, LIBORKH_SUCCESS };
+                bundle->status = liborkh_bundle_index_visit(binary->fatbin.buf, binary->fatbin.size, index, bundle_id, NULL, __binary_visitor, &ctx);
+                if (bundle->status == LIBORKH_SUCCESS) bundle->status = ctx.status;
+            }
+            __atomic_store_n(&bundle->state, 1, __ATOMIC_RELEASE);
+        }
+        pthread_mutex_unlock(&binary->lock);
+    }
+    LIBORKH_CHECK_CALL(bundle->status, "Cannot decode bundle %zu of %s\n", bundle_id, binary->path);
+
+    *entry = __find_arch(bundle->pool, bundle_id, arch);
+    return LIBORKH_SUCCESS;
+}
@@ -0,0 +1,247 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/mman.h>
+
+#include "liborkh_budget.h"
+#include "liborkh_stats.h"
+
+// Header in front of every budgeted buffer, so that it can be released from any thread
+typedef struct {
+    liborkh_budget_t* budget;
+    uint64_t size;
+    uint32_t stage;
+    uint32_t spilled;
+    _Alignas(16) uint8_t data[];
+} __liborkh_budget_block_t;
+
+#define __liborkh_budget_block_of(ptr) ((__liborkh_budget_block_t*) ((uint8_t*) (ptr) - offsetof(__liborkh_budget_block_t, data)))
+
+static __thread liborkh_budget_t* __bound_budget = NULL;
+static __thread size_t            __thread_transient = 0; // transient bytes reserved by this thread
+static liborkh_budget_t           __process_budget;
+static bool                       __process_budget_enabled = false;
+
+liborkh_status_t liborkh_budget_init(liborkh_budget_t* budget, size_t limit) {
+    LIBORKH_CHECK_ARGUMENTS(!budget);
+
+    memset(budget, 0, sizeof(*budget));
+    budget->limit           = limit;
+    budget->spill_threshold = LIBORKH_BUDGET_DEFAULT_SPILL_THRESHOLD;
+    budget->wait_ms         = LIBORKH_BUDGET_DEFAULT_WAIT_MS;
+
+    if (pthread_mutex_init(&budget->lock, NULL) != 0) return LIBORKH_ERROR_UNKNOWN;
+    if (pthread_cond_init(&budget->released, NULL) != 0) {
+        pthread_mutex_destroy(&budget->lock);
+        return LIBORKH_ERROR_UNKNOWN;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_budget_destroy(liborkh_budget_t* budget) {
+    LIBORKH_CHECK_ARGUMENTS(!budget);
+
+    if (budget->used > 0) {
+        liborkh_log_warn("Memory budget destroyed with %zu bytes still accounted\n", budget->used);
+    }
+    pthread_cond_destroy(&budget->released);
+    pthread_mutex_destroy(&budget->lock);
+    return LIBORKH_SUCCESS;
+}
+
+void liborkh_budget_bind(liborkh_budget_t* budget) {
+    __bound_budget = budget;
+}
+
+liborkh_budget_t* liborkh_budget_current(void) {
+    if (__bound_budget) return __bound_budget;
+    return __process_budget_enabled ? &__process_budget : NULL;
+}
+
+static void __deadline(struct timespec* ts, uint32_t wait_ms) {
+    clock_gettime(CLOCK_REALTIME, ts);
+    ts->tv_sec  += wait_ms / 1000;
+    ts->tv_nsec += (long) (wait_ms % 1000) * 1000000L;
+    if (ts->tv_nsec >= 1000000000L) {
+        ts->tv_sec++;
+        ts->tv_nsec -= 1000000000L;
+    }
+}
+
+/**
+ * Reserve size heap bytes. Buffers below the spill threshold wait (up to wait_ms)
+ * while other threads hold in-flight decompressions that will be released soon.
+ * @return false when the buffer has to be spilled
+ */
+static bool __reserve(liborkh_budget_t* budget, size_t size, bool transient) {
+    bool reserved = false;
+    bool waiting = false;
+    struct timespec deadline;
+
+    pthread_mutex_lock(&budget->lock);
+    LIBORKH_STATS_TIMER_START(wait_timer);
+
+    for (;;) {
+        if (budget->limit == 0 || (budget->used + size >= budget->used && budget->used + size <= budget->limit)) {
+            budget->used += size;
+            if (transient) {
+                budget->transient += size;
+                __thread_transient += size;
+            }
+            if (budget->used > budget->peak) budget->peak = budget->used;
+            reserved = true;
+            break;
+        }
+
+        size_t others = budget->transient > __thread_transient ? budget->transient - __thread_transient : 0;
+        if (size >= budget->spill_threshold || others == 0 || budget->wait_ms == 0) break;
+
+        if (!waiting) {
+            waiting = true;
+            __deadline(&deadline, budget->wait_ms);
+        }
+        if (pthread_cond_timedwait(&budget->released, &budget->lock, &deadline) == ETIMEDOUT) break;
+    }
+
+    pthread_mutex_unlock(&budget->lock);
+
+    if (waiting) {
+        LIBORKH_STATS_ADD(budget_waits, 1, size);
+        LIBORKH_STATS_TIMER_STOP(budget_waits, wait_timer);
+    }
+    return reserved;
+}
+
+static void __release(liborkh_budget_t* budget, size_t size, bool transient) {
+    pthread_mutex_lock(&budget->lock);
+    budget->used -= size;
+    if (transient) {
+        budget->transient -= size;
+        __thread_transient = __thread_transient >= size ? __thread_transient - size : 0;
+    }
+    pthread_cond_broadcast(&budget->released);
+    pthread_mutex_unlock(&budget->lock);
+}
+
+static const char* __spill_dir(const liborkh_budget_t* budget) {
+    if (budget && budget->spill_dir) return budget->spill_dir;
+
+    const char* dir = getenv(LIBORKH_BUDGET_SPILL_DIR_ENV);
+    if (!dir || !dir[0]) dir = getenv("TMPDIR");
+    return dir && dir[0] ? dir : "/tmp";
+}
+
+/**
+ * Map an unlinked temporary file of the given size. The file disappears with
+ * its last mapping, nothing is left behind if the process dies.
+ */
+static void* __spill_map(const liborkh_budget_t* budget, size_t size) {
+    const char* dir = __spill_dir(budget);
+
+    int fd = open(dir, O_TMPFILE | O_RDWR | O_EXCL | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        // O_TMPFILE is not supported by every file system
+        char path[PATH_MAX];
+        snprintf(path, sizeof(path), "%s/liborkh-spill-XXXXXX", dir);
+        fd = mkstemp(path);
+        if (fd >= 0) unlink(path);
+    }
+    if (fd < 0) {
+        liborkh_log_err("Failed to create a spill file in %s\n", dir);
+        return NULL;
+    }
+
+    // Allocate the blocks now: a full disk must fail here, not with SIGBUS when writing
+    int err = posix_fallocate(fd, 0, (off_t) size);
+    if (err != 0) {
+        liborkh_log_err("Failed to allocate %zu bytes of spill file in %s: %s\n", size, dir, strerror(err));
+        close(fd);
+        return NULL;
+    }
+
+    void* map = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        liborkh_log_err("Failed to map spill file\n");
+        return NULL;
+    }
+    return map;
+}
+
+void* liborkh_budget_alloc(liborkh_alloc_stage_t stage, size_t size) {
+    if (size > SIZE_MAX - sizeof(__liborkh_budget_block_t)) return NULL;
+
+    liborkh_budget_t* budget = liborkh_budget_current();
+    bool transient = stage == LIBORKH_ALLOC_STAGE_DECOMPRESS;
+    bool spilled = budget && !__reserve(budget, size, transient);
+
+    size_t total = sizeof(__liborkh_budget_block_t) + size;
+    __liborkh_budget_block_t* block = spilled ? __spill_map(budget, total) : liborkh_malloc(stage, total);
+    if (!block) {
+        if (budget && !spilled) __release(budget, size, transient);
+        return NULL;
+    }
+
+    if (spilled) {
+        pthread_mutex_lock(&budget->lock);
+        budget->num_spilled++;
+        budget->spilled_bytes += size;
+        pthread_mutex_unlock(&budget->lock);
+        LIBORKH_STATS_ADD(spilled, 1, size);
+    }
+
+    block->budget  = budget;
+    block->size    = size;
+    block->stage   = (uint32_t) stage;
+    block->spilled = spilled;
+    return block->data;
+}
+
+void liborkh_budget_free(void* ptr) {
+    if (!ptr) return;
+
+    __liborkh_budget_block_t* block = __liborkh_budget_block_of(ptr);
+    liborkh_budget_t* budget = block->budget;
+    size_t size = block->size;
+    bool transient = block->stage == LIBORKH_ALLOC_STAGE_DECOMPRESS;
+
+    if (block->spilled) {
+        munmap(block, sizeof(__liborkh_budget_block_t) + size);
+        return;
+    }
+
+    liborkh_free(block);
+    if (budget) __release(budget, size, transient);
+}
+
+bool liborkh_budget_is_spilled(const void* ptr) {
+    return ptr && __liborkh_budget_block_of(ptr)->spilled;
+}
+
+static size_t __parse_size(const char* str) {
+    char* end = NULL;
+    unsigned long long value = strtoull(str, &end, 10);
+    switch (end ? *end : '\0') {
+        case 'k': case 'K': value <<= 10; break;
+        case 'm': case 'M': value <<= 20; break;
+        case 'g': case 'G': value <<= 30; break;
+        default: break;
+    }
+    return (size_t) value;
+}
+
+__attribute__((constructor))
+static void __liborkh_budget_init(void) {
+    const char* env = getenv(LIBORKH_BUDGET_ENV);
+    if (!env || !env[0]) return;
+
+    size_t limit = __parse_size(env);
+    if (limit > 0 && liborkh_budget_init(&__process_budget, limit) == LIBORKH_SUCCESS) {
+        __process_budget_enabled = true;
+    }
+}
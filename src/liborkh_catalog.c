@@ -0,0 +1,484 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_catalog.h"
+
+#define __LIBORKH_MSGPACK_MAX_DEPTH 32
+
+static const char* __column_names[LIBORKH_CATALOG_COLUMN_COUNT] = {
+    [LIBORKH_CATALOG_SGPR]      = "sgpr",
+    [LIBORKH_CATALOG_VGPR]      = "vgpr",
+    [LIBORKH_CATALOG_AGPR]      = "agpr",
+    [LIBORKH_CATALOG_LDS]       = "lds",
+    [LIBORKH_CATALOG_SCRATCH]   = "scratch",
+    [LIBORKH_CATALOG_KERNARG]   = "kernarg",
+    [LIBORKH_CATALOG_WAVEFRONT] = "wavefront",
+};
+
+// Metadata key of each numeric column
+static const char* __column_keys[LIBORKH_CATALOG_COLUMN_COUNT] = {
+    [LIBORKH_CATALOG_SGPR]      = ".sgpr_count",
+    [LIBORKH_CATALOG_VGPR]      = ".vgpr_count",
+    [LIBORKH_CATALOG_AGPR]      = ".agpr_count",
+    [LIBORKH_CATALOG_LDS]       = ".group_segment_fixed_size",
+    [LIBORKH_CATALOG_SCRATCH]   = ".private_segment_fixed_size",
+    [LIBORKH_CATALOG_KERNARG]   = ".kernarg_segment_size",
+    [LIBORKH_CATALOG_WAVEFRONT] = ".wavefront_size",
+};
+
+const char* liborkh_catalog_column_to_string(liborkh_catalog_column_t column) {
+    return column < LIBORKH_CATALOG_COLUMN_COUNT ? __column_names[column] : "unknown";
+}
+
+
+// -------------- Minimal msgpack reader --------------
+
+typedef struct {
+    const uint8_t* p;
+    const uint8_t* end;
+} __liborkh_msgpack_t;
+
+static bool __mp_be(__liborkh_msgpack_t* mp, size_t n, uint64_t* out) {
+    if ((size_t) (mp->end - mp->p) < n) return false;
+    uint64_t v = 0;
+    for (size_t i = 0; i < n; i++) v = (v << 8) | mp->p[i];
+    mp->p += n;
+    *out = v;
+    return true;
+}
+
+static bool __mp_advance(__liborkh_msgpack_t* mp, uint64_t n) {
+    if ((uint64_t) (mp->end - mp->p) < n) return false;
+    mp->p += n;
+    return true;
+}
+
+static bool __mp_read_str(__liborkh_msgpack_t* mp, const char** str, uint32_t* len) {
+    if (mp->p >= mp->end) return false;
+    uint8_t b = *mp->p++;
+    uint64_t n = 0;
+
+    if ((b & 0xe0) == 0xa0)  n = b & 0x1f;
+    else if (b == 0xd9)      { if (!__mp_be(mp, 1, &n)) return false; }
+    else if (b == 0xda)      { if (!__mp_be(mp, 2, &n)) return false; }
+    else if (b == 0xdb)      { if (!__mp_be(mp, 4, &n)) return false; }
+    else return false;
+
+    *str = (const char*) mp->p;
+    *len = (uint32_t) n;
+    return __mp_advance(mp, n);
+}
+
+static bool __mp_read_container(__liborkh_msgpack_t* mp, bool map, uint32_t* count) {
+    if (mp->p >= mp->end) return false;
+    uint8_t b = *mp->p++;
+    uint64_t n = 0;
+
+    if (map && (b & 0xf0) == 0x80)        n = b & 0x0f;
+    else if (!map && (b & 0xf0) == 0x90)  n = b & 0x0f;
+    else if (b == (map ? 0xde : 0xdc))    { if (!__mp_be(mp, 2, &n)) return false; }
+    else if (b == (map ? 0xdf : 0xdd))    { if (!__mp_be(mp, 4, &n)) return false; }
+    else return false;
+
+    *count = (uint32_t) n;
+    return true;
+}
+
+// Unsigned value; negative and non integer values are rejected
+static bool __mp_read_uint(__liborkh_msgpack_t* mp, uint64_t* value) {
+    if (mp->p >= mp->end) return false;
+    uint8_t b = *mp->p++;
+
+    if (b <= 0x7f) {
+        *value = b;
+        return true;
+    }
+    switch (b) {
+        case 0xcc: case 0xd0: return __mp_be(mp, 1, value) && (b == 0xcc || !(*value & 0x80));
+        case 0xcd: case 0xd1: return __mp_be(mp, 2, value) && (b == 0xcd || !(*value & 0x8000));
+        case 0xce: case 0xd2: return __mp_be(mp, 4, value) && (b == 0xce || !(*value & 0x80000000u));
+        case 0xcf: case 0xd3: return __mp_be(mp, 8, value) && (b == 0xcf || !(*value >> 63));
+        default: return false;
+    }
+}
+
+static bool __mp_skip(__liborkh_msgpack_t* mp, int depth) {
+    if (mp->p >= mp->end || depth > __LIBORKH_MSGPACK_MAX_DEPTH) return false;
+    uint8_t b = *mp->p;
+    uint64_t n = 0;
+
+    if (b <= 0x7f || b >= 0xe0 || b == 0xc0 || b == 0xc2 || b == 0xc3) return __mp_advance(mp, 1);
+
+    if ((b & 0xe0) == 0xa0 || (b >= 0xd9 && b <= 0xdb)) {
+        const char* str;
+        uint32_t len;
+        return __mp_read_str(mp, &str, &len);
+    }
+
+    if ((b & 0xf0) == 0x80 || (b & 0xf0) == 0x90 || (b >= 0xdc && b <= 0xdf)) {
+        bool map = (b & 0xf0) == 0x80 || b == 0xde || b == 0xdf;
+        uint32_t count = 0;
+        if (!__mp_read_container(mp, map, &count)) return false;
+        for (uint64_t i = 0; i < (uint64_t) count * (map ? 2 : 1); i++) {
+            if (!__mp_skip(mp, depth + 1)) return false;
+        }
+        return true;
+    }
+
+    mp->p++;
+    switch (b) {
+        case 0xc4: return __mp_be(mp, 1, &n) && __mp_advance(mp, n);          // bin
+        case 0xc5: return __mp_be(mp, 2, &n) && __mp_advance(mp, n);
+        case 0xc6: return __mp_be(mp, 4, &n) && __mp_advance(mp, n);
+        case 0xc7: return __mp_be(mp, 1, &n) && __mp_advance(mp, n + 1);      // ext
+        case 0xc8: return __mp_be(mp, 2, &n) && __mp_advance(mp, n + 1);
+        case 0xc9: return __mp_be(mp, 4, &n) && __mp_advance(mp, n + 1);
+        case 0xca: return __mp_advance(mp, 4);                                 // float
+        case 0xcb: return __mp_advance(mp, 8);
+        case 0xcc: case 0xd0: return __mp_advance(mp, 1);                      // int
+        case 0xcd: case 0xd1: return __mp_advance(mp, 2);
+        case 0xce: case 0xd2: return __mp_advance(mp, 4);
+        case 0xcf: case 0xd3: return __mp_advance(mp, 8);
+        case 0xd4: return __mp_advance(mp, 2);                                 // fixext
+        case 0xd5: return __mp_advance(mp, 3);
+        case 0xd6: return __mp_advance(mp, 5);
+        case 0xd7: return __mp_advance(mp, 9);
+        case 0xd8: return __mp_advance(mp, 17);
+        default: return false;
+    }
+}
+
+static bool __mp_key_is(const char* str, uint32_t len, const char* key) {
+    return strlen(key) == len && memcmp(str, key, len) == 0;
+}
+
+
+// -------------- Catalog storage --------------
+
+liborkh_status_t liborkh_catalog_init(liborkh_catalog_t** catalog) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog);
+
+    *catalog = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_catalog_t));
+    LIBORKH_CHECK_ALLOC(*catalog);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_catalog_free(liborkh_catalog_t* catalog) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog);
+
+    liborkh_free(catalog->name);
+    liborkh_free(catalog->entry_id);
+    for (int i = 0; i < LIBORKH_CATALOG_DICT_COUNT; i++) {
+        liborkh_free(catalog->codes[i]);
+        for (size_t j = 0; j < catalog->dicts[i].count; j++) liborkh_free(catalog->dicts[i].values[j]);
+        liborkh_free(catalog->dicts[i].values);
+    }
+    for (int i = 0; i < LIBORKH_CATALOG_COLUMN_COUNT; i++) liborkh_free(catalog->columns[i]);
+    liborkh_free(catalog->names);
+    liborkh_free(catalog);
+    return LIBORKH_SUCCESS;
+}
+
+#define __liborkh_grow_column(ptr, capacity)                                                    \
+    do {                                                                                        \
+        void* __tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, ptr, (capacity) * sizeof(*(ptr))); \
+        LIBORKH_CHECK_ALLOC(__tmp);                                                             \
+        ptr = __tmp;                                                                            \
+    } while (0)
+
+static liborkh_status_t __reserve_row(liborkh_catalog_t* catalog) {
+    if (catalog->count < catalog->capacity) return LIBORKH_SUCCESS;
+
+    size_t capacity = catalog->capacity ? catalog->capacity * 2 : 64;
+    __liborkh_grow_column(catalog->name, capacity);
+    __liborkh_grow_column(catalog->entry_id, capacity);
+    for (int i = 0; i < LIBORKH_CATALOG_DICT_COUNT; i++) __liborkh_grow_column(catalog->codes[i], capacity);
+    for (int i = 0; i < LIBORKH_CATALOG_COLUMN_COUNT; i++) __liborkh_grow_column(catalog->columns[i], capacity);
+    catalog->capacity = capacity;
+    return LIBORKH_SUCCESS;
+}
+
+// Dictionaries hold a handful of values (architectures, files), a linear search is enough
+static liborkh_status_t __dict_code(liborkh_catalog_dictionary_t* dict, const char* value, uint32_t* code) {
+    if (!value) value = "";
+
+    for (size_t i = 0; i < dict->count; i++) {
+        if (strcmp(dict->values[i], value) == 0) {
+            *code = (uint32_t) i;
+            return LIBORKH_SUCCESS;
+        }
+    }
+
+    if (dict->count == dict->capacity) {
+        size_t capacity = dict->capacity ? dict->capacity * 2 : 8;
+        __liborkh_grow_column(dict->values, capacity);
+        dict->capacity = capacity;
+    }
+    dict->values[dict->count] = liborkh_strdup(LIBORKH_ALLOC_STAGE_POOL, value);
+    LIBORKH_CHECK_ALLOC(dict->values[dict->count]);
+    *code = (uint32_t) dict->count++;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __add_name(liborkh_catalog_t* catalog, const char* name, uint32_t len, uint32_t* offset) {
+    size_t needed = catalog->names_size + len + 1;
+    if (needed > UINT32_MAX) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    if (needed > catalog->names_capacity) {
+        size_t capacity = catalog->names_capacity ? catalog->names_capacity : 4096;
+        while (capacity < needed) capacity *= 2;
+        __liborkh_grow_column(catalog->names, capacity);
+        catalog->names_capacity = capacity;
+    }
+
+    *offset = (uint32_t) catalog->names_size;
+    memcpy(catalog->names + catalog->names_size, name, len);
+    catalog->names[catalog->names_size + len] = '\0';
+    catalog->names_size = needed;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __add_kernel(liborkh_catalog_t* catalog, __liborkh_msgpack_t* mp, uint64_t entry_id, const uint32_t codes[LIBORKH_CATALOG_DICT_COUNT]) {
+    uint32_t num_fields = 0;
+    if (!__mp_read_container(mp, true, &num_fields)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+
+    LIBORKH_CHECK_CALL(__reserve_row(catalog), "Cannot grow kernel catalog\n");
+    size_t row = catalog->count;
+
+    const char* name = "";
+    uint32_t name_len = 0;
+    for (int i = 0; i < LIBORKH_CATALOG_COLUMN_COUNT; i++) catalog->columns[i][row] = 0;
+
+    for (uint32_t f = 0; f < num_fields; f++) {
+        const char* key;
+        uint32_t key_len;
+        if (!__mp_read_str(mp, &key, &key_len)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+
+        int column = -1;
+        for (int i = 0; i < LIBORKH_CATALOG_COLUMN_COUNT && column < 0; i++) {
+            if (__mp_key_is(key, key_len, __column_keys[i])) column = i;
+        }
+
+        // Values of an unexpected type are skipped, the column keeps its default
+        const uint8_t* value_start = mp->p;
+        uint64_t value = 0;
+        if (__mp_key_is(key, key_len, ".name") && __mp_read_str(mp, &name, &name_len)) continue;
+        if (column >= 0 && __mp_read_uint(mp, &value)) {
+            catalog->columns[column][row] = value > UINT32_MAX ? UINT32_MAX : (uint32_t) value;
+            continue;
+        }
+
+        mp->p = value_start;
+        if (!__mp_skip(mp, 0)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+    }
+
+    LIBORKH_CHECK_CALL(__add_name(catalog, name, name_len, &catalog->name[row]), "Kernel name table is full\n");
+    catalog->entry_id[row] = entry_id;
+    for (int i = 0; i < LIBORKH_CATALOG_DICT_COUNT; i++) catalog->codes[i][row] = codes[i];
+    catalog->count++;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __add_metadata(liborkh_catalog_t* catalog, const uint8_t* metadata, size_t size, uint64_t entry_id, const uint32_t codes[LIBORKH_CATALOG_DICT_COUNT]) {
+    __liborkh_msgpack_t mp = { metadata, metadata + size };
+
+    uint32_t num_keys = 0;
+    if (!__mp_read_container(&mp, true, &num_keys)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+
+    for (uint32_t k = 0; k < num_keys; k++) {
+        const char* key;
+        uint32_t key_len;
+        if (!__mp_read_str(&mp, &key, &key_len)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+
+        if (!__mp_key_is(key, key_len, LIBORKH_AMDHSAMETADATA_KEY)) {
+            if (!__mp_skip(&mp, 0)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+            continue;
+        }
+
+        uint32_t num_kernels = 0;
+        if (!__mp_read_container(&mp, false, &num_kernels)) return LIBORKH_ERROR_METADATA_NOT_FOUND;
+        for (uint32_t i = 0; i < num_kernels; i++) {
+            LIBORKH_CHECK_CALL(__add_kernel(catalog, &mp, entry_id, codes), "Invalid metadata of kernel %u\n", i);
+        }
+        return LIBORKH_SUCCESS;
+    }
+    return LIBORKH_SUCCESS; // code object without kernels
+}
+
+liborkh_status_t liborkh_catalog_add_pool(liborkh_catalog_t* catalog, const liborkh_gpu_elf_pool_t* pool, const char* source) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !pool);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        if (!entry->elf || entry->elf_size == 0) continue;
+
+        uint32_t codes[LIBORKH_CATALOG_DICT_COUNT];
+        LIBORKH_CHECK_CALL(__dict_code(&catalog->dicts[LIBORKH_CATALOG_ARCH], entry->target_arch, &codes[LIBORKH_CATALOG_ARCH]), "Cannot add architecture\n");
+        LIBORKH_CHECK_CALL(__dict_code(&catalog->dicts[LIBORKH_CATALOG_SOURCE], source ? source : entry->member_name, &codes[LIBORKH_CATALOG_SOURCE]), "Cannot add source\n");
+
+        Elf* gpu_elf = NULL;
+        LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &gpu_elf), "Cannot open ELF from memory\n");
+
+        uint8_t* metadata = NULL;
+        size_t metadata_size = 0;
+        liborkh_status_t status = liborkh_get_kernels_metadata(gpu_elf, &metadata, &metadata_size);
+        liborkh_close_elf(gpu_elf);
+        LIBORKH_CHECK_CALL(status, "Cannot get kernel metadata of entry %zu\n", entry->id);
+
+        status = __add_metadata(catalog, metadata, metadata_size, entry->id, codes);
+        liborkh_free(metadata);
+        LIBORKH_CHECK_CALL(status, "Cannot parse kernel metadata of entry %zu\n", entry->id);
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_catalog_add_file(liborkh_catalog_t* catalog, const char* filename, liborkh_entry_filter_t* filter) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !filename);
+
+    liborkh_binary_t* binary = NULL;
+    LIBORKH_CHECK_CALL(liborkh_binary_open(filename, filter, &binary), "Cannot open %s\n", filename);
+
+    liborkh_status_t status = liborkh_catalog_add_pool(catalog, binary->pool, filename);
+    liborkh_binary_close(binary);
+    return status;
+}
+
+
+// -------------- Query primitives --------------
+
+liborkh_status_t liborkh_catalog_mask_init(const liborkh_catalog_t* catalog, uint8_t** mask) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !mask);
+
+    *mask = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, catalog->count + 1);
+    LIBORKH_CHECK_ALLOC(*mask);
+    memset(*mask, 1, catalog->count);
+    return LIBORKH_SUCCESS;
+}
+
+// One branch free loop per operator, compilers vectorize each of them
+#define __liborkh_filter_loop(expr)                                                 \
+    for (size_t i = 0; i < n; i++) mask[i] &= (uint8_t) (expr);
+
+liborkh_status_t liborkh_catalog_filter(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, liborkh_catalog_op_t op, uint32_t value, uint8_t* mask) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !mask || column >= LIBORKH_CATALOG_COLUMN_COUNT);
+
+    const uint32_t* restrict col = catalog->columns[column];
+    size_t n = catalog->count;
+
+    switch (op) {
+        case LIBORKH_CATALOG_EQ: __liborkh_filter_loop(col[i] == value); break;
+        case LIBORKH_CATALOG_NE: __liborkh_filter_loop(col[i] != value); break;
+        case LIBORKH_CATALOG_LT: __liborkh_filter_loop(col[i] <  value); break;
+        case LIBORKH_CATALOG_LE: __liborkh_filter_loop(col[i] <= value); break;
+        case LIBORKH_CATALOG_GT: __liborkh_filter_loop(col[i] >  value); break;
+        case LIBORKH_CATALOG_GE: __liborkh_filter_loop(col[i] >= value); break;
+        default: return LIBORKH_ERROR_INVALID_ARGUMENT;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_catalog_filter_string(const liborkh_catalog_t* catalog, liborkh_catalog_dict_t dict, const char* value, uint8_t* mask) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !value || !mask || dict >= LIBORKH_CATALOG_DICT_COUNT);
+
+    // Compare codes, not strings; an unknown value matches no row
+    uint32_t code = UINT32_MAX;
+    for (size_t i = 0; i < catalog->dicts[dict].count; i++) {
+        if (strcmp(catalog->dicts[dict].values[i], value) == 0) code = (uint32_t) i;
+    }
+
+    const uint32_t* restrict codes = catalog->codes[dict];
+    size_t n = catalog->count;
+    __liborkh_filter_loop(codes[i] == code);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_catalog_group_by(const liborkh_catalog_t* catalog, liborkh_catalog_dict_t dict, liborkh_catalog_column_t column, const uint8_t* mask, liborkh_catalog_group_t* groups) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !groups || dict >= LIBORKH_CATALOG_DICT_COUNT || column >= LIBORKH_CATALOG_COLUMN_COUNT);
+
+    for (size_t g = 0; g < catalog->dicts[dict].count; g++) {
+        groups[g] = (liborkh_catalog_group_t) { 0, 0, UINT32_MAX, 0 };
+    }
+
+    const uint32_t* col = catalog->columns[column];
+    const uint32_t* codes = catalog->codes[dict];
+    for (size_t i = 0; i < catalog->count; i++) {
+        if (mask && !mask[i]) continue;
+        liborkh_catalog_group_t* group = &groups[codes[i]];
+        group->count++;
+        group->sum += col[i];
+        if (col[i] < group->min) group->min = col[i];
+        if (col[i] > group->max) group->max = col[i];
+    }
+
+    for (size_t g = 0; g < catalog->dicts[dict].count; g++) {
+        if (groups[g].count == 0) groups[g].min = 0;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+// rows[0..n) is a min-heap on (value, -row): the root is the first row to evict
+static bool __heap_less(const uint32_t* col, size_t a, size_t b) {
+    return col[a] != col[b] ? col[a] < col[b] : a > b;
+}
+
+static void __heap_sift_down(const uint32_t* col, size_t* rows, size_t n, size_t i) {
+    for (;;) {
+        size_t smallest = i, l = 2 * i + 1, r = 2 * i + 2;
+        if (l < n && __heap_less(col, rows[l], rows[smallest])) smallest = l;
+        if (r < n && __heap_less(col, rows[r], rows[smallest])) smallest = r;
+        if (smallest == i) return;
+        size_t tmp = rows[i];
+        rows[i] = rows[smallest];
+        rows[smallest] = tmp;
+        i = smallest;
+    }
+}
+
+liborkh_status_t liborkh_catalog_top_k(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, const uint8_t* mask, size_t k, size_t* rows, size_t* num_rows) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !num_rows || (k > 0 && !rows) || column >= LIBORKH_CATALOG_COLUMN_COUNT);
+
+    const uint32_t* col = catalog->columns[column];
+    size_t n = 0;
+
+    for (size_t i = 0; i < catalog->count && k > 0; i++) {
+        if (mask && !mask[i]) continue;
+        if (n < k) {
+            rows[n++] = i;
+            if (n == k) {
+                for (size_t j = k / 2; j-- > 0;) __heap_sift_down(col, rows, n, j);
+            }
+        } else if (__heap_less(col, rows[0], i)) {
+            rows[0] = i;
+            __heap_sift_down(col, rows, n, 0);
+        }
+    }
+    if (n < k) {
+        for (size_t j = n / 2; j-- > 0;) __heap_sift_down(col, rows, n, j);
+    }
+
+    // Pop the heap from the back: smallest last
+    for (size_t end = n; end > 1; end--) {
+        size_t tmp = rows[0];
+        rows[0] = rows[end - 1];
+        rows[end - 1] = tmp;
+        __heap_sift_down(col, rows, end - 1, 0);
+    }
+
+    *num_rows = n;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_catalog_histogram(const liborkh_catalog_t* catalog, liborkh_catalog_column_t column, const uint8_t* mask, uint64_t buckets[LIBORKH_CATALOG_HISTOGRAM_SIZE]) {
+    LIBORKH_CHECK_ARGUMENTS(!catalog || !buckets || column >= LIBORKH_CATALOG_COLUMN_COUNT);
+
+    memset(buckets, 0, LIBORKH_CATALOG_HISTOGRAM_SIZE * sizeof(uint64_t));
+
+    const uint32_t* col = catalog->columns[column];
+    for (size_t i = 0; i < catalog->count; i++) {
+        if (mask && !mask[i]) continue;
+        buckets[col[i] ? 32 - __builtin_clz(col[i]) : 0]++;
+    }
+    return LIBORKH_SUCCESS;
+}
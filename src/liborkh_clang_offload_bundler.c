@@ -7,12 +7,17 @@
 #include "liborkh_utils.h"
 #include "liborkh_clang_offload_bundler.h"
 #include "liborkh_uncompress.h"
+#include "liborkh_compress.h"
+#include "liborkh_strip.h"
+#include "liborkh_budget.h"
+#include "liborkh_stats.h"
+#include "liborkh_trace.h"
 
 static liborkh_status_t __liborkh_parse_entry_id(const uint8_t* buf, const size_t id_len, liborkh_gpu_elf_entry_t* out) 
 {
     LIBORKH_CHECK_ARGUMENTS(!buf || !out || id_len == 0);
 
-    char *entry_id = (char *) malloc(id_len + 1);
+    char *entry_id = (char *) liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, id_len + 1);
     LIBORKH_CHECK_ALLOC(entry_id);
 
     memcpy(entry_id, buf, id_len);
@@ -26,7 +31,7 @@ static liborkh_status_t __liborkh_parse_entry_id(const uint8_t* buf, const size_
 
     char *first_dash = strchr(entry_id, '-');
     if (!first_dash) {
-        free(entry_id);
+        liborkh_free(entry_id);
         return LIBORKH_ERROR_CHAR_NOT_FOUND;
     }
 
@@ -36,14 +41,14 @@ static liborkh_status_t __liborkh_parse_entry_id(const uint8_t* buf, const size_
     // Find "--" separator (triple vs arch)
     char *double_dash = strstr(first_dash + 1, "--");
     if (!double_dash) {
-        free(entry_id);
+        liborkh_free(entry_id);
         return LIBORKH_ERROR_CHAR_NOT_FOUND;
     }
 
     // Extract triple
     size_t triple_len = double_dash - (first_dash + 1);
     if (triple_len > 0) {
-        out->target_triple = malloc(triple_len + 1);
+        out->target_triple = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, triple_len + 1);
         LIBORKH_CHECK_ALLOC(out->target_triple);
 
         memcpy(out->target_triple, first_dash + 1, triple_len);
@@ -55,7 +60,7 @@ static liborkh_status_t __liborkh_parse_entry_id(const uint8_t* buf, const size_
     const char *arch_start = double_dash + 2;
     size_t arch_len = strlen(arch_start);
     if (arch_len > 0) {
-        out->target_arch = malloc(arch_len + 1);
+        out->target_arch = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, arch_len + 1);
         LIBORKH_CHECK_ALLOC(out->target_arch);
    
         memcpy(out->target_arch, arch_start, arch_len);
@@ -63,68 +68,132 @@ static liborkh_status_t __liborkh_parse_entry_id(const uint8_t* buf, const size_
         out->target_arch_size = arch_len;
     }
 
-    free(entry_id);
+    liborkh_free(entry_id);
     return LIBORKH_SUCCESS;
 }
 
 // https://rocm.docs.amd.com/projects/llvm-project/en/latest/LLVM/clang/html/ClangOffloadBundler.html#id19
-liborkh_compressed_bundle_entry_t __liborkh_decode_compress_clang_offload_bundler_metadata(const uint8_t *buf, const size_t size, size_t* pos) 
+static liborkh_status_t __liborkh_decode_compress_clang_offload_bundler_header(const uint8_t *buf, const size_t size, size_t* pos, liborkh_compressed_bundle_entry_t* entry)
 {
-    liborkh_compressed_bundle_entry_t entry = {0};
+    memset(entry, 0, sizeof(*entry));
 
-    *pos += COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
     size_t header_size = sizeof(uint16_t) * 2 + sizeof(uint64_t) + COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
-    uint16_t version = read_u16(buf, pos);
-    uint16_t compression_type = read_u16(buf, pos); // 0 = zlib, 1 = zstd
-    uint64_t compressed_size = 0;
-    uint64_t uncompressed_size = 0;
-    if (version == 2) {
+    LIBORKH_CHECK_CALL(check_bounds(*pos, header_size, size), "Truncated compressed bundle header\n");
+
+    *pos += COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+    entry->version = read_u16(buf, pos);
+    entry->compression_type = read_u16(buf, pos); // 0 = zlib, 1 = zstd
+
+    uint64_t total_size = 0; // compressed size includes header
+    if (entry->version == 2) {
         header_size += sizeof(uint32_t) * 2;
-        compressed_size = read_u32(buf, pos) - header_size; // compressed size includes header
-        uncompressed_size = read_u32(buf, pos);
-    } else if (version == 3) {
+        LIBORKH_CHECK_CALL(check_bounds(*pos, sizeof(uint32_t) * 2 + sizeof(uint64_t), size), "Truncated compressed bundle header\n");
+        total_size = read_u32(buf, pos);
+        entry->uncompressed_size = read_u32(buf, pos);
+    } else if (entry->version == 3) {
         header_size += sizeof(uint64_t) * 2;
-        compressed_size = read_u64(buf, pos) - header_size; // compressed size includes header
-        uncompressed_size = read_u64(buf, pos);
+        LIBORKH_CHECK_CALL(check_bounds(*pos, sizeof(uint64_t) * 3, size), "Truncated compressed bundle header\n");
+        total_size = read_u64(buf, pos);
+        entry->uncompressed_size = read_u64(buf, pos);
     } else {
-        liborkh_log_err("Unknown compressed bundle version %u. Skipping entry.\n", version);
-        return entry;
+        liborkh_log_err("Unknown compressed bundle version %u. Skipping entry.\n", entry->version);
+        return LIBORKH_ERROR_INVALID_ARGUMENT;
+    }
+
+    if (total_size < header_size) {
+        liborkh_log_err("Compressed bundle size %llu is smaller than its header\n", (unsigned long long) total_size);
+        return LIBORKH_ERROR_OUT_OF_BOUNDS;
     }
+    entry->compressed_size = total_size - header_size;
 
-    uint64_t hash = read_u64(buf, pos);
+    entry->hash = read_u64(buf, pos);
+    return check_bounds(*pos, entry->compressed_size, size);
+}
+
+liborkh_compressed_bundle_entry_t __liborkh_decode_compress_clang_offload_bundler_metadata(const uint8_t *buf, const size_t size, size_t* pos) 
+{
+    liborkh_compressed_bundle_entry_t entry = {0};
+    if (__liborkh_decode_compress_clang_offload_bundler_header(buf, size, pos, &entry) != LIBORKH_SUCCESS) {
+        return entry;
+    }
 
+    uint16_t compression_type = entry.compression_type;
+    uint64_t compressed_size = entry.compressed_size;
+    uint64_t uncompressed_size = entry.uncompressed_size;
     uint8_t *uncompressed_data = NULL;
 
+    LIBORKH_STATS_TIMER_START(decompress_timer);
+    LIBORKH_TRACE_BEGIN(span);
+
     liborkh_status_t status = LIBORKH_SUCCESS;
-    if (compression_type == 0) {
-        status = libokrh_uncompress_zlib(buf + *pos, compressed_size, uncompressed_size, &uncompressed_data, &uncompressed_size);
-    } else if (compression_type == 1) {
-        status = libokrh_uncompress_zstd(buf + *pos, compressed_size, uncompressed_size, &uncompressed_data, &uncompressed_size);
+    if (compression_type == CCOB_COMPRESSION_ZLIB) {
+        status = __liborkh_uncompress_zlib(buf + *pos, compressed_size, uncompressed_size, &uncompressed_data, &uncompressed_size);
+    } else if (compression_type == CCOB_COMPRESSION_ZSTD) {
+        status = __liborkh_uncompress_zstd(buf + *pos, compressed_size, uncompressed_size, &uncompressed_data, &uncompressed_size);
     } else {
         liborkh_log_warn("Unknown compression type %u in compressed bundle. Skipping entry.\n", compression_type);
         *pos += compressed_size; // skip compressed data
         return entry;
     }
 
+    if (status == LIBORKH_SUCCESS) {
+        LIBORKH_STATS_ADD(decompress[compression_type], 1, uncompressed_size);
+        __liborkh_stats_add(__liborkh_stats()->decompress_in_bytes[compression_type], compressed_size);
+    }
+    LIBORKH_STATS_TIMER_STOP(decompress[compression_type], decompress_timer);
+    LIBORKH_TRACE_END(span, "ccob_decompress", uncompressed_size, compression_type, NULL);
+
     *pos += compressed_size; // skip compressed data
 
     if (status != LIBORKH_SUCCESS) {
-        liborkh_log_warn("Failed to uncompress bundle entry (type %u, version %u). Skipping entry.\n", compression_type, version);
+        liborkh_log_warn("Failed to uncompress bundle entry (type %u, version %u). Skipping entry.\n", compression_type, entry.version);
         return entry;
     }
     
-    entry.version = version;
-    entry.compression_type = compression_type;
-    entry.compressed_size = compressed_size;
     entry.uncompressed_size = uncompressed_size;
-    entry.hash = hash;
     entry.uncompressed_data = uncompressed_data;
 
     return entry;
 }
 
-liborkh_status_t __liborkh_decode_bundle(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter, size_t bundle_id, size_t* bundle_size) 
+/**
+ * Size of the bundle header and entry table at the start of a bundle.
+ * Returns LIBORKH_ERROR_OUT_OF_BOUNDS when more than `size` bytes are required to know it,
+ * `needed` is then the minimum number of bytes to provide for the next attempt.
+ */
+static liborkh_status_t __liborkh_bundle_table_size(const uint8_t *buf, const size_t size, size_t* needed)
 {
+    size_t pos = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+
+    *needed = pos + sizeof(uint64_t);
+    if (check_bounds(pos, sizeof(uint64_t), size) != LIBORKH_SUCCESS) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    uint64_t num_entries = read_u64(buf, &pos);
+    for (uint64_t i = 0; i < num_entries; i++) {
+        *needed = pos + sizeof(uint64_t) * 3;
+        if (check_bounds(pos, sizeof(uint64_t) * 3, size) != LIBORKH_SUCCESS) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+        pos += sizeof(uint64_t) * 2;
+        uint64_t id_len = read_u64(buf, &pos);
+
+        *needed = id_len <= SIZE_MAX - pos ? pos + id_len : SIZE_MAX;
+        if (check_bounds(pos, id_len, size) != LIBORKH_SUCCESS) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+        pos += id_len;
+    }
+
+    *needed = pos;
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Decode a bundle. In headers only mode, `size` is the full bundle size but only
+ * its entry table is guaranteed to be readable.
+ */
+static liborkh_status_t __liborkh_decode_bundle(const uint8_t *buf, const size_t size, __liborkh_visit_ctx_t* ctx, size_t bundle_id, size_t bundle_offset, bool compressed, size_t* bundle_size) 
+{
+    LIBORKH_STATS_TIMER_START(bundle_timer);
+    LIBORKH_TRACE_BEGIN(bundle_span);
+
     size_t pos = 0;
     pos += CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
 
@@ -153,58 +222,154 @@ liborkh_status_t __liborkh_decode_bundle(const uint8_t *buf, const size_t size,
         // Validate ID string
         LIBORKH_CHECK_CALL(check_bounds(pos, id_len, size), "Invalid ID length for entry %llu\n", i);
     
+        LIBORKH_STATS_TIMER_START(entry_timer);
+        LIBORKH_TRACE_BEGIN(entry_span);
+
         liborkh_gpu_elf_entry_t *entry = NULL;
         LIBORKH_CHECK_CALL(liborkh_new_entry(&entry), "Failed to get new entry\n");
 
         entry->id  = bundle_id;
         entry->img = IMG_Fatbinary;
+        entry->bundle_offset = bundle_offset;
+        entry->image_offset  = elf_start;
+        if (compressed) entry->flags |= LIBORKH_ENTRY_COMPRESSED;
 
         LIBORKH_CHECK_CALL(__liborkh_parse_entry_id(buf + pos, id_len, entry), "Failed to parse entry ID\n");
 
         pos += id_len;
 
-        if (elf_size > 0 && liborkh_is_entry_matching_filter(entry, filter)) {
-            // Extract code object
+        if (elf_size > 0 && liborkh_is_entry_matching_filter(entry, ctx->filter)) {
+            LIBORKH_STATS_ADD(entries_decoded, 1, elf_size);
+            LIBORKH_STATS_TIMER_STOP(entries_decoded, entry_timer);
+
+            // Borrowed view of the code object, copied only if the visitor takes the entry
             entry->elf_size = elf_size;
-            entry->elf = malloc(entry->elf_size);
-            LIBORKH_CHECK_ALLOC(entry->elf);
-            
-            memcpy(entry->elf, buf + elf_start, entry->elf_size);
-
-            // Add entry to pool
-            LIBORKH_CHECK_CALL(liborkh_gpu_elf_pool_push(pool, entry), "Failed to add entry to pool\n");
-            
-            if (liborkh_is_one_by_id_mode_filter(filter)) {
+            if (!ctx->headers_only) {
+                entry->elf    = (uint8_t *) buf + elf_start;
+                entry->flags |= LIBORKH_ENTRY_BORROWED_ELF;
+            }
+
+            LIBORKH_TRACE_END(entry_span, "bundle_entry", elf_size, -1, entry->target_arch);
+
+            liborkh_visit_action_t action = LIBORKH_VISIT_SKIP;
+            liborkh_status_t status = __liborkh_visit_entry(entry, ctx->func, ctx->user_data, &action);
+            if (status != LIBORKH_SUCCESS) {
+                liborkh_log_err("Failed to visit entry\n");
+                ctx->status = status;
+                ctx->stop = true;
+                return status;
+            }
+
+            ctx->matched++;
+            if (action == LIBORKH_VISIT_STOP || liborkh_is_filter_limit_reached(ctx->filter, ctx->matched)) {
+                ctx->stop = true;
+                break;
+            }
+            if (liborkh_is_one_by_id_mode_filter(ctx->filter)) {
                 break; // only one entry requested
             }
         } else {
+            LIBORKH_STATS_ADD(entries_rejected, 1, elf_size);
+            LIBORKH_STATS_TIMER_STOP(entries_rejected, entry_timer);
             LIBORKH_CHECK_CALL(liborkh_free_entry(entry), "Failed to free entry\n");
         }
     }
+
+    LIBORKH_STATS_ADD(bundles, 1, *bundle_size);
+    LIBORKH_STATS_TIMER_STOP(bundles, bundle_timer);
+    LIBORKH_TRACE_END(bundle_span, "__liborkh_decode_bundle", *bundle_size, -1, NULL);
     return LIBORKH_SUCCESS;
 }
 
-liborkh_status_t liborkh_decode_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter)
+/**
+ * Decode the entry table of a compressed bundle, decompressing only as many bytes as the table needs.
+ */
+static liborkh_status_t __liborkh_decode_compressed_bundle_headers(const uint8_t *buf, const size_t size, size_t* pos, __liborkh_visit_ctx_t* ctx, size_t bundle_id)
 {
-    LIBORKH_CHECK_ARGUMENTS(!buf || !pool || size == 0);
+    size_t bundle_offset = *pos;
+
+    liborkh_compressed_bundle_entry_t ccob;
+    LIBORKH_CHECK_CALL(__liborkh_decode_compress_clang_offload_bundler_header(buf, size, pos, &ccob), "Invalid compressed bundle header\n");
+
+    const uint8_t *payload = buf + *pos;
+    *pos += ccob.compressed_size;
+
+    if (ccob.compression_type >= CCOB_COMPRESSION_COUNT) {
+        liborkh_log_warn("Unknown compression type %u in compressed bundle. Skipping entry.\n", ccob.compression_type);
+        return LIBORKH_SUCCESS;
+    }
+
+    LIBORKH_STATS_TIMER_START(decompress_timer);
+    LIBORKH_TRACE_BEGIN(span);
+
+    liborkh_uncompress_stream_t stream;
+    LIBORKH_CHECK_CALL(liborkh_uncompress_stream_init(&stream, (liborkh_ccob_compression_t) ccob.compression_type, payload, ccob.compressed_size, ccob.uncompressed_size), "Failed to init decompression stream\n");
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    size_t needed = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE + sizeof(uint64_t);
+    for (;;) {
+        status = liborkh_uncompress_stream_fill(&stream, needed);
+        if (status != LIBORKH_SUCCESS) break;
+
+        status = __liborkh_bundle_table_size(stream.out, stream.out_size, &needed);
+        if (status != LIBORKH_ERROR_OUT_OF_BOUNDS) break;
+        if (needed > ccob.uncompressed_size) break; // truncated table
+    }
+
+    LIBORKH_STATS_ADD(decompress[ccob.compression_type], 1, stream.out_size);
+    __liborkh_stats_add(__liborkh_stats()->decompress_in_bytes[ccob.compression_type], ccob.compression_type == CCOB_COMPRESSION_ZLIB ? stream.zs.total_in : stream.in_pos);
+    LIBORKH_STATS_TIMER_STOP(decompress[ccob.compression_type], decompress_timer);
+    LIBORKH_TRACE_END(span, "ccob_decompress_headers", stream.out_size, ccob.compression_type, NULL);
+
+    if (status == LIBORKH_SUCCESS && is_magic(stream.out, 0, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+        size_t bundle_size = 0;
+        status = __liborkh_decode_bundle(stream.out, ccob.uncompressed_size, ctx, bundle_id, bundle_offset, true, &bundle_size);
+    } else {
+        liborkh_log_warn("Failed to read compressed bundle entry table (type %u, version %u). Skipping entry.\n", ccob.compression_type, ccob.version);
+    }
+
+    liborkh_uncompress_stream_free(&stream);
+    return status;
+}
+
+liborkh_status_t __liborkh_visit_clang_offload_bundler(const uint8_t *buf, const size_t size, __liborkh_visit_ctx_t* ctx)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !ctx || !ctx->func || size == 0);
+
+    LIBORKH_STATS_TIMER_START(scan_timer);
+    LIBORKH_TRACE_BEGIN(span);
 
     size_t pos = 0;
     size_t bundle_size = 1;
     size_t bundle_count = 0;
-    while (pos <= size) {
+    size_t scanned = 0;
+    while (!ctx->stop && pos + COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size) {
         bundle_size = 1;
-        if (is_magic(buf, pos, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC)) {
-            liborkh_compressed_bundle_entry_t entry = __liborkh_decode_compress_clang_offload_bundler_metadata(buf, size, &pos);
-            if (entry.uncompressed_data) {
-                liborkh_status_t status = __liborkh_decode_bundle(entry.uncompressed_data, entry.uncompressed_size, pool, filter, bundle_count, &bundle_size);
-                free(entry.uncompressed_data);
-                if (status != LIBORKH_SUCCESS) {
+
+        // Bytes compared: the CCOB magic, then the plain bundle magic when it fits
+        bool compressed = is_magic(buf, pos, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC);
+        bool plain_fits = !compressed && pos + CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size;
+        scanned += COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE + (plain_fits ? CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE : 0);
+
+        if (compressed) {
+            size_t bundle_offset = pos;
+            if (ctx->headers_only) {
+                if (__liborkh_decode_compressed_bundle_headers(buf, size, &pos, ctx, bundle_count) != LIBORKH_SUCCESS) {
                     liborkh_log_warn("Failed to decode compressed bundle entry %zu\n", bundle_count);
                 }
+            } else {
+                liborkh_compressed_bundle_entry_t entry = __liborkh_decode_compress_clang_offload_bundler_metadata(buf, size, &pos);
+                if (entry.uncompressed_data) {
+                    liborkh_status_t status = __liborkh_decode_bundle(entry.uncompressed_data, entry.uncompressed_size, ctx, bundle_count, bundle_offset, true, &bundle_size);
+                    liborkh_budget_free(entry.uncompressed_data);
+                    if (status != LIBORKH_SUCCESS) {
+                        liborkh_log_warn("Failed to decode compressed bundle entry %zu\n", bundle_count);
+                    }
+                }
             }
-            bundle_size = 1; // pos has already been advanced in the compressed bundle metadata function and bundle_size doesn't correspond to the compressed data size
-        } else if (is_magic(buf, pos, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
-            liborkh_status_t status = __liborkh_decode_bundle(buf + pos, size - pos, pool, filter, bundle_count, &bundle_size);
+            bundle_size = pos > bundle_offset ? 0 : 1; // pos has already been advanced past the compressed data, bundle_size doesn't correspond to the compressed data size
+        } else if (plain_fits && is_magic(buf, pos, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            liborkh_status_t status = __liborkh_decode_bundle(buf + pos, size - pos, ctx, bundle_count, pos, false, &bundle_size);
             if (status != LIBORKH_SUCCESS) {
                 liborkh_log_warn("Failed to decode bundle entry %zu\n", bundle_count);
             }
@@ -215,5 +380,421 @@ liborkh_status_t liborkh_decode_clang_offload_bundler(const uint8_t *buf, const
         pos += bundle_size;
         bundle_count++;
     }
+
+    LIBORKH_STATS_ADD(magic_scan, 1, scanned);
+    LIBORKH_STATS_TIMER_STOP(magic_scan, scan_timer);
+    LIBORKH_TRACE_END(span, "liborkh_decode_clang_offload_bundler", size, -1, NULL);
+    return ctx->status;
+}
+
+liborkh_status_t liborkh_visit_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data)
+{
+    __liborkh_visit_ctx_t ctx = { .filter = filter, .func = func, .user_data = user_data };
+    return __liborkh_visit_clang_offload_bundler(buf, size, &ctx);
+}
+
+liborkh_status_t liborkh_decode_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !pool || size == 0);
+
+    __liborkh_pool_push_ctx_t ctx = { .pool = pool, .status = LIBORKH_SUCCESS };
+    LIBORKH_CHECK_CALL(liborkh_visit_clang_offload_bundler(buf, size, filter, __liborkh_pool_push_visitor, &ctx), "Failed to decode bundles\n");
+    return ctx.status;
+}
+
+/**
+ * Entry table of a plain bundle, walked the way __liborkh_decode_bundle does:
+ * `bundle_size` is the end of the last image reached, left unchanged if the
+ * table is unreadable, so that the index numbers bundles like the decoder.
+ */
+static void __liborkh_index_bundle(const uint8_t *buf, const size_t size, liborkh_bundle_index_item_t* item, size_t* bundle_size)
+{
+    size_t pos = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+    if (check_bounds(pos, sizeof(uint64_t), size) != LIBORKH_SUCCESS) return;
+
+    item->num_entries = read_u64(buf, &pos);
+    item->table_offset += pos;
+    for (uint64_t i = 0; i < item->num_entries; i++) {
+        if (check_bounds(pos, sizeof(uint64_t) * 3, size) != LIBORKH_SUCCESS) return;
+
+        uint64_t elf_start = read_u64(buf, &pos);
+        uint64_t elf_size  = read_u64(buf, &pos);
+        uint64_t id_len    = read_u64(buf, &pos);
+        if (check_bounds(elf_start, elf_size, size) != LIBORKH_SUCCESS) return;
+
+        *bundle_size = elf_start + elf_size;
+        if (elf_size > 0 && check_bounds(pos, id_len, size) != LIBORKH_SUCCESS) return;
+        pos += id_len;
+    }
+}
+
+/**
+ * Record the offset of every bundle of an offload section in one pass,
+ * without decompressing nor decoding any entry.
+ */
+liborkh_status_t liborkh_bundle_index_build(const uint8_t *buf, const size_t size, liborkh_bundle_index_t** index)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !index || size == 0);
+
+    *index = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_bundle_index_t));
+    LIBORKH_CHECK_ALLOC(*index);
+    liborkh_bundle_index_t* idx = *index;
+
+    size_t pos = 0;
+    while (pos + COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size) {
+        liborkh_bundle_index_item_t item = { .offset = pos };
+        size_t bundle_size = 1;
+
+        if (is_magic(buf, pos, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            liborkh_compressed_bundle_entry_t header;
+            item.compressed = true;
+            if (__liborkh_decode_compress_clang_offload_bundler_header(buf, size, &pos, &header) == LIBORKH_SUCCESS) {
+                item.table_offset = pos;
+                pos += header.compressed_size;
+            }
+            bundle_size = pos > item.offset ? 0 : 1;
+        } else if (pos + CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size && is_magic(buf, pos, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            item.table_offset = pos;
+            __liborkh_index_bundle(buf + pos, size - pos, &item, &bundle_size);
+        } else {
+            pos++;
+            continue;
+        }
+        pos += bundle_size;
+        item.size = pos - item.offset;
+
+        if (idx->count == idx->capacity) {
+            size_t capacity = idx->capacity ? idx->capacity * 2 : 16;
+            liborkh_bundle_index_item_t* items = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, idx->items, capacity * sizeof(liborkh_bundle_index_item_t));
+            if (!items) {
+                liborkh_bundle_index_free(idx);
+                *index = NULL;
+                LIBORKH_CHECK_ALLOC(items);
+            }
+            idx->items = items;
+            idx->capacity = capacity;
+        }
+        idx->items[idx->count++] = item;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_bundle_index_free(liborkh_bundle_index_t* index)
+{
+    LIBORKH_CHECK_ARGUMENTS(!index);
+
+    liborkh_free(index->items);
+    liborkh_free(index);
     return LIBORKH_SUCCESS;
-}
\ No newline at end of file
+}
+
+/**
+ * Visit the entries of one bundle only, with the ids and offsets a full
+ * decode of the section would give them.
+ */
+liborkh_status_t liborkh_bundle_index_visit(const uint8_t *buf, const size_t size, const liborkh_bundle_index_t* index, size_t bundle_id, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !index || !func || bundle_id >= index->count);
+
+    const liborkh_bundle_index_item_t* item = &index->items[bundle_id];
+    LIBORKH_CHECK_CALL(check_bounds(item->offset, item->size, size), "Bundle %zu out of bounds\n", bundle_id);
+
+    __liborkh_visit_ctx_t ctx = { .filter = filter, .func = func, .user_data = user_data };
+    size_t bundle_size = 1;
+    if (!item->compressed) {
+        return __liborkh_decode_bundle(buf + item->offset, size - item->offset, &ctx, bundle_id, item->offset, false, &bundle_size);
+    }
+
+    size_t pos = item->offset;
+    liborkh_compressed_bundle_entry_t ccob = __liborkh_decode_compress_clang_offload_bundler_metadata(buf, size, &pos);
+    LIBORKH_CHECK_CALL(ccob.uncompressed_data ? LIBORKH_SUCCESS : LIBORKH_ERROR_DECOMPRESSION_FAILED, "Cannot decompress bundle %zu\n", bundle_id);
+
+    liborkh_status_t status = __liborkh_decode_bundle(ccob.uncompressed_data, ccob.uncompressed_size, &ctx, bundle_id, item->offset, true, &bundle_size);
+    liborkh_budget_free(ccob.uncompressed_data);
+    return status;
+}
+
+liborkh_status_t liborkh_bundle_index_decode(const uint8_t *buf, const size_t size, const liborkh_bundle_index_t* index, size_t bundle_id, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter)
+{
+    LIBORKH_CHECK_ARGUMENTS(!pool);
+
+    __liborkh_pool_push_ctx_t ctx = { .pool = pool, .status = LIBORKH_SUCCESS };
+    LIBORKH_CHECK_CALL(liborkh_bundle_index_visit(buf, size, index, bundle_id, filter, __liborkh_pool_push_visitor, &ctx), "Failed to decode bundle %zu\n", bundle_id);
+    return ctx.status;
+}
+
+typedef struct {
+    uint64_t start;
+    uint64_t size;
+    const uint8_t* id;
+    uint64_t id_len;
+    bool keep;
+} __liborkh_bundle_table_entry_t;
+
+/**
+ * Rewrite one uncompressed bundle with the device entries matching the filter.
+ * Entries without image (host) are always kept, images keep the alignment of
+ * the original layout. The new bundle is never larger than the original one.
+ */
+static liborkh_status_t __liborkh_strip_bundle(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, uint8_t* out, size_t* bundle_size, size_t* out_size, liborkh_strip_result_t* result)
+{
+    size_t pos = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+    LIBORKH_CHECK_CALL(check_bounds(pos, sizeof(uint64_t), size), "Truncated bundle header (no entry count)\n");
+
+    uint64_t num_entries = read_u64(buf, &pos);
+    LIBORKH_CHECK_CALL(num_entries > size / (sizeof(uint64_t) * 3) ? LIBORKH_ERROR_OUT_OF_BOUNDS : LIBORKH_SUCCESS, "Invalid bundle entry count\n");
+
+    __liborkh_bundle_table_entry_t* table = liborkh_calloc(LIBORKH_ALLOC_STAGE_IO, num_entries + 1, sizeof(__liborkh_bundle_table_entry_t));
+    LIBORKH_CHECK_ALLOC(table);
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    size_t header_size = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE + sizeof(uint64_t);
+    size_t align = 4096;
+    *bundle_size = 0;
+
+    for (uint64_t i = 0; i < num_entries && status == LIBORKH_SUCCESS; i++) {
+        __liborkh_bundle_table_entry_t* e = &table[i];
+        status = check_bounds(pos, sizeof(uint64_t) * 3, size);
+        if (status != LIBORKH_SUCCESS) break;
+
+        e->start  = read_u64(buf, &pos);
+        e->size   = read_u64(buf, &pos);
+        e->id_len = read_u64(buf, &pos);
+        e->id     = buf + pos;
+        status = check_bounds(pos, e->id_len, size);
+        if (status == LIBORKH_SUCCESS) status = check_bounds(e->start, e->size, size);
+        if (status != LIBORKH_SUCCESS) break;
+        pos += e->id_len;
+
+        if (e->start + e->size > *bundle_size) *bundle_size = e->start + e->size;
+
+        e->keep = true;
+        if (e->size > 0) {
+            liborkh_gpu_elf_entry_t* entry = NULL;
+            status = liborkh_new_entry(&entry);
+            if (status != LIBORKH_SUCCESS) break;
+
+            entry->img = IMG_Fatbinary;
+            status = __liborkh_parse_entry_id(e->id, e->id_len, entry);
+            e->keep = status == LIBORKH_SUCCESS && liborkh_is_entry_matching_filter(entry, filter);
+            liborkh_free_entry(entry);
+            if (status != LIBORKH_SUCCESS) break;
+
+            if (e->keep) {
+                while (align > 1 && e->start % align != 0) align >>= 1;
+                result->num_kept++;
+            } else {
+                result->num_removed++;
+            }
+        }
+        if (e->keep) header_size += sizeof(uint64_t) * 3 + e->id_len;
+    }
+    if (pos > *bundle_size) *bundle_size = pos;
+
+    // Lay out the kept images after the new, shorter, entry table
+    size_t cur = header_size;
+    for (uint64_t i = 0; i < num_entries && status == LIBORKH_SUCCESS; i++) {
+        if (!table[i].keep || table[i].size == 0) continue;
+        cur = (cur + align - 1) & ~(align - 1);
+        cur += table[i].size;
+    }
+    if (status == LIBORKH_SUCCESS && cur > *bundle_size) status = LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    if (status == LIBORKH_SUCCESS) {
+        memset(out, 0, *bundle_size);
+        memcpy(out, CLANG_OFFLOAD_BUNDLER_MAGIC, CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE);
+
+        size_t num_kept = 0;
+        for (uint64_t i = 0; i < num_entries; i++) num_kept += table[i].keep;
+        memcpy(out + CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE, &(uint64_t) { num_kept }, sizeof(uint64_t));
+
+        size_t table_pos = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE + sizeof(uint64_t);
+        cur = header_size;
+        for (uint64_t i = 0; i < num_entries; i++) {
+            const __liborkh_bundle_table_entry_t* e = &table[i];
+            if (!e->keep) continue;
+            if (e->size > 0) cur = (cur + align - 1) & ~(align - 1);
+
+            uint64_t fields[3] = { cur, e->size, e->id_len };
+            memcpy(out + table_pos, fields, sizeof(fields));
+            memcpy(out + table_pos + sizeof(fields), e->id, e->id_len);
+            table_pos += sizeof(fields) + e->id_len;
+
+            memcpy(out + cur, buf + e->start, e->size);
+            cur += e->size;
+        }
+        *out_size = cur;
+    }
+
+    liborkh_free(table);
+    return status;
+}
+
+/**
+ * Rewrite the bundles of an offload section keeping only the device entries
+ * matching the filter. Every bundle stays at its offset (host code refers to
+ * bundles by address); compressed bundles are decompressed, filtered and
+ * compressed again with their codec and version. `out` has `size` bytes.
+ */
+liborkh_status_t liborkh_strip_clang_offload_bundler(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, uint8_t* out, liborkh_strip_result_t* result)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !out || !result || size == 0);
+
+    memset(out, 0, size);
+    memset(result, 0, sizeof(*result));
+    result->old_size = size;
+
+    size_t pos = 0;
+    while (pos + COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size) {
+        size_t end = pos;
+        liborkh_strip_result_t bundle_result = {0};
+
+        if (is_magic(buf, pos, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            size_t payload_pos = pos;
+            liborkh_compressed_bundle_entry_t header;
+            LIBORKH_CHECK_CALL(__liborkh_decode_compress_clang_offload_bundler_header(buf, size, &payload_pos, &header), "Invalid compressed bundle at offset %zu\n", pos);
+            size_t ccob_size = payload_pos - pos + header.compressed_size;
+
+            size_t next = pos;
+            liborkh_compressed_bundle_entry_t ccob = __liborkh_decode_compress_clang_offload_bundler_metadata(buf, size, &next);
+            LIBORKH_CHECK_CALL(ccob.uncompressed_data ? LIBORKH_SUCCESS : LIBORKH_ERROR_DECOMPRESSION_FAILED, "Cannot decompress bundle at offset %zu\n", pos);
+
+            size_t bundle_size = 0, stripped_size = 0;
+            uint8_t* stripped = liborkh_malloc(LIBORKH_ALLOC_STAGE_IO, ccob.uncompressed_size + 1);
+            liborkh_status_t status = stripped ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_MEMORY;
+            if (status == LIBORKH_SUCCESS) {
+                status = __liborkh_strip_bundle(ccob.uncompressed_data, ccob.uncompressed_size, filter, stripped, &bundle_size, &stripped_size, &bundle_result);
+            }
+            liborkh_budget_free(ccob.uncompressed_data);
+
+            uint8_t* compressed = NULL;
+            size_t compressed_size = 0;
+            if (status == LIBORKH_SUCCESS && bundle_result.num_removed > 0) {
+                status = liborkh_ccob_compress((liborkh_ccob_compression_t) ccob.compression_type, ccob.version, 0, stripped, stripped_size, &compressed, &compressed_size);
+            }
+            liborkh_free(stripped);
+            if (status != LIBORKH_SUCCESS) {
+                liborkh_log_err("Cannot rewrite compressed bundle at offset %zu\n", pos);
+                return status;
+            }
+
+            // Keep the original when nothing is removed or when it would not shrink
+            if (compressed && compressed_size <= ccob_size) {
+                memcpy(out + pos, compressed, compressed_size);
+                end = pos + compressed_size;
+            } else {
+                bundle_result.num_kept += bundle_result.num_removed;
+                bundle_result.num_removed = 0;
+                memcpy(out + pos, buf + pos, ccob_size);
+                end = pos + ccob_size;
+            }
+            liborkh_free(compressed);
+            pos += ccob_size;
+        } else if (pos + CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size && is_magic(buf, pos, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            size_t bundle_size = 0, stripped_size = 0;
+            LIBORKH_CHECK_CALL(__liborkh_strip_bundle(buf + pos, size - pos, filter, out + pos, &bundle_size, &stripped_size, &bundle_result), "Cannot rewrite bundle at offset %zu\n", pos);
+            end = pos + stripped_size;
+            pos += bundle_size;
+        } else {
+            pos++;
+            continue;
+        }
+
+        result->num_kept    += bundle_result.num_kept;
+        result->num_removed += bundle_result.num_removed;
+        if (end > result->new_size) result->new_size = end;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+// Extent of an uncompressed bundle: its entry table and every image
+static liborkh_status_t __liborkh_bundle_extent(const uint8_t *buf, const size_t size, size_t* extent)
+{
+    size_t pos = CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+    LIBORKH_CHECK_CALL(check_bounds(pos, sizeof(uint64_t), size), "Truncated bundle header (no entry count)\n");
+
+    uint64_t num_entries = read_u64(buf, &pos);
+    LIBORKH_CHECK_CALL(num_entries > size / (sizeof(uint64_t) * 3) ? LIBORKH_ERROR_OUT_OF_BOUNDS : LIBORKH_SUCCESS, "Invalid bundle entry count\n");
+
+    *extent = 0;
+    for (uint64_t i = 0; i < num_entries; i++) {
+        LIBORKH_CHECK_CALL(check_bounds(pos, sizeof(uint64_t) * 3, size), "Truncated bundle entry table\n");
+        uint64_t start  = read_u64(buf, &pos);
+        uint64_t length = read_u64(buf, &pos);
+        uint64_t id_len = read_u64(buf, &pos);
+        LIBORKH_CHECK_CALL(check_bounds(pos, id_len, size), "Truncated bundle entry ID\n");
+        LIBORKH_CHECK_CALL(check_bounds(start, length, size), "Bundle entry out of bounds\n");
+        pos += id_len;
+        if (start + length > *extent) *extent = start + length;
+    }
+    if (pos > *extent) *extent = pos;
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Recompress every compressed bundle of an offload section with the given
+ * options. The bundle hash is kept and every bundle stays at its offset: a
+ * bundle may grow into the zero padding that follows it, otherwise the
+ * original is kept and counted in result->num_kept. Uncompressed bundles are
+ * copied as is. `out` has `size` bytes.
+ */
+liborkh_status_t liborkh_transcode_clang_offload_bundler(const uint8_t *buf, const size_t size, const liborkh_ccob_options_t* options, uint8_t* out, liborkh_transcode_result_t* result)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !options || !out || !result || size == 0);
+
+    memcpy(out, buf, size);
+    memset(result, 0, sizeof(*result));
+    result->old_size = size;
+
+    size_t pos = 0;
+    while (pos + COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size) {
+        size_t end = pos;
+
+        if (is_magic(buf, pos, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            size_t payload_pos = pos;
+            liborkh_compressed_bundle_entry_t header;
+            LIBORKH_CHECK_CALL(__liborkh_decode_compress_clang_offload_bundler_header(buf, size, &payload_pos, &header), "Invalid compressed bundle at offset %zu\n", pos);
+            size_t ccob_size = payload_pos - pos + header.compressed_size;
+
+            size_t next = pos;
+            liborkh_compressed_bundle_entry_t ccob = __liborkh_decode_compress_clang_offload_bundler_metadata(buf, size, &next);
+            LIBORKH_CHECK_CALL(ccob.uncompressed_data ? LIBORKH_SUCCESS : LIBORKH_ERROR_DECOMPRESSION_FAILED, "Cannot decompress bundle at offset %zu\n", pos);
+
+            uint8_t* compressed = NULL;
+            size_t compressed_size = 0;
+            liborkh_status_t status = liborkh_ccob_compress_ex(options, ccob.uncompressed_data, ccob.uncompressed_size, &header.hash, &compressed, &compressed_size);
+            liborkh_budget_free(ccob.uncompressed_data);
+            LIBORKH_CHECK_CALL(status, "Cannot recompress bundle at offset %zu\n", pos);
+
+            // The bundle can use the padding up to the next bundle
+            size_t slot_end = pos + ccob_size;
+            while (slot_end < size && buf[slot_end] == 0) slot_end++;
+
+            if (compressed_size <= slot_end - pos) {
+                memset(out + pos, 0, ccob_size);
+                memcpy(out + pos, compressed, compressed_size);
+                end = pos + compressed_size;
+                result->num_transcoded++;
+            } else {
+                liborkh_log_warn("Recompressed bundle at offset %zu does not fit in place (%zu > %zu bytes), keeping it\n", pos, compressed_size, slot_end - pos);
+                end = pos + ccob_size;
+                result->num_kept++;
+            }
+            result->old_bytes += ccob_size;
+            result->new_bytes += end - pos;
+            liborkh_free(compressed);
+            pos += ccob_size;
+        } else if (pos + CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE <= size && is_magic(buf, pos, CLANG_OFFLOAD_BUNDLER_MAGIC)) {
+            size_t extent = 0;
+            LIBORKH_CHECK_CALL(__liborkh_bundle_extent(buf + pos, size - pos, &extent), "Invalid bundle at offset %zu\n", pos);
+            end = pos + extent;
+            pos += extent;
+        } else {
+            pos++;
+            continue;
+        }
+
+        if (end > result->new_size) result->new_size = end;
+    }
+    return LIBORKH_SUCCESS;
+}
@@ -5,13 +5,22 @@
 #include "liborkh_gpu_elf_pool.h"
 #include "liborkh_utils.h"
 #include "liborkh_clang_offload_packager.h"
+#include "liborkh_strip.h"
+#include "liborkh_stats.h"
+#include "liborkh_trace.h"
 
-liborkh_status_t liborkh_decode_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter)
+liborkh_status_t __liborkh_visit_clang_offload_packager(const uint8_t *buf, const size_t size, __liborkh_visit_ctx_t* ctx)
 {
-    LIBORKH_CHECK_ARGUMENTS(!buf || !pool || size == 0);
+    LIBORKH_CHECK_ARGUMENTS(!buf || !ctx || !ctx->func || size == 0);
+
+    LIBORKH_STATS_TIMER_START(scan_timer);
+    LIBORKH_TRACE_BEGIN(span);
+
     size_t pos = 0;
+    size_t scanned = 0;
 
-    while (pos + sizeof(__liborkh_offload_binary_header_t) <= size) {
+    while (!ctx->stop && pos + sizeof(__liborkh_offload_binary_header_t) <= size) {
+        scanned += sizeof(uint32_t);
 
         size_t magic_pos = pos;
         uint32_t magic = read_u32(buf, &magic_pos);
@@ -49,17 +58,22 @@ liborkh_status_t liborkh_decode_clang_offload_packager(const uint8_t *buf, const
             continue;
         }
 
+        LIBORKH_STATS_TIMER_START(blob_timer);
+        LIBORKH_TRACE_BEGIN(blob_span);
+
         liborkh_gpu_elf_entry_t *out = NULL;
         LIBORKH_CHECK_CALL(liborkh_new_entry(&out), "Failed to get new entry\n");
      
         out->id = 0;
         out->img = (image_kind_t) entry.image_kind;
         out->ofk = (offload_kind_t) entry.offload_kind;
+        out->bundle_offset = blob_start;
+        out->image_offset  = entry.image_offset;
 
         // Extract target ID from string table (look for key == "triple" or "arch")
         if (entry.num_strings > 0) {
             size_t str_table_off = blob_start + entry.string_offset;
-            __liborkh_offload_string_entry_t *str_entries = (__liborkh_offload_string_entry_t*) malloc(sizeof(__liborkh_offload_string_entry_t) * entry.num_strings);
+            __liborkh_offload_string_entry_t *str_entries = (__liborkh_offload_string_entry_t*) liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, sizeof(__liborkh_offload_string_entry_t) * entry.num_strings);
             LIBORKH_CHECK_ALLOC(str_entries);
             memcpy(str_entries, buf + str_table_off, sizeof(__liborkh_offload_string_entry_t) * entry.num_strings);
 
@@ -73,40 +87,172 @@ liborkh_status_t liborkh_decode_clang_offload_packager(const uint8_t *buf, const
                     const char *val = (char *)(buf + val_off);
                     if (strcmp(key, "triple") == 0) {
                         out->target_triple_size = strlen(val);
-                        out->target_triple = malloc(out->target_triple_size + 1);
+                        out->target_triple = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, out->target_triple_size + 1);
                         if (out->target_triple)
                             strcpy(out->target_triple, val);
                     } else if (strcmp(key, "arch") == 0) {
                         out->target_arch_size = strlen(val);
-                        out->target_arch = malloc(out->target_arch_size + 1);
+                        out->target_arch = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY_ID, out->target_arch_size + 1);
                         if (out->target_arch)
                             strcpy(out->target_arch, val);
                     }
                 }
             }
+            liborkh_free(str_entries);
         }
 
-        if (liborkh_is_entry_matching_filter(out, filter)) {
-            // Extract ELF image
+        LIBORKH_STATS_ADD(blobs, 1, hdr.size);
+
+        if (liborkh_is_entry_matching_filter(out, ctx->filter)) {
+            LIBORKH_STATS_ADD(entries_decoded, 1, entry.image_size);
+            LIBORKH_STATS_TIMER_STOP(entries_decoded, blob_timer);
+
+            // Borrowed view of the ELF image, copied only if the visitor takes the entry
             size_t image_off = blob_start + entry.image_offset;
             if (check_bounds(image_off, entry.image_size, size) == LIBORKH_SUCCESS) {
                 out->elf_size = entry.image_size;
-                out->elf = malloc(out->elf_size);
-                if (out->elf) {
-                    memcpy(out->elf, buf + image_off, out->elf_size);
-                    LIBORKH_CHECK_CALL(liborkh_gpu_elf_pool_push(pool, out), "Failed to add entry to pool\n");
+                if (!ctx->headers_only) {
+                    out->elf    = (uint8_t *) buf + image_off;
+                    out->flags |= LIBORKH_ENTRY_BORROWED_ELF;
+                }
 
-                    if (liborkh_is_one_by_id_mode_filter(filter)) {
-                        break; // only one entry requested
-                    }
+                LIBORKH_STATS_TIMER_STOP(blobs, blob_timer);
+                LIBORKH_TRACE_END(blob_span, "packager_blob", hdr.size, -1, out->target_arch);
+
+                liborkh_visit_action_t action = LIBORKH_VISIT_SKIP;
+                LIBORKH_CHECK_CALL(__liborkh_visit_entry(out, ctx->func, ctx->user_data, &action), "Failed to visit entry\n");
+
+                ctx->matched++;
+                if (action == LIBORKH_VISIT_STOP || liborkh_is_filter_limit_reached(ctx->filter, ctx->matched)) {
+                    ctx->stop = true;
+                    break;
                 }
+                if (liborkh_is_one_by_id_mode_filter(ctx->filter)) {
+                    break; // only one entry requested
+                }
+            } else {
+                LIBORKH_CHECK_CALL(liborkh_free_entry(out), "Failed to free entry\n");
             }
         } else {
+            LIBORKH_STATS_ADD(entries_rejected, 1, entry.image_size);
+            LIBORKH_STATS_TIMER_STOP(entries_rejected, blob_timer);
+            LIBORKH_STATS_TIMER_STOP(blobs, blob_timer);
+            LIBORKH_TRACE_END(blob_span, "packager_blob", hdr.size, -1, out->target_arch);
             LIBORKH_CHECK_CALL(liborkh_free_entry(out), "Failed to free entry\n");
         }
 
         pos = blob_end;
     }
 
+    LIBORKH_STATS_ADD(magic_scan, 1, scanned);
+    LIBORKH_STATS_TIMER_STOP(magic_scan, scan_timer);
+    LIBORKH_TRACE_END(span, "liborkh_decode_clang_offload_packager", size, -1, NULL);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_visit_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, liborkh_gpu_elf_visit_cb_t func, void *user_data)
+{
+    __liborkh_visit_ctx_t ctx = { .filter = filter, .func = func, .user_data = user_data };
+    return __liborkh_visit_clang_offload_packager(buf, size, &ctx);
+}
+
+liborkh_status_t liborkh_decode_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !pool || size == 0);
+
+    __liborkh_pool_push_ctx_t ctx = { .pool = pool, .status = LIBORKH_SUCCESS };
+    LIBORKH_CHECK_CALL(liborkh_visit_clang_offload_packager(buf, size, filter, __liborkh_pool_push_visitor, &ctx), "Failed to decode packager blobs\n");
+    return ctx.status;
+}
+
+// NUL terminated string of a blob, NULL when out of bounds
+static const char* __liborkh_blob_string(const uint8_t *blob, size_t blob_size, uint64_t offset)
+{
+    if (offset >= blob_size || !memchr(blob + offset, '\0', blob_size - offset)) return NULL;
+    return (const char *) blob + offset;
+}
+
+/**
+ * Whether a blob holds an image matching the filter. Blobs without image are
+ * kept. Entries are matched on borrowed strings, nothing is allocated.
+ */
+static liborkh_status_t __liborkh_is_blob_matching_filter(const uint8_t *blob, const __liborkh_offload_binary_header_t* hdr, liborkh_entry_filter_t* filter, bool* keep, bool* has_image)
+{
+    size_t num_entries = hdr->entry_size / sizeof(__liborkh_offload_entry_t);
+    LIBORKH_CHECK_CALL(check_bounds(hdr->entry_offset, num_entries * sizeof(__liborkh_offload_entry_t), hdr->size), "Invalid entry table bounds\n");
+
+    *keep = true;
+    *has_image = false;
+    for (size_t i = 0; i < num_entries; i++) {
+        __liborkh_offload_entry_t entry;
+        memcpy(&entry, blob + hdr->entry_offset + i * sizeof(entry), sizeof(entry));
+        if (entry.image_size == 0) continue;
+
+        if (!*has_image) *keep = false;
+        *has_image = true;
+
+        liborkh_gpu_elf_entry_t view = {0};
+        view.img = (image_kind_t) entry.image_kind;
+        view.ofk = (offload_kind_t) entry.offload_kind;
+
+        LIBORKH_CHECK_CALL(check_bounds(entry.string_offset, entry.num_strings * sizeof(__liborkh_offload_string_entry_t), hdr->size), "Invalid string table bounds\n");
+        for (uint64_t s = 0; s < entry.num_strings; s++) {
+            __liborkh_offload_string_entry_t str;
+            memcpy(&str, blob + entry.string_offset + s * sizeof(str), sizeof(str));
+
+            const char *key = __liborkh_blob_string(blob, hdr->size, str.key_offset);
+            const char *val = __liborkh_blob_string(blob, hdr->size, str.value_offset);
+            if (!key || !val) continue;
+            if (strcmp(key, "triple") == 0) view.target_triple = (char *) val;
+            else if (strcmp(key, "arch") == 0) view.target_arch = (char *) val;
+        }
+
+        if (liborkh_is_entry_matching_filter(&view, filter)) *keep = true;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Rewrite the packager blobs of an offload section keeping only the blobs
+ * with an image matching the filter. Kept blobs stay at their offset, removed
+ * ones are zeroed. `out` has `size` bytes.
+ */
+liborkh_status_t liborkh_strip_clang_offload_packager(const uint8_t *buf, const size_t size, liborkh_entry_filter_t* filter, uint8_t* out, liborkh_strip_result_t* result)
+{
+    LIBORKH_CHECK_ARGUMENTS(!buf || !out || !result || size == 0);
+
+    memset(out, 0, size);
+    memset(result, 0, sizeof(*result));
+    result->old_size = size;
+
+    size_t pos = 0;
+    while (pos + sizeof(__liborkh_offload_binary_header_t) <= size) {
+        size_t magic_pos = pos;
+        if (read_u32(buf, &magic_pos) != CLANG_OFFLOAD_PACKAGER_MAGIC) {
+            pos++;
+            continue;
+        }
+
+        __liborkh_offload_binary_header_t hdr;
+        memcpy(&hdr, buf + pos, sizeof(hdr));
+        if (hdr.version != CLANG_OFFLOAD_PACKAGER_HEADER_VERSION || hdr.size < sizeof(hdr)) {
+            pos += 4;
+            continue;
+        }
+        LIBORKH_CHECK_CALL(check_bounds(pos, hdr.size, size), "Corrupted header (out of bounds)\n");
+
+        bool keep = true, has_image = false;
+        LIBORKH_CHECK_CALL(__liborkh_is_blob_matching_filter(buf + pos, &hdr, filter, &keep, &has_image), "Invalid blob at offset %zu\n", pos);
+
+        if (keep) {
+            memcpy(out + pos, buf + pos, hdr.size);
+            result->new_size = pos + hdr.size;
+        }
+        if (has_image) {
+            if (keep) result->num_kept++;
+            else      result->num_removed++;
+        }
+        pos += hdr.size;
+    }
     return LIBORKH_SUCCESS;
-}
\ No newline at end of file
+}
@@ -0,0 +1,178 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include <zstd.h>
+
+#include "liborkh.h"
+#include "liborkh_compress.h"
+
+// -------------- MD5 (RFC 1321), only used for the CCOB header hash --------------
+
+static const uint32_t __md5_k[64] = {
+    0xd76aa478, 0xe8c7b756, 0x242070db, 0xc1bdceee, 0xf57c0faf, 0x4787c62a, 0xa8304613, 0xfd469501,
+    0x698098d8, 0x8b44f7af, 0xffff5bb1, 0x895cd7be, 0x6b901122, 0xfd987193, 0xa679438e, 0x49b40821,
+    0xf61e2562, 0xc040b340, 0x265e5a51, 0xe9b6c7aa, 0xd62f105d, 0x02441453, 0xd8a1e681, 0xe7d3fbc8,
+    0x21e1cde6, 0xc33707d6, 0xf4d50d87, 0x455a14ed, 0xa9e3e905, 0xfcefa3f8, 0x676f02d9, 0x8d2a4c8a,
+    0xfffa3942, 0x8771f681, 0x6d9d6122, 0xfde5380c, 0xa4beea44, 0x4bdecfa9, 0xf6bb4b60, 0xbebfbc70,
+    0x289b7ec6, 0xeaa127fa, 0xd4ef3085, 0x04881d05, 0xd9d4d039, 0xe6db99e5, 0x1fa27cf8, 0xc4ac5665,
+    0xf4292244, 0x432aff97, 0xab9423a7, 0xfc93a039, 0x655b59c3, 0x8f0ccc92, 0xffeff47d, 0x85845dd1,
+    0x6fa87e4f, 0xfe2ce6e0, 0xa3014314, 0x4e0811a1, 0xf7537e82, 0xbd3af235, 0x2ad7d2bb, 0xeb86d391,
+};
+
+static const uint8_t __md5_r[64] = {
+    7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22, 7, 12, 17, 22,
+    5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20, 5,  9, 14, 20,
+    4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23, 4, 11, 16, 23,
+    6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21, 6, 10, 15, 21,
+};
+
+static void __md5_block(uint32_t h[4], const uint8_t* block) {
+    uint32_t w[16];
+    for (int i = 0; i < 16; i++) {
+        w[i] = (uint32_t) block[i * 4] | (uint32_t) block[i * 4 + 1] << 8 | (uint32_t) block[i * 4 + 2] << 16 | (uint32_t) block[i * 4 + 3] << 24;
+    }
+
+    uint32_t a = h[0], b = h[1], c = h[2], d = h[3];
+    for (int i = 0; i < 64; i++) {
+        uint32_t f;
+        int g;
+        if (i < 16)      { f = (b & c) | (~b & d); g = i; }
+        else if (i < 32) { f = (d & b) | (~d & c); g = (5 * i + 1) & 15; }
+        else if (i < 48) { f = b ^ c ^ d;          g = (3 * i + 5) & 15; }
+        else             { f = c ^ (b | ~d);       g = (7 * i) & 15; }
+
+        uint32_t tmp = d;
+        d = c;
+        c = b;
+        uint32_t x = a + f + __md5_k[i] + w[g];
+        b = b + ((x << __md5_r[i]) | (x >> (32 - __md5_r[i])));
+        a = tmp;
+    }
+    h[0] += a;
+    h[1] += b;
+    h[2] += c;
+    h[3] += d;
+}
+
+/**
+ * Low 64 bits of the MD5 digest read as a little endian integer, the value
+ * clang-offload-bundler stores in CCOB headers.
+ */
+uint64_t liborkh_md5_low64(const uint8_t* data, size_t size) {
+    uint32_t h[4] = { 0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476 };
+
+    size_t full = size & ~(size_t) 63;
+    for (size_t i = 0; i < full; i += 64) __md5_block(h, data + i);
+
+    uint8_t tail[128] = {0};
+    size_t rest = size - full;
+    memcpy(tail, data + full, rest);
+    tail[rest] = 0x80;
+    size_t tail_size = rest < 56 ? 64 : 128;
+    uint64_t bits = (uint64_t) size * 8;
+    for (int i = 0; i < 8; i++) tail[tail_size - 8 + i] = (uint8_t) (bits >> (8 * i));
+
+    __md5_block(h, tail);
+    if (tail_size == 128) __md5_block(h, tail + 64);
+
+    return (uint64_t) h[0] | (uint64_t) h[1] << 32;
+}
+
+
+// -------------- CCOB writer --------------
+
+static void __write_u16(uint8_t* buf, size_t* pos, uint16_t value) {
+    memcpy(buf + *pos, &value, sizeof(value));
+    *pos += sizeof(value);
+}
+
+static void __write_u32(uint8_t* buf, size_t* pos, uint32_t value) {
+    memcpy(buf + *pos, &value, sizeof(value));
+    *pos += sizeof(value);
+}
+
+static void __write_u64(uint8_t* buf, size_t* pos, uint64_t value) {
+    memcpy(buf + *pos, &value, sizeof(value));
+    *pos += sizeof(value);
+}
+
+static liborkh_status_t __zstd_compress(const liborkh_ccob_options_t* options, const uint8_t* data, size_t size, uint8_t* out, size_t capacity, size_t* out_size) {
+    ZSTD_CCtx* cctx = ZSTD_createCCtx();
+    LIBORKH_CHECK_ALLOC(cctx);
+
+    size_t ret = ZSTD_CCtx_setParameter(cctx, ZSTD_c_compressionLevel, options->level ? options->level : LIBORKH_CCOB_DEFAULT_ZSTD_LEVEL);
+    if (!ZSTD_isError(ret) && options->long_distance) ret = ZSTD_CCtx_setParameter(cctx, ZSTD_c_enableLongDistanceMatching, 1);
+    if (!ZSTD_isError(ret) && options->num_threads > 0) {
+        // Fails when libzstd is built without multithreading support
+        if (ZSTD_isError(ZSTD_CCtx_setParameter(cctx, ZSTD_c_nbWorkers, options->num_threads))) {
+            liborkh_log_warn("libzstd without multithreading support, compressing on one thread\n");
+        }
+    }
+    if (!ZSTD_isError(ret)) ret = ZSTD_compress2(cctx, out, capacity, data, size);
+    ZSTD_freeCCtx(cctx);
+
+    if (ZSTD_isError(ret)) {
+        liborkh_log_err("ZSTD error: %s\n", ZSTD_getErrorName(ret));
+        return LIBORKH_ERROR_UNKNOWN;
+    }
+    *out_size = ret;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_ccob_compress_ex(const liborkh_ccob_options_t* options, const uint8_t* data, size_t size, const uint64_t* hash, uint8_t** out, size_t* out_size) {
+    LIBORKH_CHECK_ARGUMENTS(!options || !data || !out || !out_size || options->codec >= CCOB_COMPRESSION_COUNT || (options->version != 2 && options->version != 3));
+
+    size_t bound = options->codec == CCOB_COMPRESSION_ZLIB ? compressBound(size) : ZSTD_compressBound(size);
+    size_t header_size = LIBORKH_CCOB_HEADER_SIZE_V3; // large enough for both versions
+
+    uint8_t* buf = liborkh_malloc(LIBORKH_ALLOC_STAGE_IO, header_size + bound);
+    LIBORKH_CHECK_ALLOC(buf);
+
+    size_t payload_size = 0;
+    if (options->codec == CCOB_COMPRESSION_ZLIB) {
+        uLongf dest_len = bound;
+        if (compress2(buf + header_size, &dest_len, data, size, options->level ? options->level : LIBORKH_CCOB_DEFAULT_ZLIB_LEVEL) != Z_OK) {
+            liborkh_free(buf);
+            return LIBORKH_ERROR_UNKNOWN;
+        }
+        payload_size = dest_len;
+    } else {
+        liborkh_status_t status = __zstd_compress(options, data, size, buf + header_size, bound, &payload_size);
+        if (status != LIBORKH_SUCCESS) {
+            liborkh_free(buf);
+            return status;
+        }
+    }
+
+    // Version 2 stores 32 bit sizes
+    uint16_t version = options->version;
+    if (version == 2 && (size > UINT32_MAX || LIBORKH_CCOB_HEADER_SIZE_V2 + payload_size > UINT32_MAX)) version = 3;
+    if (version == 2) {
+        memmove(buf + LIBORKH_CCOB_HEADER_SIZE_V2, buf + header_size, payload_size);
+        header_size = LIBORKH_CCOB_HEADER_SIZE_V2;
+    }
+
+    size_t pos = 0;
+    memcpy(buf, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC, COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE);
+    pos += COMPRESSION_CLANG_OFFLOAD_BUNDLER_MAGIC_SIZE;
+    __write_u16(buf, &pos, version);
+    __write_u16(buf, &pos, (uint16_t) options->codec);
+    if (version == 2) {
+        __write_u32(buf, &pos, (uint32_t) (header_size + payload_size));
+        __write_u32(buf, &pos, (uint32_t) size);
+    } else {
+        __write_u64(buf, &pos, header_size + payload_size);
+        __write_u64(buf, &pos, size);
+    }
+    __write_u64(buf, &pos, hash ? *hash : liborkh_md5_low64(data, size));
+
+    *out = buf;
+    *out_size = header_size + payload_size;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_ccob_compress(liborkh_ccob_compression_t codec, uint16_t version, int level, const uint8_t* data, size_t size, uint8_t** out, size_t* out_size) {
+    liborkh_ccob_options_t options = { .codec = codec, .version = version, .level = level };
+    return liborkh_ccob_compress_ex(&options, data, size, NULL, out, out_size);
+}
@@ -0,0 +1,532 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <glob.h>
+#include <limits.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <gelf.h>
+#include <libelf.h>
+
+#include "liborkh.h"
+#include "liborkh_deps.h"
+
+#define LIBORKH_LD_SO_CONF          "/etc/ld.so.conf"
+#define LIBORKH_LD_SO_CONF_DEPTH    8
+
+// Dynamic section of one object of the closure, only kept while resolving
+typedef struct {
+    char* rpath;
+    char* runpath;
+    size_t parent; // index of the object that loaded this one
+} __liborkh_dep_info_t;
+
+typedef struct {
+    size_t count;
+    size_t capacity;
+    char** dirs;
+} __liborkh_dir_list_t;
+
+typedef struct {
+    unsigned char elf_class;
+    uint16_t machine;
+    __liborkh_dep_info_t* infos;
+    __liborkh_dir_list_t ld_so_conf;
+} __liborkh_resolver_t;
+
+
+static liborkh_status_t __dir_list_add(__liborkh_dir_list_t* list, const char* dir, size_t len) {
+    while (len > 1 && dir[len - 1] == '/') len--;
+    if (len == 0) return LIBORKH_SUCCESS;
+
+    if (list->count >= list->capacity) {
+        size_t new_capacity = list->capacity ? list->capacity * 2 : 16;
+        char** tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, list->dirs, new_capacity * sizeof(char*));
+        LIBORKH_CHECK_ALLOC(tmp);
+        list->dirs = tmp;
+        list->capacity = new_capacity;
+    }
+
+    char* copy = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, len + 1);
+    LIBORKH_CHECK_ALLOC(copy);
+    memcpy(copy, dir, len);
+    copy[len] = '\0';
+    list->dirs[list->count++] = copy;
+    return LIBORKH_SUCCESS;
+}
+
+static void __dir_list_free(__liborkh_dir_list_t* list) {
+    for (size_t i = 0; i < list->count; i++) {
+        liborkh_free(list->dirs[i]);
+    }
+    liborkh_free(list->dirs);
+    list->dirs = NULL;
+    list->count = list->capacity = 0;
+}
+
+/**
+ * Read an ld.so.conf file: one directory per line, "include <glob>" lines
+ * are followed recursively (relative patterns are relative to /etc).
+ */
+static void __read_ld_so_conf(__liborkh_dir_list_t* list, const char* filename, int depth) {
+    if (depth > LIBORKH_LD_SO_CONF_DEPTH) return;
+
+    FILE* f = fopen(filename, "r");
+    if (!f) return;
+
+    char line[4096];
+    while (fgets(line, sizeof(line), f)) {
+        char* hash = strchr(line, '#');
+        if (hash) *hash = '\0';
+
+        char* p = line;
+        while (*p == ' ' || *p == '\t') p++;
+        size_t len = strcspn(p, "\r\n");
+        while (len > 0 && (p[len - 1] == ' ' || p[len - 1] == '\t')) len--;
+        p[len] = '\0';
+        if (len == 0) continue;
+
+        if (strncmp(p, "include", 7) == 0 && (p[7] == ' ' || p[7] == '\t')) {
+            char* pattern = p + 8;
+            while (*pattern == ' ' || *pattern == '\t') pattern++;
+
+            char path[4096];
+            if (pattern[0] == '/') {
+                snprintf(path, sizeof(path), "%s", pattern);
+            } else {
+                snprintf(path, sizeof(path), "/etc/%s", pattern);
+            }
+
+            glob_t matches;
+            if (glob(path, 0, NULL, &matches) == 0) {
+                for (size_t i = 0; i < matches.gl_pathc; i++) {
+                    __read_ld_so_conf(list, matches.gl_pathv[i], depth + 1);
+                }
+            }
+            globfree(&matches);
+        } else if (p[0] == '/') {
+            __dir_list_add(list, p, len);
+        }
+    }
+    fclose(f);
+}
+
+/**
+ * Expand $ORIGIN / ${ORIGIN} (directory of the loading object) and $LIB / ${LIB}
+ * in one search path component. Unknown tokens are kept verbatim.
+ */
+static void __expand_dir(char* out, size_t out_size, const char* dir, size_t len, const char* origin, unsigned char elf_class) {
+    const char* lib = elf_class == ELFCLASS64 ? "lib64" : "lib";
+    size_t pos = 0;
+
+    for (size_t i = 0; i < len && pos + 1 < out_size;) {
+        const char* value = NULL;
+        size_t skip = 0;
+
+        if (dir[i] == '$') {
+            const char* rest = dir + i + 1;
+            size_t rest_len = len - i - 1;
+            if (rest_len >= 8 && strncmp(rest, "{ORIGIN}", 8) == 0)    { value = origin; skip = 9; }
+            else if (rest_len >= 6 && strncmp(rest, "ORIGIN", 6) == 0) { value = origin; skip = 7; }
+            else if (rest_len >= 5 && strncmp(rest, "{LIB}", 5) == 0)  { value = lib;    skip = 6; }
+            else if (rest_len >= 3 && strncmp(rest, "LIB", 3) == 0)    { value = lib;    skip = 4; }
+        }
+
+        if (value) {
+            pos += (size_t) snprintf(out + pos, out_size - pos, "%s", value);
+            if (pos >= out_size) pos = out_size - 1;
+            i += skip;
+        } else {
+            out[pos++] = dir[i++];
+        }
+    }
+    out[pos] = '\0';
+}
+
+/**
+ * Check that the candidate is an ELF shared object of the executable's class
+ * and machine, the loader skips the others (e.g. 32-bit libraries).
+ */
+static bool __is_compatible_elf(const __liborkh_resolver_t* resolver, const char* path) {
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return false;
+
+    unsigned char ident[EI_NIDENT + 4];
+    ssize_t n = pread(fd, ident, sizeof(ident), 0);
+    close(fd);
+
+    if (n != (ssize_t) sizeof(ident) || memcmp(ident, ELFMAG, SELFMAG) != 0) return false;
+    if (ident[EI_CLASS] != resolver->elf_class) return false;
+
+    // e_type (2 bytes) then e_machine, in the file's byte order
+    uint16_t machine = ident[EI_DATA] == ELFDATA2MSB
+                     ? (uint16_t) (ident[EI_NIDENT + 2] << 8 | ident[EI_NIDENT + 3])
+                     : (uint16_t) (ident[EI_NIDENT + 3] << 8 | ident[EI_NIDENT + 2]);
+    return machine == resolver->machine;
+}
+
+static bool __search_path(const __liborkh_resolver_t* resolver, const char* search, const char* origin, const char* name, char* out, size_t out_size) {
+    if (!search) return false;
+
+    for (const char* p = search;;) {
+        size_t len = strcspn(p, ":;");
+        char dir[PATH_MAX];
+
+        if (len == 0) {
+            snprintf(dir, sizeof(dir), "."); // empty component is the current directory
+        } else {
+            __expand_dir(dir, sizeof(dir), p, len, origin, resolver->elf_class);
+        }
+
+        int n = snprintf(out, out_size, "%s/%s", dir, name);
+        if (n > 0 && (size_t) n < out_size && __is_compatible_elf(resolver, out)) return true;
+
+        if (p[len] == '\0') break;
+        p += len + 1;
+    }
+    return false;
+}
+
+static bool __search_dirs(const __liborkh_resolver_t* resolver, const __liborkh_dir_list_t* list, const char* name, char* out, size_t out_size) {
+    for (size_t i = 0; i < list->count; i++) {
+        int n = snprintf(out, out_size, "%s/%s", list->dirs[i], name);
+        if (n > 0 && (size_t) n < out_size && __is_compatible_elf(resolver, out)) return true;
+    }
+    return false;
+}
+
+static void __dirname(const char* path, char* out, size_t out_size) {
+    const char* slash = strrchr(path, '/');
+    if (!slash) {
+        snprintf(out, out_size, ".");
+    } else if (slash == path) {
+        snprintf(out, out_size, "/");
+    } else {
+        snprintf(out, out_size, "%.*s", (int) (slash - path), path);
+    }
+}
+
+/**
+ * Search order of the glibc dynamic loader: DT_RPATH of the loader chain
+ * (only when the loading object has no DT_RUNPATH), LD_LIBRARY_PATH, DT_RUNPATH
+ * of the loading object, ld.so.conf directories, then the default paths.
+ */
+static bool __resolve_library(const __liborkh_resolver_t* resolver, const liborkh_program_t* program, size_t loader, const char* name, char* out, size_t out_size) {
+    char origin[PATH_MAX];
+
+    if (strchr(name, '/')) {
+        __dirname(program->libraries[loader].path, origin, sizeof(origin));
+        __expand_dir(out, out_size, name, strlen(name), origin, resolver->elf_class);
+        return __is_compatible_elf(resolver, out);
+    }
+
+    const __liborkh_dep_info_t* info = &resolver->infos[loader];
+    if (!info->runpath) {
+        for (size_t i = loader;; i = resolver->infos[i].parent) {
+            __dirname(program->libraries[i].path, origin, sizeof(origin));
+            const char* rpath = resolver->infos[i].runpath ? NULL : resolver->infos[i].rpath;
+            if (__search_path(resolver, rpath, origin, name, out, out_size)) return true;
+            if (i == 0) break;
+        }
+    }
+
+    __dirname(program->libraries[loader].path, origin, sizeof(origin));
+    if (__search_path(resolver, getenv("LD_LIBRARY_PATH"), origin, name, out, out_size)) return true;
+    if (__search_path(resolver, info->runpath, origin, name, out, out_size)) return true;
+    if (__search_dirs(resolver, &resolver->ld_so_conf, name, out, out_size)) return true;
+
+    const char* defaults = resolver->elf_class == ELFCLASS64 ? "/lib64:/usr/lib64:/lib:/usr/lib" : "/lib:/usr/lib";
+    return __search_path(resolver, defaults, origin, name, out, out_size);
+}
+
+static liborkh_status_t __program_add(liborkh_program_t* program, __liborkh_resolver_t* resolver, const char* name, const char* path, size_t parent) {
+    if (program->count >= program->capacity) {
+        size_t new_capacity = program->capacity ? program->capacity * 2 : 32;
+
+        liborkh_program_library_t* libraries = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, program->libraries, new_capacity * sizeof(liborkh_program_library_t));
+        LIBORKH_CHECK_ALLOC(libraries);
+        program->libraries = libraries;
+
+        __liborkh_dep_info_t* infos = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, resolver->infos, new_capacity * sizeof(__liborkh_dep_info_t));
+        LIBORKH_CHECK_ALLOC(infos);
+        resolver->infos = infos;
+
+        program->capacity = new_capacity;
+    }
+
+    liborkh_program_library_t* library = &program->libraries[program->count];
+    memset(library, 0, sizeof(*library));
+    memset(&resolver->infos[program->count], 0, sizeof(__liborkh_dep_info_t));
+    resolver->infos[program->count].parent = parent;
+    program->count++; // counted first so that liborkh_program_close() releases the strings on failure
+
+    library->name = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, name);
+    LIBORKH_CHECK_ALLOC(library->name);
+
+    if (!path) {
+        library->status = LIBORKH_ERROR_OPEN_FILE;
+        return LIBORKH_SUCCESS;
+    }
+
+    library->path = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, path);
+    LIBORKH_CHECK_ALLOC(library->path);
+
+    struct stat st;
+    if (stat(path, &st) != 0) {
+        library->status = LIBORKH_ERROR_OPEN_FILE;
+        return LIBORKH_SUCCESS;
+    }
+    library->dev   = (uint64_t) st.st_dev;
+    library->inode = (uint64_t) st.st_ino;
+    return LIBORKH_SUCCESS;
+}
+
+static bool __program_contains(const liborkh_program_t* program, const char* path) {
+    struct stat st;
+    if (stat(path, &st) != 0) return false;
+
+    for (size_t i = 0; i < program->count; i++) {
+        const liborkh_program_library_t* library = &program->libraries[i];
+        if (library->path && library->dev == (uint64_t) st.st_dev && library->inode == (uint64_t) st.st_ino) return true;
+    }
+    return false;
+}
+
+static bool __program_contains_missing(const liborkh_program_t* program, const char* name) {
+    for (size_t i = 0; i < program->count; i++) {
+        if (!program->libraries[i].path && strcmp(program->libraries[i].name, name) == 0) return true;
+    }
+    return false;
+}
+
+/**
+ * Read DT_NEEDED, DT_RPATH and DT_RUNPATH of one object and append the libraries
+ * it needs to the program (breadth-first: the program array is the work queue).
+ */
+static liborkh_status_t __load_dependencies(liborkh_program_t* program, __liborkh_resolver_t* resolver, size_t index) {
+    Elf* elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf(program->libraries[index].path, &elf), "Failed to open %s\n", program->libraries[index].path);
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    GElf_Ehdr ehdr;
+    if (gelf_getehdr(elf, &ehdr) != &ehdr) {
+        liborkh_log_err("gelf_getehdr() failed: %s\n", elf_errmsg(-1));
+        liborkh_close_elf(elf);
+        return LIBORKH_ERROR_ELF;
+    }
+    if (index == 0) {
+        resolver->elf_class = ehdr.e_ident[EI_CLASS];
+        resolver->machine   = ehdr.e_machine;
+    }
+
+    Elf_Scn* scn = NULL;
+    GElf_Shdr shdr;
+    Elf_Data* dynamic = NULL;
+    size_t strtab = 0, num_dyns = 0;
+
+    while ((scn = elf_nextscn(elf, scn)) != NULL) {
+        if (gelf_getshdr(scn, &shdr) == &shdr && shdr.sh_type == SHT_DYNAMIC) {
+            dynamic  = elf_getdata(scn, NULL);
+            strtab   = shdr.sh_link;
+            num_dyns = shdr.sh_entsize ? shdr.sh_size / shdr.sh_entsize : 0;
+            break;
+        }
+    }
+
+    // First pass for the search paths, which apply to every DT_NEEDED whatever their order
+    for (size_t i = 0; dynamic && i < num_dyns && status == LIBORKH_SUCCESS; i++) {
+        GElf_Dyn dyn;
+        if (gelf_getdyn(dynamic, (int) i, &dyn) != &dyn || dyn.d_tag == DT_NULL) break;
+        if (dyn.d_tag != DT_RPATH && dyn.d_tag != DT_RUNPATH) continue;
+
+        const char* value = elf_strptr(elf, strtab, dyn.d_un.d_val);
+        if (!value) continue;
+
+        char** field = dyn.d_tag == DT_RPATH ? &resolver->infos[index].rpath : &resolver->infos[index].runpath;
+        if (*field) continue;
+        *field = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, value);
+        if (!*field) status = LIBORKH_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (size_t i = 0; dynamic && i < num_dyns && status == LIBORKH_SUCCESS; i++) {
+        GElf_Dyn dyn;
+        if (gelf_getdyn(dynamic, (int) i, &dyn) != &dyn || dyn.d_tag == DT_NULL) break;
+        if (dyn.d_tag != DT_NEEDED) continue;
+
+        const char* name = elf_strptr(elf, strtab, dyn.d_un.d_val);
+        if (!name) continue;
+
+        char path[PATH_MAX];
+        if (__resolve_library(resolver, program, index, name, path, sizeof(path))) {
+            if (__program_contains(program, path)) continue;
+            status = __program_add(program, resolver, name, path, index);
+        } else if (!__program_contains_missing(program, name)) {
+            liborkh_log_warn("%s: needed library %s not found\n", program->libraries[index].path, name);
+            status = __program_add(program, resolver, name, NULL, index);
+        }
+    }
+
+    liborkh_close_elf(elf);
+    return status;
+}
+
+liborkh_status_t liborkh_program_open(const char* filename, liborkh_program_t** program) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !program);
+
+    *program = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_program_t));
+    LIBORKH_CHECK_ALLOC(*program);
+
+    __liborkh_resolver_t resolver = {0};
+    __read_ld_so_conf(&resolver.ld_so_conf, LIBORKH_LD_SO_CONF, 0);
+
+    liborkh_status_t status = __program_add(*program, &resolver, filename, filename, 0);
+    if (status == LIBORKH_SUCCESS && (*program)->libraries[0].status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to open file: %s\n", filename);
+        status = LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    for (size_t i = 0; status == LIBORKH_SUCCESS && i < (*program)->count; i++) {
+        if (!(*program)->libraries[i].path) continue;
+
+        liborkh_status_t load_status = __load_dependencies(*program, &resolver, i);
+        if (load_status == LIBORKH_ERROR_OUT_OF_MEMORY || i == 0) {
+            status = load_status;
+        } else if (load_status != LIBORKH_SUCCESS) {
+            (*program)->libraries[i].status = load_status; // keep resolving the rest of the closure
+        }
+    }
+
+    for (size_t i = 0; i < (*program)->count; i++) {
+        liborkh_free(resolver.infos[i].rpath);
+        liborkh_free(resolver.infos[i].runpath);
+    }
+    liborkh_free(resolver.infos);
+    __dir_list_free(&resolver.ld_so_conf);
+
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_program_close(*program);
+        *program = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_program_close(liborkh_program_t* program) {
+    LIBORKH_CHECK_ARGUMENTS(!program);
+
+    for (size_t i = 0; i < program->count; i++) {
+        liborkh_free(program->libraries[i].name);
+        liborkh_free(program->libraries[i].path);
+    }
+    liborkh_free(program->libraries);
+    if (program->pool) liborkh_gpu_elf_pool_free(program->pool);
+    liborkh_free(program);
+    return LIBORKH_SUCCESS;
+}
+
+
+typedef struct {
+    liborkh_program_t* program;
+    liborkh_entry_filter_t* filter;
+    liborkh_gpu_elf_concurrent_pool_t* pool;
+} __liborkh_program_scan_t;
+
+typedef struct {
+    liborkh_gpu_elf_concurrent_pool_t* pool;
+    size_t index;
+    size_t num_entries;
+    size_t num_kernels;
+    liborkh_status_t status;
+} __liborkh_library_visit_t;
+
+// Count the kernels on the borrowed image, publish the entry without copying it, keyed by library index
+static liborkh_visit_action_t __library_visitor(liborkh_gpu_elf_entry_t* entry, void* user_data) {
+    __liborkh_library_visit_t* visit = (__liborkh_library_visit_t*) user_data;
+
+    size_t num_kernels = 0;
+    if (entry->elf && liborkh_get_number_kernels_in_entry(entry, &num_kernels) == LIBORKH_SUCCESS) {
+        visit->num_kernels += num_kernels;
+    }
+
+    entry->elf = NULL;
+    entry->flags &= ~LIBORKH_ENTRY_BORROWED_ELF;
+
+    visit->status = liborkh_gpu_elf_concurrent_pool_push(visit->pool, visit->index, entry);
+    if (visit->status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to add entry to pool\n");
+        return LIBORKH_VISIT_STOP;
+    }
+    visit->num_entries++;
+    return LIBORKH_VISIT_TAKE;
+}
+
+static liborkh_status_t __scan_library(liborkh_program_library_t* library, size_t index, liborkh_entry_filter_t* filter, liborkh_gpu_elf_concurrent_pool_t* pool) {
+    library->num_kernels = 0;
+
+    Elf* elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf(library->path, &elf), "Failed to open %s\n", library->path);
+
+    liborkh_offload_buffer fatbin_buf = {0};
+    liborkh_status_t status = liborkh_extract_gpu_fatbin(elf, &fatbin_buf);
+    liborkh_close_elf(elf);
+    if (status != LIBORKH_SUCCESS || !fatbin_buf.buf) {
+        return status;
+    }
+
+    __liborkh_library_visit_t visit = { pool, index, 0, 0, LIBORKH_SUCCESS };
+    status = liborkh_visit_gpu_elfs(&fatbin_buf, filter, __library_visitor, &visit);
+    if (status == LIBORKH_SUCCESS) status = visit.status;
+    liborkh_free(fatbin_buf.buf);
+
+    // Published entries stay in the pool even on failure
+    library->num_entries = visit.num_entries;
+    if (status == LIBORKH_SUCCESS) library->num_kernels = visit.num_kernels;
+    return status;
+}
+
+static void __program_worker(size_t index, void* user_data) {
+    __liborkh_program_scan_t* scan = (__liborkh_program_scan_t*) user_data;
+
+    liborkh_program_library_t* library = &scan->program->libraries[index];
+    if (!library->path || library->status != LIBORKH_SUCCESS) return;
+
+    library->status = __scan_library(library, index, scan->filter, scan->pool);
+    if (library->status != LIBORKH_SUCCESS) {
+        liborkh_log_warn("Failed to scan library %s\n", library->path);
+    }
+}
+
+liborkh_status_t liborkh_program_scan(liborkh_program_t* program, liborkh_entry_filter_t* filter, size_t num_threads) {
+    LIBORKH_CHECK_ARGUMENTS(!program || program->count == 0);
+
+    if (program->pool) {
+        liborkh_gpu_elf_pool_free(program->pool);
+        program->pool = NULL;
+    }
+    program->num_kernels = 0;
+    LIBORKH_CHECK_CALL(liborkh_gpu_elf_pool_init(&program->pool, program->count), "Failed to initialize pool\n");
+
+    for (size_t i = 0; i < program->count; i++) {
+        program->libraries[i].num_entries = 0;
+    }
+
+    __liborkh_program_scan_t scan = { program, filter, NULL };
+    LIBORKH_CHECK_CALL(liborkh_gpu_elf_concurrent_pool_init(&scan.pool, program->count * 4), "Failed to initialize pool\n");
+
+    liborkh_status_t status = liborkh_parallel_for(program->count, num_threads, __program_worker, &scan);
+
+    // Entries are keyed by library index so that the inventory follows load order, not scheduling
+    if (status == LIBORKH_SUCCESS) status = liborkh_gpu_elf_concurrent_pool_finalize(scan.pool, program->pool);
+    liborkh_gpu_elf_concurrent_pool_free(scan.pool);
+
+    size_t first_entry = 0;
+    for (size_t i = 0; i < program->count; i++) {
+        liborkh_program_library_t* library = &program->libraries[i];
+        if (status != LIBORKH_SUCCESS) library->num_entries = 0;
+
+        library->first_entry = first_entry;
+        first_entry += library->num_entries;
+        program->num_kernels += library->num_kernels;
+    }
+    return status;
+}
@@ -0,0 +1,321 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_diff.h"
+
+typedef struct {
+    liborkh_gpu_elf_entry_t* entry;
+    size_t ordinal;                  // rank among the entries of the same key
+} __liborkh_diff_item_t;
+
+typedef struct {
+    char* name;
+    liborkh_hash128_t hash;
+    bool is_function;
+} __liborkh_diff_symbol_t;
+
+typedef struct {
+    size_t count;
+    __liborkh_diff_symbol_t* symbols;
+} __liborkh_diff_kernels_t;
+
+const char* liborkh_diff_kind_to_string(liborkh_diff_kind_t kind) {
+    switch (kind) {
+        case LIBORKH_DIFF_ADDED:   return "added";
+        case LIBORKH_DIFF_REMOVED: return "removed";
+        case LIBORKH_DIFF_CHANGED: return "changed";
+        default:                   return "unknown";
+    }
+}
+
+static int __strcmp_null(const char* a, const char* b) {
+    return strcmp(a ? a : "", b ? b : "");
+}
+
+static int __key_compare(const liborkh_gpu_elf_entry_t* x, const liborkh_gpu_elf_entry_t* y) {
+    if (x->ofk != y->ofk) return x->ofk < y->ofk ? -1 : 1;
+    int cmp = __strcmp_null(x->target_triple, y->target_triple);
+    return cmp != 0 ? cmp : __strcmp_null(x->target_arch, y->target_arch);
+}
+
+static int __item_compare(const void* a, const void* b) {
+    const __liborkh_diff_item_t* x = (const __liborkh_diff_item_t*) a;
+    const __liborkh_diff_item_t* y = (const __liborkh_diff_item_t*) b;
+
+    int cmp = __key_compare(x->entry, y->entry);
+    if (cmp != 0) return cmp;
+    return x->entry->id < y->entry->id ? -1 : (x->entry->id > y->entry->id);
+}
+
+static int __symbol_compare(const void* a, const void* b) {
+    return strcmp(((const __liborkh_diff_symbol_t*) a)->name, ((const __liborkh_diff_symbol_t*) b)->name);
+}
+
+// Entries with an image, sorted by key then pool order, with their rank inside the key
+static liborkh_status_t __sorted_items(const liborkh_gpu_elf_pool_t* pool, __liborkh_diff_item_t** items, size_t* count) {
+    *items = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (pool->count + 1) * sizeof(__liborkh_diff_item_t));
+    LIBORKH_CHECK_ALLOC(*items);
+
+    *count = 0;
+    for (size_t i = 0; i < pool->count; i++) {
+        if (!pool->entries[i]->elf || pool->entries[i]->elf_size == 0) continue;
+        (*items)[(*count)++].entry = pool->entries[i];
+    }
+    qsort(*items, *count, sizeof(__liborkh_diff_item_t), __item_compare);
+
+    for (size_t i = 0; i < *count; i++) {
+        bool same_key = i > 0 && __key_compare((*items)[i - 1].entry, (*items)[i].entry) == 0;
+        (*items)[i].ordinal = same_key ? (*items)[i - 1].ordinal + 1 : 0;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+static void __kernels_free(__liborkh_diff_kernels_t* kernels) {
+    for (size_t i = 0; i < kernels->count; i++) liborkh_free(kernels->symbols[i].name);
+    liborkh_free(kernels->symbols);
+    kernels->symbols = NULL;
+    kernels->count = 0;
+}
+
+static liborkh_status_t __read_symbols(const liborkh_elf_section_table_t* sections, const liborkh_gpu_elf_entry_t* entry, const liborkh_elf_section_t* symtab, __liborkh_diff_kernels_t* kernels) {
+    Elf* elf = sections->elf;
+    GElf_Shdr symtab_shdr;
+    Elf_Data* data = elf_getdata(symtab->scn, NULL);
+    if (!data || gelf_getshdr(symtab->scn, &symtab_shdr) != &symtab_shdr || symtab_shdr.sh_entsize == 0) return LIBORKH_ERROR_ELF;
+
+    size_t num_symbols = symtab_shdr.sh_size / symtab_shdr.sh_entsize;
+    kernels->symbols = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, num_symbols + 1, sizeof(__liborkh_diff_symbol_t));
+    LIBORKH_CHECK_ALLOC(kernels->symbols);
+
+    for (size_t i = 0; i < num_symbols; i++) {
+        GElf_Sym sym;
+        if (gelf_getsym(data, (int) i, &sym) != &sym) return LIBORKH_ERROR_ELF;
+
+        int type = GELF_ST_TYPE(sym.st_info);
+        if (type != STT_FUNC && type != STT_OBJECT) continue;
+        if (sym.st_shndx == SHN_UNDEF || sym.st_shndx >= SHN_LORESERVE) continue;
+
+        const char* name = elf_strptr(elf, symtab_shdr.sh_link, sym.st_name);
+        if (!name || !name[0]) continue;
+
+        __liborkh_diff_symbol_t* symbol = &kernels->symbols[kernels->count];
+        symbol->is_function = type == STT_FUNC;
+
+        // Code of the function, read from the image through its section
+        if (symbol->is_function) {
+            // Section headers are read once, the table is in section index order
+            if (sym.st_shndx == 0 || sym.st_shndx > sections->count) continue;
+            const liborkh_elf_section_t* section = &sections->sections[sym.st_shndx - 1];
+            if (section->type == SHT_NOBITS) continue;
+            if (sym.st_value < section->addr || sym.st_value - section->addr + sym.st_size > section->size) continue;
+
+            size_t offset = section->offset + (sym.st_value - section->addr);
+            if (check_bounds(offset, sym.st_size, entry->elf_size) != LIBORKH_SUCCESS) continue;
+            symbol->hash = liborkh_hash128(entry->elf + offset, sym.st_size, 0);
+        }
+
+        symbol->name = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, name);
+        LIBORKH_CHECK_ALLOC(symbol->name);
+        kernels->count++;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Kernels of a code object sorted by name: function symbols with a matching
+ * kernel descriptor symbol, or every function when the object has no descriptor.
+ */
+static liborkh_status_t __get_kernels(const liborkh_gpu_elf_entry_t* entry, __liborkh_diff_kernels_t* kernels) {
+    memset(kernels, 0, sizeof(*kernels));
+
+    Elf* elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &elf), "Cannot open ELF from memory\n");
+
+    liborkh_elf_section_table_t* sections = NULL;
+    liborkh_status_t status = liborkh_elf_section_table_build(elf, &sections);
+    for (size_t i = 0; status == LIBORKH_SUCCESS && i < sections->count; i++) {
+        if (sections->sections[i].type == SHT_SYMTAB) {
+            status = __read_symbols(sections, entry, &sections->sections[i], kernels);
+            break;
+        }
+    }
+    if (sections) liborkh_elf_section_table_free(sections);
+    liborkh_close_elf(elf);
+
+    if (status != LIBORKH_SUCCESS) {
+        __kernels_free(kernels);
+        return status;
+    }
+
+    qsort(kernels->symbols, kernels->count, sizeof(__liborkh_diff_symbol_t), __symbol_compare);
+
+    bool has_descriptors = false;
+    for (size_t i = 0; i < kernels->count && !has_descriptors; i++) {
+        size_t len = strlen(kernels->symbols[i].name);
+        has_descriptors = !kernels->symbols[i].is_function && len > 3 && strcmp(kernels->symbols[i].name + len - 3, LIBORKH_KERNEL_DESCRIPTOR_SUFFIX) == 0;
+    }
+
+    // Keep the kernels only, in place
+    size_t count = 0;
+    char descriptor[4096];
+    for (size_t i = 0; i < kernels->count; i++) {
+        __liborkh_diff_symbol_t* symbol = &kernels->symbols[i];
+        bool keep = symbol->is_function;
+        if (keep && has_descriptors) {
+            snprintf(descriptor, sizeof(descriptor), "%s" LIBORKH_KERNEL_DESCRIPTOR_SUFFIX, symbol->name);
+            __liborkh_diff_symbol_t key = { .name = descriptor };
+            keep = bsearch(&key, kernels->symbols, kernels->count, sizeof(__liborkh_diff_symbol_t), __symbol_compare) != NULL;
+        }
+        // Local symbols may share a name, keep the first one
+        if (keep && count > 0 && strcmp(kernels->symbols[count - 1].name, symbol->name) == 0) keep = false;
+
+        if (keep) {
+            kernels->symbols[count++] = *symbol;
+        } else {
+            liborkh_free(symbol->name);
+        }
+    }
+    kernels->count = count;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __add_record(liborkh_diff_t* diff, liborkh_diff_kind_t kind, const liborkh_gpu_elf_entry_t* old_entry, const liborkh_gpu_elf_entry_t* new_entry, const char* kernel) {
+    if (diff->count == diff->capacity) {
+        size_t capacity = diff->capacity ? diff->capacity * 2 : 16;
+        liborkh_diff_record_t* tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, diff->records, capacity * sizeof(liborkh_diff_record_t));
+        LIBORKH_CHECK_ALLOC(tmp);
+        diff->records = tmp;
+        diff->capacity = capacity;
+    }
+
+    const liborkh_gpu_elf_entry_t* entry = old_entry ? old_entry : new_entry;
+    liborkh_diff_record_t* record = &diff->records[diff->count];
+    memset(record, 0, sizeof(*record));
+    record->kind   = kind;
+    record->ofk    = entry->ofk;
+    record->old_id = old_entry ? old_entry->id : SIZE_MAX;
+    record->new_id = new_entry ? new_entry->id : SIZE_MAX;
+    diff->count++;
+
+    if (entry->target_triple) record->target_triple = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, entry->target_triple);
+    if (entry->target_arch)   record->target_arch   = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, entry->target_arch);
+    if (kernel)               record->kernel        = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, kernel);
+    if ((entry->target_triple && !record->target_triple) || (entry->target_arch && !record->target_arch) || (kernel && !record->kernel)) {
+        return LIBORKH_ERROR_OUT_OF_MEMORY;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+// Record a code object difference, followed by the differences of its kernels
+static liborkh_status_t __diff_entries(liborkh_diff_t* diff, liborkh_diff_kind_t kind, const liborkh_gpu_elf_entry_t* old_entry, const liborkh_gpu_elf_entry_t* new_entry) {
+    LIBORKH_CHECK_CALL(__add_record(diff, kind, old_entry, new_entry, NULL), "Cannot add diff record\n");
+
+    __liborkh_diff_kernels_t old_kernels = {0}, new_kernels = {0};
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    if (old_entry) status = __get_kernels(old_entry, &old_kernels);
+    if (status == LIBORKH_SUCCESS && new_entry) status = __get_kernels(new_entry, &new_kernels);
+
+    size_t i = 0, j = 0;
+    while (status == LIBORKH_SUCCESS && (i < old_kernels.count || j < new_kernels.count)) {
+        int cmp = i == old_kernels.count ? 1 : j == new_kernels.count ? -1 : strcmp(old_kernels.symbols[i].name, new_kernels.symbols[j].name);
+        if (cmp < 0) {
+            status = __add_record(diff, LIBORKH_DIFF_REMOVED, old_entry, NULL, old_kernels.symbols[i++].name);
+        } else if (cmp > 0) {
+            status = __add_record(diff, LIBORKH_DIFF_ADDED, NULL, new_entry, new_kernels.symbols[j++].name);
+        } else {
+            if (liborkh_hash128_equal(old_kernels.symbols[i].hash, new_kernels.symbols[j].hash)) {
+                diff->num_unchanged_kernels++;
+            } else {
+                status = __add_record(diff, LIBORKH_DIFF_CHANGED, old_entry, new_entry, old_kernels.symbols[i].name);
+            }
+            i++;
+            j++;
+        }
+    }
+
+    __kernels_free(&old_kernels);
+    __kernels_free(&new_kernels);
+    return status;
+}
+
+liborkh_status_t liborkh_diff_pools(liborkh_gpu_elf_pool_t* old_pool, liborkh_gpu_elf_pool_t* new_pool, liborkh_diff_t** diff) {
+    LIBORKH_CHECK_ARGUMENTS(!old_pool || !new_pool || !diff);
+
+    *diff = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_diff_t));
+    LIBORKH_CHECK_ALLOC(*diff);
+
+    __liborkh_diff_item_t *old_items = NULL, *new_items = NULL;
+    size_t num_old = 0, num_new = 0;
+    liborkh_status_t status = __sorted_items(old_pool, &old_items, &num_old);
+    if (status == LIBORKH_SUCCESS) status = __sorted_items(new_pool, &new_items, &num_new);
+
+    size_t i = 0, j = 0;
+    while (status == LIBORKH_SUCCESS && (i < num_old || j < num_new)) {
+        int cmp = 0;
+        if (i == num_old)      cmp = 1;
+        else if (j == num_new) cmp = -1;
+        else {
+            cmp = __key_compare(old_items[i].entry, new_items[j].entry);
+            if (cmp == 0 && old_items[i].ordinal != new_items[j].ordinal) cmp = old_items[i].ordinal < new_items[j].ordinal ? -1 : 1;
+        }
+
+        if (cmp < 0) {
+            status = __diff_entries(*diff, LIBORKH_DIFF_REMOVED, old_items[i++].entry, NULL);
+            continue;
+        }
+        if (cmp > 0) {
+            status = __diff_entries(*diff, LIBORKH_DIFF_ADDED, NULL, new_items[j++].entry);
+            continue;
+        }
+
+        liborkh_gpu_elf_entry_t* old_entry = old_items[i++].entry;
+        liborkh_gpu_elf_entry_t* new_entry = new_items[j++].entry;
+        liborkh_entry_compute_hash(old_entry);
+        liborkh_entry_compute_hash(new_entry);
+
+        // Same size and hash: unchanged, the images are not compared
+        if (old_entry->elf_size == new_entry->elf_size && liborkh_hash128_equal(old_entry->hash, new_entry->hash)) {
+            (*diff)->num_unchanged_entries++;
+        } else {
+            status = __diff_entries(*diff, LIBORKH_DIFF_CHANGED, old_entry, new_entry);
+        }
+    }
+
+    liborkh_free(old_items);
+    liborkh_free(new_items);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_diff_free(*diff);
+        *diff = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_diff_files(const char* old_filename, const char* new_filename, liborkh_entry_filter_t* filter, liborkh_diff_t** diff) {
+    LIBORKH_CHECK_ARGUMENTS(!old_filename || !new_filename || !diff);
+
+    liborkh_binary_t *old_binary = NULL, *new_binary = NULL;
+    LIBORKH_CHECK_CALL(liborkh_binary_open(old_filename, filter, &old_binary), "Cannot open %s\n", old_filename);
+
+    liborkh_status_t status = liborkh_binary_open(new_filename, filter, &new_binary);
+    if (status == LIBORKH_SUCCESS) {
+        status = liborkh_diff_pools(old_binary->pool, new_binary->pool, diff);
+        liborkh_binary_close(new_binary);
+    }
+    liborkh_binary_close(old_binary);
+    return status;
+}
+
+liborkh_status_t liborkh_diff_free(liborkh_diff_t* diff) {
+    LIBORKH_CHECK_ARGUMENTS(!diff);
+
+    for (size_t i = 0; i < diff->count; i++) {
+        liborkh_free(diff->records[i].target_triple);
+        liborkh_free(diff->records[i].target_arch);
+        liborkh_free(diff->records[i].kernel);
+    }
+    liborkh_free(diff->records);
+    liborkh_free(diff);
+    return LIBORKH_SUCCESS;
+}
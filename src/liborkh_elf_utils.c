@@ -2,23 +2,45 @@
 #include <stdlib.h>
 #include <unistd.h>
 #include <string.h>
+#include <stdbool.h>
 #include <fcntl.h>
+#include <pthread.h>
 #include <gelf.h>
 #include <libelf.h>
 
 #include "liborkh_utils.h"
 #include "liborkh_elf_utils.h"
 #include "liborkh_log.h"
+#include "liborkh_stats.h"
+#include "liborkh_trace.h"
+
+static pthread_once_t __elf_init_once = PTHREAD_ONCE_INIT;
+static unsigned int   __elf_version = EV_NONE;
+
+static void __elf_init(void) {
+    __elf_version = elf_version(EV_CURRENT);
+}
+
+/**
+ * Initialize libelf once per process, safe to call from any thread.
+ */
+liborkh_status_t liborkh_elf_init(void) {
+    pthread_once(&__elf_init_once, __elf_init);
+    if (__elf_version == EV_NONE) {
+        liborkh_log_err("ELF library initialization failed: %s\n", elf_errmsg(-1));
+        return LIBORKH_ERROR_ELF;
+    }
+    return LIBORKH_SUCCESS;
+}
 
 liborkh_status_t liborkh_open_elf(const char* filename, Elf **elf) {
     LIBORKH_CHECK_ARGUMENTS(!filename || !elf);
+
+    LIBORKH_TRACE_BEGIN(span);
    
     int fd = -1;
 
-    if (elf_version(EV_CURRENT) == EV_NONE) {
-        liborkh_log_err("ELF library initialization failed: %s\n", elf_errmsg(-1));
-        return LIBORKH_ERROR_ELF;
-    }
+    LIBORKH_CHECK_CALL(liborkh_elf_init(), "Cannot open %s\n", filename);
 
     fd = open(filename, O_RDONLY);
     if (fd < 0) {
@@ -26,23 +48,33 @@ liborkh_status_t liborkh_open_elf(const char* filename, Elf **elf) {
         return LIBORKH_ERROR_OPEN_FILE;
     }
 
-    *elf = elf_begin(fd, ELF_C_READ, NULL);
+    *elf = elf_begin(fd, ELF_C_READ_MMAP, NULL);
     if (!*elf) {
         liborkh_log_err("elf_begin() failed: %s\n", elf_errmsg(-1));
         close(fd);
         return LIBORKH_ERROR_ELF;
     }
 
+    // The file is mapped (or read if mmap failed), the descriptor is no longer needed
+    if (elf_cntl(*elf, ELF_C_FDREAD) != 0) {
+        liborkh_log_err("elf_cntl() failed: %s\n", elf_errmsg(-1));
+        elf_end(*elf);
+        close(fd);
+        return LIBORKH_ERROR_ELF;
+    }
+    close(fd);
+
+    LIBORKH_TRACE_END(span, "liborkh_open_elf", 0, -1, NULL);
     return LIBORKH_SUCCESS;
 }
 
 liborkh_status_t liborkh_open_elf_from_memory(const uint8_t* buf, size_t size, Elf **elf) {
     LIBORKH_CHECK_ARGUMENTS(!elf || !buf || size == 0);
 
-    if (elf_version(EV_CURRENT) == EV_NONE) {
-        liborkh_log_err("ELF library initialization failed: %s\n", elf_errmsg(-1));
-        return LIBORKH_ERROR_ELF;
-    }
+    LIBORKH_STATS_TIMER_START(open_timer);
+    LIBORKH_TRACE_BEGIN(span);
+
+    LIBORKH_CHECK_CALL(liborkh_elf_init(), "Cannot open ELF from memory\n");
 
     *elf = elf_memory((char*)buf, size);
     if (!*elf) {
@@ -56,15 +88,16 @@ liborkh_status_t liborkh_open_elf_from_memory(const uint8_t* buf, size_t size, E
         return LIBORKH_ERROR_ELF;
     }
 
+    LIBORKH_STATS_ADD(gpu_elfs_opened, 1, size);
+    LIBORKH_STATS_TIMER_STOP(gpu_elfs_opened, open_timer);
+    LIBORKH_TRACE_END(span, "liborkh_open_elf_from_memory", size, -1, NULL);
     return LIBORKH_SUCCESS;
 }
 
 liborkh_status_t liborkh_close_elf(Elf *elf) {
     LIBORKH_CHECK_ARGUMENTS(!elf);
 
-    int fd = elf_getbase(elf);
     elf_end(elf);
-    if (fd >= 0) close(fd);
     return LIBORKH_SUCCESS;
 }
 
@@ -75,57 +108,64 @@ liborkh_status_t liborkh_close_elf(Elf *elf) {
 liborkh_status_t liborkh_get_note_data(Elf *elf, elf_note_t* out) {
     LIBORKH_CHECK_ARGUMENTS(!elf || !out);
 
-    uint8_t *data = NULL;
+    const uint8_t *data = NULL;
     size_t size = 0;
 
-    // Extract the .note section
-    LIBORKH_CHECK_CALL(liborkh_extract_section_data(elf, ".note", &data, &size), "Failed to extract .note section\n");
+    // View of the .note section, only the name and descriptor are copied
+    LIBORKH_CHECK_CALL(liborkh_get_section_view(elf, ".note", &data, &size), "Failed to extract .note section\n");
 
     size_t pos = 0;
+    out->name = NULL;
+    out->desc = NULL;
 
     // Read the note header
-    if (size < sizeof(uint32_t) * 3) return -1; // namesz + descsz + type = 12 bytes
+    if (size < sizeof(uint32_t) * 3) { // namesz + descsz + type = 12 bytes
+        liborkh_log_err("Truncated note header\n");
+        return LIBORKH_ERROR_OUT_OF_BOUNDS;
+    }
     out->namesz = *(uint32_t*)(data + pos); pos += sizeof(uint32_t);
     out->descsz = *(uint32_t*)(data + pos); pos += sizeof(uint32_t);
     out->type   = *(uint32_t*)(data + pos); pos += sizeof(uint32_t);
 
-    // Ensure there is enough data for name and desc
-    LIBORKH_CHECK_CALL(check_bounds(pos, out->namesz + out->descsz, size), "Truncated note data\n");
-
-    // Allocate and copy the name
-    out->name = (char*)malloc(out->namesz + 1);
+    // Ensure there is enough data for the name, its padding and desc
+    size_t name_size = ((size_t) out->namesz + 3) & ~(size_t) 3; // Aligned to 4 bytes
+    LIBORKH_CHECK_CALL(check_bounds(pos, name_size + out->descsz, size), "Truncated note data\n");
+
+    // Copy the name and the descriptor, nothing is left allocated on failure
+    out->name = (char*)liborkh_malloc(LIBORKH_ALLOC_STAGE_NOTE, out->namesz + 1);
+    out->desc = (uint8_t*)liborkh_malloc(LIBORKH_ALLOC_STAGE_NOTE, out->descsz ? out->descsz : 1);
+    if (!out->name || !out->desc) {
+        liborkh_free(out->name);
+        liborkh_free(out->desc);
+        out->name = NULL;
+        out->desc = NULL;
+    }
     LIBORKH_CHECK_ALLOC(out->name);
 
     memcpy(out->name, data + pos, out->namesz);
     out->name[out->namesz] = '\0'; // Ensure null-terminated
-    pos += ((out->namesz + 3) & ~3); // Align to 4 bytes
+    pos += name_size;
 
-    // Allocate and copy the descriptor
-    out->desc = (uint8_t*)malloc(out->descsz);
-    LIBORKH_CHECK_ALLOC(out->desc);
-  
     memcpy(out->desc, data + pos, out->descsz);
-    pos += ((out->descsz + 3) & ~3); // Align to 4 bytes
-
-    // Success
     return LIBORKH_SUCCESS;
 }
 
-liborkh_status_t liborkh_extract_section_data(Elf *elf, const char* section_name, uint8_t** out_data, size_t* out_size) {
+/**
+ * Zero-copy view of a section, valid as long as the ELF is open. For repeated
+ * lookups on the same ELF, build a section table instead.
+ */
+liborkh_status_t liborkh_get_section_view(Elf *elf, const char* section_name, const uint8_t** out_data, size_t* out_size) {
     LIBORKH_CHECK_ARGUMENTS(!elf || !section_name || !out_data || !out_size);
 
     size_t shstrndx = 0;
     Elf_Scn *scn = NULL;
     GElf_Shdr shdr;
 
-    int found = 0;
-
     *out_data = NULL;
     *out_size = 0;
 
     if (elf_getshdrstrndx(elf, &shstrndx) != 0) {
         liborkh_log_err("elf_getshdrstrndx() failed: %s\n", elf_errmsg(-1));
-        elf_end(elf);
         return LIBORKH_ERROR_ELF;
     }
 
@@ -149,19 +189,149 @@ liborkh_status_t liborkh_extract_section_data(Elf *elf, const char* section_name
                 return LIBORKH_ERROR_ELF;
             } 
 
-            unsigned char *buf = malloc(data->d_size);
-            LIBORKH_CHECK_ALLOC(buf);
-        
-            memcpy(buf, data->d_buf, data->d_size);
-            *out_data = buf;
+            *out_data = (const uint8_t *) data->d_buf;
             *out_size = data->d_size;
-            found = 1;
-            break;
+            return LIBORKH_SUCCESS;
+        }
+    }
+
+    liborkh_log_err("Section %s not found\n", section_name);
+    return LIBORKH_ERROR_SECTION_NOT_FOUND;
+}
+
+liborkh_status_t liborkh_extract_section_data(Elf *elf, const char* section_name, uint8_t** out_data, size_t* out_size) {
+    LIBORKH_CHECK_ARGUMENTS(!elf || !section_name || !out_data || !out_size);
+
+    const uint8_t *view = NULL;
+    size_t size = 0;
+
+    *out_data = NULL;
+    *out_size = 0;
+    LIBORKH_CHECK_CALL(liborkh_get_section_view(elf, section_name, &view, &size), "Cannot read section %s\n", section_name);
+
+    unsigned char *buf = liborkh_malloc(LIBORKH_ALLOC_STAGE_SECTION, size + 1);
+    LIBORKH_CHECK_ALLOC(buf);
+
+    if (size) memcpy(buf, view, size);
+    *out_data = buf;
+    *out_size = size;
+    return LIBORKH_SUCCESS;
+}
+
+// FNV-1a, section names are short
+static uint32_t __name_hash(const char* name) {
+    uint32_t h = 2166136261u;
+    for (const unsigned char* p = (const unsigned char*) name; *p; p++) {
+        h ^= *p;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+/**
+ * Read the section headers of an ELF once. Lookups by name are then a hash
+ * probe instead of a walk over elf_nextscn() with elf_strptr() and strcmp().
+ */
+liborkh_status_t liborkh_elf_section_table_build(Elf *elf, liborkh_elf_section_table_t** table) {
+    LIBORKH_CHECK_ARGUMENTS(!elf || !table);
+
+    size_t shstrndx = 0, shnum = 0;
+    if (elf_getshdrstrndx(elf, &shstrndx) != 0 || elf_getshdrnum(elf, &shnum) != 0) {
+        liborkh_log_err("Cannot read section headers: %s\n", elf_errmsg(-1));
+        return LIBORKH_ERROR_ELF;
+    }
+
+    size_t num_buckets = 16;
+    while (num_buckets < shnum * 2) num_buckets <<= 1;
+
+    liborkh_elf_section_table_t* t = liborkh_calloc(LIBORKH_ALLOC_STAGE_SECTION, 1, sizeof(liborkh_elf_section_table_t));
+    LIBORKH_CHECK_ALLOC(t);
+    t->elf         = elf;
+    t->num_buckets = num_buckets;
+    t->sections    = liborkh_calloc(LIBORKH_ALLOC_STAGE_SECTION, shnum + 1, sizeof(liborkh_elf_section_t));
+    t->buckets     = liborkh_calloc(LIBORKH_ALLOC_STAGE_SECTION, num_buckets, sizeof(uint32_t));
+    if (!t->sections || !t->buckets) {
+        liborkh_elf_section_table_free(t);
+        return LIBORKH_ERROR_OUT_OF_MEMORY;
+    }
+
+    Elf_Scn *scn = NULL;
+    GElf_Shdr shdr;
+    while ((scn = elf_nextscn(elf, scn)) != NULL && t->count < shnum) {
+        const char *name = NULL;
+        if (gelf_getshdr(scn, &shdr) != &shdr || !(name = elf_strptr(elf, shstrndx, shdr.sh_name))) {
+            liborkh_log_err("Cannot read section header: %s\n", elf_errmsg(-1));
+            liborkh_elf_section_table_free(t);
+            return LIBORKH_ERROR_ELF;
+        }
+
+        liborkh_elf_section_t* section = &t->sections[t->count];
+        section->name   = name;
+        section->hash   = __name_hash(name);
+        section->type   = shdr.sh_type;
+        section->flags  = shdr.sh_flags;
+        section->addr   = shdr.sh_addr;
+        section->offset = shdr.sh_offset;
+        section->size   = shdr.sh_size;
+        section->index  = elf_ndxscn(scn);
+        section->scn    = scn;
+
+        // Keep the first section of a name, as the linear walk did
+        size_t slot = section->hash & (num_buckets - 1);
+        bool duplicate = false;
+        while (t->buckets[slot] && !duplicate) {
+            const liborkh_elf_section_t* other = &t->sections[t->buckets[slot] - 1];
+            duplicate = other->hash == section->hash && strcmp(other->name, name) == 0;
+            slot = (slot + 1) & (num_buckets - 1);
         }
+        if (!duplicate) t->buckets[slot] = (uint32_t) (t->count + 1);
+        t->count++;
     }
-    if (!found) {
-        liborkh_log_err("Section %s not found\n", section_name);
-        return LIBORKH_ERROR_SECTION_NOT_FOUND;
+
+    *table = t;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_elf_section_table_free(liborkh_elf_section_table_t* table) {
+    LIBORKH_CHECK_ARGUMENTS(!table);
+
+    liborkh_free(table->sections);
+    liborkh_free(table->buckets);
+    liborkh_free(table);
+    return LIBORKH_SUCCESS;
+}
+
+const liborkh_elf_section_t* liborkh_elf_section_table_find(const liborkh_elf_section_table_t* table, const char* name) {
+    if (!table || !name) return NULL;
+
+    uint32_t hash = __name_hash(name);
+    for (size_t slot = hash & (table->num_buckets - 1); table->buckets[slot]; slot = (slot + 1) & (table->num_buckets - 1)) {
+        const liborkh_elf_section_t* section = &table->sections[table->buckets[slot] - 1];
+        if (section->hash == hash && strcmp(section->name, name) == 0) return section;
     }
+    return NULL;
+}
+
+/**
+ * Zero-copy view of a section found through the table.
+ */
+liborkh_status_t liborkh_elf_section_table_get_data(const liborkh_elf_section_table_t* table, const char* name, const uint8_t** out_data, size_t* out_size) {
+    LIBORKH_CHECK_ARGUMENTS(!table || !name || !out_data || !out_size);
+
+    *out_data = NULL;
+    *out_size = 0;
+
+    const liborkh_elf_section_t* section = liborkh_elf_section_table_find(table, name);
+    if (!section) return LIBORKH_ERROR_SECTION_NOT_FOUND;
+    if (section->type == SHT_NOBITS) return LIBORKH_SUCCESS;
+
+    Elf_Data *data = elf_getdata(section->scn, NULL);
+    if (!data) {
+        liborkh_log_err("elf_getdata() failed: %s\n", elf_errmsg(-1));
+        return LIBORKH_ERROR_ELF;
+    }
+
+    *out_data = (const uint8_t *) data->d_buf;
+    *out_size = data->d_size;
     return LIBORKH_SUCCESS;
 }
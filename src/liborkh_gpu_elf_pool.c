@@ -4,16 +4,58 @@
 
 #include "liborkh_gpu_elf_pool.h"
 #include "liborkh_utils.h"
+#include "liborkh_stats.h"
+#include "liborkh_budget.h"
+
+// Reference counted image buffer, entries point to data. Accounted to the memory budget, may be spilled to disk
+typedef struct {
+    uint32_t refcount;
+    size_t size;
+    _Alignas(16) uint8_t data[];
+} __liborkh_shared_image_t;
+
+#define __liborkh_shared_image_of(elf) ((__liborkh_shared_image_t *) ((uint8_t *) (elf) - offsetof(__liborkh_shared_image_t, data)))
+
+static uint8_t *__liborkh_shared_image_alloc(size_t size)
+{
+    __liborkh_shared_image_t *image = liborkh_budget_alloc(LIBORKH_ALLOC_STAGE_IMAGE, sizeof(__liborkh_shared_image_t) + size);
+    if (!image) return NULL;
+
+    image->refcount = 1;
+    image->size = size;
+    return image->data;
+}
+
+static void __liborkh_shared_image_release(uint8_t *elf)
+{
+    __liborkh_shared_image_t *image = __liborkh_shared_image_of(elf);
+    if (__atomic_sub_fetch(&image->refcount, 1, __ATOMIC_ACQ_REL) == 0) {
+        liborkh_budget_free(image);
+    }
+}
+
+static void __liborkh_entry_release_image(liborkh_gpu_elf_entry_t *entry)
+{
+    if (entry->elf) {
+        if (entry->flags & LIBORKH_ENTRY_SHARED_ELF) {
+            __liborkh_shared_image_release(entry->elf);
+        } else if (!(entry->flags & LIBORKH_ENTRY_BORROWED_ELF)) {
+            liborkh_free(entry->elf);
+        }
+    }
+    entry->elf = NULL;
+    entry->flags &= ~(LIBORKH_ENTRY_SHARED_ELF | LIBORKH_ENTRY_BORROWED_ELF);
+}
 
 liborkh_status_t liborkh_gpu_elf_pool_init(liborkh_gpu_elf_pool_t **pool, size_t initial_capacity)
 {
     LIBORKH_CHECK_ARGUMENTS(!pool || initial_capacity == 0);
 
-    *pool = malloc(sizeof(liborkh_gpu_elf_pool_t));
+    *pool = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, sizeof(liborkh_gpu_elf_pool_t));
     LIBORKH_CHECK_ALLOC(*pool);
 
-    (*pool)->entries = calloc(initial_capacity, sizeof(liborkh_gpu_elf_pool_t*));
-    if (!(*pool)->entries) { free(*pool); }
+    (*pool)->entries = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, initial_capacity, sizeof(liborkh_gpu_elf_pool_t*));
+    if (!(*pool)->entries) { liborkh_free(*pool); }
     LIBORKH_CHECK_ALLOC((*pool)->entries);
 
     (*pool)->count = 0;
@@ -28,8 +70,8 @@ liborkh_status_t liborkh_gpu_elf_pool_free(liborkh_gpu_elf_pool_t *pool)
     for (size_t i = 0; i < pool->count; i++) {
         liborkh_free_entry(pool->entries[i]);
     }
-    free(pool->entries);
-    free(pool);
+    liborkh_free(pool->entries);
+    liborkh_free(pool);
     return LIBORKH_SUCCESS;
 }
 
@@ -37,7 +79,7 @@ liborkh_status_t liborkh_new_entry(liborkh_gpu_elf_entry_t **entry)
 {
     LIBORKH_CHECK_ARGUMENTS(!entry);
 
-    *entry = malloc(sizeof(liborkh_gpu_elf_entry_t));
+    *entry = liborkh_malloc(LIBORKH_ALLOC_STAGE_ENTRY, sizeof(liborkh_gpu_elf_entry_t));
     LIBORKH_CHECK_ALLOC(*entry);
 
     (*entry)->id = 0;
@@ -49,6 +91,13 @@ liborkh_status_t liborkh_new_entry(liborkh_gpu_elf_entry_t **entry)
     (*entry)->target_arch = NULL;
     (*entry)->elf_size = 0;
     (*entry)->elf = NULL;
+    (*entry)->flags = 0;
+    (*entry)->bundle_offset = 0;
+    (*entry)->image_offset = 0;
+    (*entry)->hash.lo = 0;
+    (*entry)->hash.hi = 0;
+    (*entry)->member_name = NULL;
+    (*entry)->member_offset = 0;
     return LIBORKH_SUCCESS;
 }
 
@@ -56,14 +105,226 @@ liborkh_status_t liborkh_free_entry(liborkh_gpu_elf_entry_t *entry)
 {
     LIBORKH_CHECK_ARGUMENTS(!entry);
 
-    if (entry->target_triple) free(entry->target_triple);
-    if (entry->target_arch)   free(entry->target_arch);
-    if (entry->elf)           free(entry->elf);
-    free(entry);
+    if (!(entry->flags & LIBORKH_ENTRY_BORROWED_STRINGS)) {
+        if (entry->target_triple) liborkh_free(entry->target_triple);
+        if (entry->target_arch)   liborkh_free(entry->target_arch);
+        if (entry->member_name)   liborkh_free(entry->member_name);
+    }
+    __liborkh_entry_release_image(entry);
+    liborkh_free(entry);
     return LIBORKH_SUCCESS;
 }
 
 
+static char *__liborkh_strdup_or_null(const char *str, bool *failed)
+{
+    if (!str) return NULL;
+    char *copy = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, str);
+    if (!copy) *failed = true;
+    return copy;
+}
+
+/**
+ * Replace borrowed strings (target triple, arch, member name) by copies owned by the entry.
+ */
+liborkh_status_t liborkh_entry_own_strings(liborkh_gpu_elf_entry_t *entry)
+{
+    LIBORKH_CHECK_ARGUMENTS(!entry);
+
+    if (!(entry->flags & LIBORKH_ENTRY_BORROWED_STRINGS)) return LIBORKH_SUCCESS;
+
+    bool failed = false;
+    char *target_triple = __liborkh_strdup_or_null(entry->target_triple, &failed);
+    char *target_arch   = __liborkh_strdup_or_null(entry->target_arch, &failed);
+    char *member_name   = __liborkh_strdup_or_null(entry->member_name, &failed);
+    if (failed) {
+        liborkh_free(target_triple);
+        liborkh_free(target_arch);
+        liborkh_free(member_name);
+    }
+    LIBORKH_CHECK_ALLOC(!failed);
+
+    entry->target_triple = target_triple;
+    entry->target_arch   = target_arch;
+    entry->member_name   = member_name;
+    entry->flags &= ~LIBORKH_ENTRY_BORROWED_STRINGS;
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Move the image of the entry to a reference counted buffer.
+ */
+static liborkh_status_t __liborkh_entry_copy_image(liborkh_gpu_elf_entry_t *entry)
+{
+    LIBORKH_STATS_TIMER_START(copy_timer);
+
+    uint8_t *elf = __liborkh_shared_image_alloc(entry->elf_size);
+    if (!elf) {
+        __liborkh_entry_release_image(entry);
+        entry->elf_size = 0;
+    }
+    LIBORKH_CHECK_ALLOC(elf);
+
+    memcpy(elf, entry->elf, entry->elf_size);
+    __liborkh_entry_release_image(entry);
+    entry->elf = elf;
+    entry->flags |= LIBORKH_ENTRY_SHARED_ELF;
+
+    LIBORKH_STATS_ADD(images_copied, 1, entry->elf_size);
+    LIBORKH_STATS_TIMER_STOP(images_copied, copy_timer);
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Replace a borrowed image by a reference counted copy owned by the entry.
+ * Images the entry already owns are kept as they are.
+ */
+liborkh_status_t liborkh_entry_own_image(liborkh_gpu_elf_entry_t *entry)
+{
+    LIBORKH_CHECK_ARGUMENTS(!entry);
+
+    if (!entry->elf || !(entry->flags & LIBORKH_ENTRY_BORROWED_ELF)) return LIBORKH_SUCCESS;
+    return __liborkh_entry_copy_image(entry);
+}
+
+
+/**
+ * Make dst use the image of src (same content), releasing its own image.
+ */
+liborkh_status_t liborkh_entry_share_image(liborkh_gpu_elf_entry_t *dst, liborkh_gpu_elf_entry_t *src)
+{
+    LIBORKH_CHECK_ARGUMENTS(!dst || !src || !src->elf);
+
+    // Only reference counted images can be shared, plain heap images are converted once
+    if (!(src->flags & LIBORKH_ENTRY_SHARED_ELF)) {
+        LIBORKH_CHECK_CALL(__liborkh_entry_copy_image(src), "Failed to own source image\n");
+    }
+    if (dst->elf == src->elf) return LIBORKH_SUCCESS;
+
+    __atomic_add_fetch(&__liborkh_shared_image_of(src->elf)->refcount, 1, __ATOMIC_RELAXED);
+    __liborkh_entry_release_image(dst);
+
+    dst->elf      = src->elf;
+    dst->elf_size = src->elf_size;
+    dst->flags   |= LIBORKH_ENTRY_SHARED_ELF;
+    return LIBORKH_SUCCESS;
+}
+
+
+liborkh_status_t liborkh_entry_compute_hash(liborkh_gpu_elf_entry_t *entry)
+{
+    LIBORKH_CHECK_ARGUMENTS(!entry || !entry->elf);
+
+    if (!(entry->flags & LIBORKH_ENTRY_HASHED)) {
+        entry->hash = liborkh_hash128(entry->elf, entry->elf_size, 0);
+        entry->flags |= LIBORKH_ENTRY_HASHED;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+
+typedef struct {
+    liborkh_gpu_elf_entry_t *entry;
+    size_t index;
+} __liborkh_dedupe_item_t;
+
+static int __liborkh_dedupe_compare(const void *a, const void *b)
+{
+    const __liborkh_dedupe_item_t *x = (const __liborkh_dedupe_item_t *) a;
+    const __liborkh_dedupe_item_t *y = (const __liborkh_dedupe_item_t *) b;
+
+    int cmp = liborkh_hash128_compare(x->entry->hash, y->entry->hash);
+    if (cmp != 0) return cmp;
+    if (x->entry->elf_size != y->entry->elf_size) return x->entry->elf_size < y->entry->elf_size ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+/**
+ * Hash every image of the pool and make byte-identical images share one buffer.
+ * The first entry (in pool order) of each group keeps the image, the others reference it.
+ * @param num_shared Number of entries now referencing another entry's image (can be NULL)
+ */
+liborkh_status_t liborkh_gpu_elf_pool_dedupe(liborkh_gpu_elf_pool_t *pool, size_t *num_shared)
+{
+    LIBORKH_CHECK_ARGUMENTS(!pool);
+
+    if (num_shared) *num_shared = 0;
+    if (pool->count < 2) return LIBORKH_SUCCESS;
+
+    __liborkh_dedupe_item_t *items = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, pool->count * sizeof(__liborkh_dedupe_item_t));
+    LIBORKH_CHECK_ALLOC(items);
+
+    size_t num_items = 0;
+    for (size_t i = 0; i < pool->count; i++) {
+        liborkh_gpu_elf_entry_t *entry = pool->entries[i];
+        if (!entry->elf || entry->elf_size == 0) continue;
+
+        liborkh_entry_compute_hash(entry);
+        items[num_items].entry = entry;
+        items[num_items].index = i;
+        num_items++;
+    }
+
+    qsort(items, num_items, sizeof(__liborkh_dedupe_item_t), __liborkh_dedupe_compare);
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    size_t shared = 0;
+    for (size_t first = 0; first < num_items && status == LIBORKH_SUCCESS; ) {
+        liborkh_gpu_elf_entry_t *canonical = items[first].entry;
+
+        size_t next = first + 1;
+        for (; next < num_items; next++) {
+            liborkh_gpu_elf_entry_t *entry = items[next].entry;
+            if (!liborkh_hash128_equal(entry->hash, canonical->hash) || entry->elf_size != canonical->elf_size) break;
+
+            // Equal hashes are only a hint, confirm before sharing
+            if (entry->elf != canonical->elf && memcmp(entry->elf, canonical->elf, entry->elf_size) != 0) {
+                liborkh_log_warn("Hash collision between entries %zu and %zu\n", items[first].index, items[next].index);
+                continue;
+            }
+
+            status = liborkh_entry_share_image(entry, canonical);
+            if (status != LIBORKH_SUCCESS) break;
+            shared++;
+        }
+        first = next;
+    }
+
+    liborkh_free(items);
+
+    if (num_shared) *num_shared = shared;
+    return status;
+}
+
+
+/**
+ * Hand a freshly decoded entry to a visitor and apply its decision.
+ */
+liborkh_status_t __liborkh_visit_entry(liborkh_gpu_elf_entry_t *entry, liborkh_gpu_elf_visit_cb_t func, void *user_data, liborkh_visit_action_t *action)
+{
+    LIBORKH_CHECK_ARGUMENTS(!entry || !func || !action);
+
+    *action = func(entry, user_data);
+    if (*action == LIBORKH_VISIT_TAKE) {
+        return liborkh_entry_own_image(entry);
+    }
+    return liborkh_free_entry(entry);
+}
+
+
+liborkh_visit_action_t __liborkh_pool_push_visitor(liborkh_gpu_elf_entry_t *entry, void *user_data)
+{
+    __liborkh_pool_push_ctx_t *ctx = (__liborkh_pool_push_ctx_t *) user_data;
+
+    ctx->status = liborkh_gpu_elf_pool_push(ctx->pool, entry);
+    if (ctx->status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to add entry to pool\n");
+        return LIBORKH_VISIT_STOP;
+    }
+    return LIBORKH_VISIT_TAKE;
+}
+
+
 liborkh_status_t liborkh_gpu_elf_pool_pop(liborkh_gpu_elf_pool_t *pool, liborkh_gpu_elf_entry_t **entry)
 {
     LIBORKH_CHECK_ARGUMENTS(!pool);
@@ -88,7 +349,7 @@ liborkh_status_t liborkh_gpu_elf_pool_push(liborkh_gpu_elf_pool_t *pool, liborkh
 
     if (pool->count >= pool->capacity) {
         size_t new_capacity = pool->capacity * 2;
-        liborkh_gpu_elf_entry_t **tmp = (liborkh_gpu_elf_entry_t**) realloc(pool->entries, new_capacity * sizeof(liborkh_gpu_elf_entry_t*));
+        liborkh_gpu_elf_entry_t **tmp = (liborkh_gpu_elf_entry_t**) liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, pool->entries, new_capacity * sizeof(liborkh_gpu_elf_entry_t*));
         LIBORKH_CHECK_ALLOC(tmp);
         
         pool->entries = tmp;
@@ -108,3 +369,165 @@ liborkh_status_t liborkh_gpu_elf_pool_iterate(liborkh_gpu_elf_pool_t *pool, libo
     }
     return LIBORKH_SUCCESS;
 }
+
+
+// Segment and offset of a slot: segment k starts at slot (2^k - 1) * first_segment_size
+static size_t __liborkh_concurrent_pool_locate(const liborkh_gpu_elf_concurrent_pool_t *pool, size_t index, size_t *offset)
+{
+    size_t shift = (size_t) __builtin_ctzll(pool->first_segment_size);
+    size_t segment = 63 - (size_t) __builtin_clzll((index >> shift) + 1);
+    *offset = index - ((((size_t) 1 << segment) - 1) << shift);
+    return segment;
+}
+
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_init(liborkh_gpu_elf_concurrent_pool_t **pool, size_t initial_capacity)
+{
+    LIBORKH_CHECK_ARGUMENTS(!pool || initial_capacity == 0);
+
+    *pool = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_gpu_elf_concurrent_pool_t));
+    LIBORKH_CHECK_ALLOC(*pool);
+
+    size_t first_segment_size = 1;
+    while (first_segment_size < initial_capacity) first_segment_size <<= 1;
+    (*pool)->first_segment_size = first_segment_size;
+    return LIBORKH_SUCCESS;
+}
+
+static void __liborkh_concurrent_pool_release(liborkh_gpu_elf_concurrent_pool_t *pool, bool free_entries)
+{
+    for (size_t k = 0; k < LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS; k++) {
+        liborkh_concurrent_pool_slot_t *segment = pool->segments[k];
+        if (!segment) continue;
+
+        for (size_t i = 0; free_entries && i < (pool->first_segment_size << k); i++) {
+            if (segment[i].entry) liborkh_free_entry(segment[i].entry);
+        }
+        liborkh_free(segment);
+        pool->segments[k] = NULL;
+    }
+    pool->next = 0;
+}
+
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_free(liborkh_gpu_elf_concurrent_pool_t *pool)
+{
+    LIBORKH_CHECK_ARGUMENTS(!pool);
+
+    __liborkh_concurrent_pool_release(pool, true);
+    liborkh_free(pool);
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Append an entry, safe to call from several threads. On failure the entry is
+ * still owned by the caller.
+ * @param key Order key of the entry, see liborkh_gpu_elf_concurrent_pool_finalize()
+ */
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_push(liborkh_gpu_elf_concurrent_pool_t *pool, uint64_t key, liborkh_gpu_elf_entry_t *entry)
+{
+    LIBORKH_CHECK_ARGUMENTS(!pool);
+
+    if (!entry) return LIBORKH_SUCCESS;
+
+    size_t index = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED);
+    size_t offset;
+    size_t k = __liborkh_concurrent_pool_locate(pool, index, &offset);
+    if (k >= LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    liborkh_concurrent_pool_slot_t *segment = __atomic_load_n(&pool->segments[k], __ATOMIC_ACQUIRE);
+    if (!segment) {
+        // Racing producers may both allocate the segment, only one gets installed
+        liborkh_concurrent_pool_slot_t *fresh = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, pool->first_segment_size << k, sizeof(liborkh_concurrent_pool_slot_t));
+        LIBORKH_CHECK_ALLOC(fresh);
+
+        liborkh_concurrent_pool_slot_t *expected = NULL;
+        if (__atomic_compare_exchange_n(&pool->segments[k], &expected, fresh, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+            segment = fresh;
+        } else {
+            liborkh_free(fresh);
+            segment = expected;
+        }
+    }
+
+    segment[offset].key = key;
+    __atomic_store_n(&segment[offset].entry, entry, __ATOMIC_RELEASE);
+    return LIBORKH_SUCCESS;
+}
+
+size_t liborkh_gpu_elf_concurrent_pool_count(const liborkh_gpu_elf_concurrent_pool_t *pool)
+{
+    return pool ? __atomic_load_n(&pool->next, __ATOMIC_RELAXED) : 0;
+}
+
+liborkh_gpu_elf_entry_t *liborkh_gpu_elf_concurrent_pool_get(const liborkh_gpu_elf_concurrent_pool_t *pool, size_t index)
+{
+    if (!pool) return NULL;
+
+    size_t offset;
+    size_t k = __liborkh_concurrent_pool_locate(pool, index, &offset);
+    if (k >= LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS) return NULL;
+
+    liborkh_concurrent_pool_slot_t *segment = __atomic_load_n(&pool->segments[k], __ATOMIC_ACQUIRE);
+    return segment ? __atomic_load_n(&segment[offset].entry, __ATOMIC_ACQUIRE) : NULL;
+}
+
+
+typedef struct {
+    uint64_t key;
+    size_t index;
+    liborkh_gpu_elf_entry_t *entry;
+} __liborkh_finalize_item_t;
+
+static int __liborkh_finalize_compare(const void *a, const void *b)
+{
+    const __liborkh_finalize_item_t *x = (const __liborkh_finalize_item_t *) a;
+    const __liborkh_finalize_item_t *y = (const __liborkh_finalize_item_t *) b;
+
+    if (x->key != y->key) return x->key < y->key ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+liborkh_status_t liborkh_gpu_elf_concurrent_pool_finalize(liborkh_gpu_elf_concurrent_pool_t *cpool, liborkh_gpu_elf_pool_t *pool)
+{
+    LIBORKH_CHECK_ARGUMENTS(!cpool || !pool);
+
+    size_t num_slots = cpool->next;
+    if (num_slots == 0) return LIBORKH_SUCCESS;
+
+    __liborkh_finalize_item_t *items = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, num_slots * sizeof(__liborkh_finalize_item_t));
+    LIBORKH_CHECK_ALLOC(items);
+
+    // Slots whose push failed are left empty
+    size_t num_items = 0;
+    for (size_t i = 0; i < num_slots; i++) {
+        size_t offset;
+        size_t k = __liborkh_concurrent_pool_locate(cpool, i, &offset);
+        if (k >= LIBORKH_CONCURRENT_POOL_MAX_SEGMENTS) break;
+        if (!cpool->segments[k] || !cpool->segments[k][offset].entry) continue;
+
+        items[num_items].key   = cpool->segments[k][offset].key;
+        items[num_items].index = i;
+        items[num_items].entry = cpool->segments[k][offset].entry;
+        num_items++;
+    }
+
+    qsort(items, num_items, sizeof(__liborkh_finalize_item_t), __liborkh_finalize_compare);
+
+    if (pool->count + num_items > pool->capacity) {
+        size_t new_capacity = pool->capacity * 2;
+        if (new_capacity < pool->count + num_items) new_capacity = pool->count + num_items;
+        liborkh_gpu_elf_entry_t **tmp = (liborkh_gpu_elf_entry_t**) liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, pool->entries, new_capacity * sizeof(liborkh_gpu_elf_entry_t*));
+        if (!tmp) liborkh_free(items);
+        LIBORKH_CHECK_ALLOC(tmp);
+
+        pool->entries = tmp;
+        pool->capacity = new_capacity;
+    }
+
+    for (size_t i = 0; i < num_items; i++) {
+        pool->entries[pool->count++] = items[i].entry;
+    }
+    liborkh_free(items);
+
+    __liborkh_concurrent_pool_release(cpool, false);
+    return LIBORKH_SUCCESS;
+}
@@ -0,0 +1,103 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "liborkh_hash.h"
+
+#define HASH_LANES            8
+#define HASH_STRIPE_SIZE      (HASH_LANES * sizeof(uint64_t))
+#define HASH_STRIPES_PER_MIX  16
+
+#define HASH_PRIME32_1 0x9E3779B1U
+#define HASH_PRIME64_1 0x9E3779B185EBCA87ULL
+#define HASH_PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define HASH_PRIME64_3 0x165667B19E3779F9ULL
+#define HASH_PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define HASH_PRIME64_5 0x27D4EB2F165667C5ULL
+
+static const uint64_t __hash_keys[HASH_LANES + HASH_STRIPES_PER_MIX] = {
+    0xbe4ba423396cfeb8ULL, 0x1cad21f72c81017cULL, 0xdb979083e96dd4deULL, 0x1f67b3b7a4a44072ULL,
+    0x78e5c0cc4ee679cbULL, 0x2172ffcc7dd05a82ULL, 0x8e2443f7744608b8ULL, 0x4c263a81e69035e0ULL,
+    0xcb00c391bb52283cULL, 0xa32e531b8b65d088ULL, 0x4ef90da297486471ULL, 0xd8acdea946ef1938ULL,
+    0x3f349ce33f76faa8ULL, 0x1d4f0bc7c7bbdcf9ULL, 0x3159b4cd4be0518aULL, 0x647378d9c97e9fc8ULL,
+    0xc3ebd33483acc5eaULL, 0xeb6313faffa081c5ULL, 0x49daf0b751dd0d17ULL, 0x9e68d429265516d3ULL,
+    0xfca1477d58be162bULL, 0xce31d07ad1b8f88fULL, 0x280416958f3acb45ULL, 0x7e404bbbcafbd7afULL,
+};
+
+static inline uint64_t __read_u64(const uint8_t* p) {
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return v;
+}
+
+static inline uint64_t __avalanche(uint64_t h) {
+    h ^= h >> 37;
+    h *= HASH_PRIME64_3;
+    h ^= h >> 32;
+    return h;
+}
+
+static inline uint64_t __mul128_fold64(uint64_t a, uint64_t b) {
+    __uint128_t product = (__uint128_t) a * b;
+    return (uint64_t) product ^ (uint64_t) (product >> 64);
+}
+
+// Plain loop over the lanes so that the compiler emits SIMD multiply-adds
+static inline void __accumulate_stripe(uint64_t* restrict acc, const uint8_t* restrict stripe, const uint64_t* restrict keys) {
+    for (size_t i = 0; i < HASH_LANES; i++) {
+        uint64_t value = __read_u64(stripe + i * sizeof(uint64_t));
+        uint64_t mixed = value ^ keys[i];
+        acc[i ^ 1] += value;
+        acc[i] += (mixed & 0xFFFFFFFFULL) * (mixed >> 32);
+    }
+}
+
+static inline void __scramble(uint64_t* acc) {
+    for (size_t i = 0; i < HASH_LANES; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= __hash_keys[i];
+        acc[i] = a * HASH_PRIME32_1;
+    }
+}
+
+static uint64_t __merge(const uint64_t* acc, uint64_t start, size_t key_offset) {
+    uint64_t h = start;
+    for (size_t i = 0; i < HASH_LANES; i += 2) {
+        h += __mul128_fold64(acc[i] ^ __hash_keys[key_offset + i], acc[i + 1] ^ __hash_keys[key_offset + i + 1]);
+    }
+    return __avalanche(h);
+}
+
+liborkh_hash128_t liborkh_hash128(const void* data, size_t size, uint64_t seed) {
+    const uint8_t* p = (const uint8_t*) data;
+
+    uint64_t acc[HASH_LANES] = {
+        HASH_PRIME32_1 ^ seed, HASH_PRIME64_1, HASH_PRIME64_2, HASH_PRIME64_3,
+        HASH_PRIME64_4,        HASH_PRIME32_1, HASH_PRIME64_5, HASH_PRIME32_1 + seed,
+    };
+
+    size_t num_stripes = size / HASH_STRIPE_SIZE;
+    for (size_t s = 0; s < num_stripes; s++) {
+        __accumulate_stripe(acc, p + s * HASH_STRIPE_SIZE, __hash_keys + (s % HASH_STRIPES_PER_MIX));
+        if (s % HASH_STRIPES_PER_MIX == HASH_STRIPES_PER_MIX - 1) {
+            __scramble(acc);
+        }
+    }
+
+    // Last partial stripe, zero padded
+    size_t tail = size - num_stripes * HASH_STRIPE_SIZE;
+    if (tail > 0) {
+        uint8_t last[HASH_STRIPE_SIZE] = {0};
+        memcpy(last, p + num_stripes * HASH_STRIPE_SIZE, tail);
+        __accumulate_stripe(acc, last, __hash_keys + HASH_STRIPES_PER_MIX);
+    }
+
+    liborkh_hash128_t hash;
+    hash.lo = __merge(acc, (uint64_t) size * HASH_PRIME64_1, 3);
+    hash.hi = __merge(acc, ~((uint64_t) size * HASH_PRIME64_2) ^ seed, 11);
+    return hash;
+}
+
+void liborkh_hash128_to_string(liborkh_hash128_t hash, char out[LIBORKH_HASH128_STRING_SIZE]) {
+    snprintf(out, LIBORKH_HASH128_STRING_SIZE, "%016llx%016llx", (unsigned long long) hash.hi, (unsigned long long) hash.lo);
+}
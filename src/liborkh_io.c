@@ -1,10 +1,28 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <unistd.h>
+#include <errno.h>
+#include <fcntl.h>
 
 #include "liborkh.h"
 #include "liborkh_utils.h"
 
+/**
+ * Create the temporary file of an atomic write (renamed over its destination
+ * once complete). It is never opened through a symlink nor reused: a leftover
+ * from a previous writer with the same pid is unlinked (removing a symlink, not
+ * its target) and creation is retried once.
+ */
+int __liborkh_open_temp_file(const char* tmp_filename, mode_t mode) {
+    for (int attempt = 0; attempt < 2; attempt++) {
+        int fd = open(tmp_filename, O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC, mode);
+        if (fd >= 0 || errno != EEXIST) return fd;
+        if (unlink(tmp_filename) != 0) return -1;
+    }
+    return -1;
+}
+
 liborkh_status_t liborkh_write_fatbin_to_file(const liborkh_offload_buffer* buf, const char* filename) {
     LIBORKH_CHECK_ARGUMENTS(!buf || !filename);
 
@@ -21,17 +39,26 @@ liborkh_status_t liborkh_write_fatbin_to_file(const liborkh_offload_buffer* buf,
 char* liborkh_get_elf_name(const liborkh_gpu_elf_entry_t* entry, const char* prefix) {
     prefix = prefix ? prefix : "gpu_elf";
 
-    // Create filename: <prefix>:<id>.<image>.<offload_kind>.<triple>.<arch>
+    // Create filename: <prefix>[(<member>)]:<id>.<image>.<offload_kind>.<triple>.<arch>
     char buffer[1024];
-    snprintf(buffer, sizeof(buffer), "%s:%ld.%s.%s.%s.%s",
-             prefix,
+    int prefix_len = snprintf(buffer, sizeof(buffer), "%s", prefix);
+    if (prefix_len < 0 || (size_t) prefix_len >= sizeof(buffer)) prefix_len = 0;
+    snprintf(buffer + prefix_len, sizeof(buffer) - prefix_len, "%s%s%s:%ld.%s.%s.%s.%s",
+             entry->member_name ? "(" : "",
+             entry->member_name ? entry->member_name : "",
+             entry->member_name ? ")" : "",
              entry->id,
              liborkh_image_kind_to_string(entry->img),
              liborkh_offload_kind_to_string(entry->ofk),
              entry->target_triple ? entry->target_triple : "unknown",
              entry->target_arch ? entry->target_arch : "unknown");
 
-    char* filename = strdup(buffer);
+    // Members can be paths (images of a process) and ids come from the input, stay in the prefix directory
+    for (char* c = buffer + prefix_len; *c; c++) {
+        if (*c == '/') *c = '_';
+    }
+
+    char* filename = liborkh_strdup(LIBORKH_ALLOC_STAGE_IO, buffer);
     if (!filename) {
         liborkh_log_err("Failed to allocate memory for filename\n");
         return NULL;
@@ -51,7 +78,7 @@ liborkh_status_t liborkh_write_elf_to_file(const liborkh_gpu_elf_entry_t* entry,
 
     if (!entry->elf || entry->elf_size == 0) {
         liborkh_log_warn("Cannot write elf in %s. Entry doesn't contain any elf data.\n", filename);
-        free(filename);
+        liborkh_free(filename);
         return LIBORKH_SUCCESS;
     }
 
@@ -62,6 +89,97 @@ liborkh_status_t liborkh_write_elf_to_file(const liborkh_gpu_elf_entry_t* entry,
 
     liborkh_log_info("Wrote ELF to file: %s (%zu bytes)\n", filename, entry->elf_size);
 
-    free(filename);
+    liborkh_free(filename);
     return 0;
-}
\ No newline at end of file
+}
+
+
+typedef struct {
+    const uint8_t* elf;
+    char* filename;
+} __liborkh_written_image_t;
+
+static __liborkh_written_image_t* __find_written_image(__liborkh_written_image_t* table, size_t capacity, const uint8_t* elf) {
+    size_t i = ((uintptr_t) elf >> 4) % capacity;
+    while (table[i].elf && table[i].elf != elf) {
+        i = (i + 1) % capacity;
+    }
+    return &table[i];
+}
+
+/**
+ * Write every entry of the pool to its own file. Entries sharing the same image
+ * buffer (see liborkh_gpu_elf_pool_dedupe) are hard linked to the first file
+ * written for that image instead of being written again.
+ * @param num_linked Number of files created as hard links (can be NULL)
+ */
+liborkh_status_t liborkh_write_pool_to_files(const liborkh_gpu_elf_pool_t* pool, const char* prefix, size_t* num_linked) {
+    LIBORKH_CHECK_ARGUMENTS(!pool);
+
+    if (num_linked) *num_linked = 0;
+
+    size_t capacity = pool->count * 2 + 1;
+    __liborkh_written_image_t* written = liborkh_calloc(LIBORKH_ALLOC_STAGE_IO, capacity, sizeof(__liborkh_written_image_t));
+    LIBORKH_CHECK_ALLOC(written);
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    size_t linked = 0;
+    for (size_t i = 0; i < pool->count && status == LIBORKH_SUCCESS; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+
+        __liborkh_written_image_t* slot = NULL;
+        if (entry->elf && (entry->flags & LIBORKH_ENTRY_SHARED_ELF)) {
+            slot = __find_written_image(written, capacity, entry->elf);
+        }
+
+        if (slot && slot->elf) {
+            char* filename = liborkh_get_elf_name(entry, prefix);
+            if (!filename) {
+                status = LIBORKH_ERROR_OUT_OF_MEMORY;
+                break;
+            }
+
+            // Same name as the file of the image (e.g. same bundle id and target): already written
+            if (strcmp(filename, slot->filename) == 0) {
+                liborkh_free(filename);
+                continue;
+            }
+
+            if (unlink(filename) != 0 && errno != ENOENT) {
+                liborkh_log_warn("Cannot replace %s\n", filename);
+            }
+            if (link(slot->filename, filename) == 0) {
+                liborkh_log_info("Linked ELF to file: %s -> %s (%zu bytes)\n", filename, slot->filename, entry->elf_size);
+                linked++;
+                liborkh_free(filename);
+                continue;
+            }
+
+            // Hard links not supported here (other file system...), write a copy
+            if (errno != EXDEV && errno != EPERM && errno != EMLINK && errno != EOPNOTSUPP) {
+                liborkh_log_err("Cannot link %s to %s: %s\n", filename, slot->filename, strerror(errno));
+                liborkh_free(filename);
+                status = LIBORKH_ERROR_WRITE_FILE;
+                break;
+            }
+            liborkh_log_warn("Cannot link %s to %s, writing a copy\n", filename, slot->filename);
+            liborkh_free(filename);
+            status = liborkh_write_elf_to_file(entry, prefix);
+            continue;
+        }
+
+        status = liborkh_write_elf_to_file(entry, prefix);
+        if (status == LIBORKH_SUCCESS && slot) {
+            slot->filename = liborkh_get_elf_name(entry, prefix);
+            slot->elf = slot->filename ? entry->elf : NULL;
+        }
+    }
+
+    for (size_t i = 0; i < capacity; i++) {
+        liborkh_free(written[i].filename);
+    }
+    liborkh_free(written);
+
+    if (num_linked) *num_linked = linked;
+    return status;
+}
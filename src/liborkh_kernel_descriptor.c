@@ -0,0 +1,241 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_kernel_descriptor.h"
+
+#define LIBORKH_KD_RSRC1_VGPR_SHIFT       0
+#define LIBORKH_KD_RSRC1_VGPR_MASK        0x3f
+#define LIBORKH_KD_RSRC1_SGPR_SHIFT       6
+#define LIBORKH_KD_RSRC1_SGPR_MASK        0xf
+#define LIBORKH_KD_RSRC2_PRIVATE_SEGMENT  0x1
+#define LIBORKH_KD_RSRC2_USER_SGPR_SHIFT  1
+#define LIBORKH_KD_RSRC2_USER_SGPR_MASK   0x1f
+#define LIBORKH_KD_RSRC2_WORKGROUP_SHIFT  7
+#define LIBORKH_KD_RSRC2_WORKITEM_SHIFT   11
+#define LIBORKH_KD_RSRC3_ACCUM_MASK       0x3f
+#define LIBORKH_KD_PROPERTY_WAVE32        0x400
+#define LIBORKH_KD_PROPERTY_DYNAMIC_STACK 0x800
+
+liborkh_status_t liborkh_kernel_descriptors_init(liborkh_kernel_descriptors_t** descriptors) {
+    LIBORKH_CHECK_ARGUMENTS(!descriptors);
+
+    *descriptors = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_kernel_descriptors_t));
+    LIBORKH_CHECK_ALLOC(*descriptors);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_kernel_descriptors_free(liborkh_kernel_descriptors_t* descriptors) {
+    LIBORKH_CHECK_ARGUMENTS(!descriptors);
+
+    liborkh_free(descriptors->kernels);
+    liborkh_free(descriptors->names);
+    liborkh_free(descriptors);
+    return LIBORKH_SUCCESS;
+}
+
+// Register file layout of a processor, from its name
+typedef struct {
+    unsigned major;
+    bool unified_vgprs;      // gfx90a, gfx94x, gfx95x: AGPRs follow the VGPRs
+} __liborkh_processor_t;
+
+// Decimal number of at most `len` digits, false if any character is not a digit
+static bool __parse_number(const char* str, size_t len, unsigned* out) {
+    *out = 0;
+    for (size_t i = 0; i < len; i++) {
+        if (str[i] < '0' || str[i] > '9') return false;
+        *out = *out * 10 + (unsigned) (str[i] - '0');
+    }
+    return len > 0;
+}
+
+/**
+ * Processors are gfx<major><minor><stepping> (gfx906, gfx90a, gfx1100), the
+ * last two being one hex digit each, or generic targets gfx<major>[-<minor>]-generic
+ * (gfx9-generic, gfx9-4-generic, gfx10-3-generic, gfx11-generic).
+ */
+static liborkh_status_t __parse_processor(const char* processor, __liborkh_processor_t* out) {
+    memset(out, 0, sizeof(*out));
+    if (!processor || strncmp(processor, "gfx", 3) != 0) return LIBORKH_ERROR_INVALID_ARGUMENT;
+
+    const char* version = processor + 3;
+    size_t len = strcspn(version, ":");
+    size_t digits = strspn(version, "0123456789");
+
+    if (digits < len && version[digits] == '-') {
+        static const char generic[] = "-generic";
+        size_t suffix = sizeof(generic) - 1;
+        if (len < digits + suffix || strncmp(version + len - suffix, generic, suffix) != 0) return LIBORKH_ERROR_INVALID_ARGUMENT;
+        if (!__parse_number(version, digits, &out->major)) return LIBORKH_ERROR_INVALID_ARGUMENT;
+
+        // gfx9-4-generic covers gfx942 and gfx950
+        const char* minor = version + digits + 1;
+        out->unified_vgprs = out->major == 9 && minor < version + len - suffix && minor[0] == '4';
+        return LIBORKH_SUCCESS;
+    }
+
+    if (len < 3 || !__parse_number(version, len - 2, &out->major)) return LIBORKH_ERROR_INVALID_ARGUMENT;
+    const char* minor = version + len - 2;
+    out->unified_vgprs = out->major == 9 && (strncmp(minor, "0a", 2) == 0 || minor[0] == '4' || minor[0] == '5');
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Register counts follow the encoding granules of the AMDHSA code object
+ * documentation: VGPR blocks of 8 on gfx90a/gfx94x/gfx95x and with wave32 on
+ * gfx10+, 4 otherwise, SGPR blocks of 8 up to gfx8 and 16 on gfx9. The larger
+ * allocation granule of 1.5x VGPR targets (gfx1100, gfx1101, gfx1151) does not
+ * change the encoding. Generic targets use the rules of their family.
+ */
+liborkh_status_t liborkh_kernel_descriptor_decode(const uint8_t* raw, const char* processor, liborkh_kernel_descriptor_t* out) {
+    LIBORKH_CHECK_ARGUMENTS(!raw || !out);
+
+    size_t pos = LIBORKH_KD_GROUP_SEGMENT_FIXED_SIZE;
+    out->group_segment_fixed_size   = read_u32(raw, &pos);
+    out->private_segment_fixed_size = read_u32(raw, &pos);
+    out->kernarg_size               = read_u32(raw, &pos);
+    pos = LIBORKH_KD_KERNEL_CODE_ENTRY_BYTE_OFFSET;
+    out->kernel_code_entry_byte_offset = (int64_t) read_u64(raw, &pos);
+    pos = LIBORKH_KD_COMPUTE_PGM_RSRC3;
+    out->compute_pgm_rsrc3 = read_u32(raw, &pos);
+    out->compute_pgm_rsrc1 = read_u32(raw, &pos);
+    out->compute_pgm_rsrc2 = read_u32(raw, &pos);
+    out->kernel_code_properties = read_u16(raw, &pos);
+    out->kernarg_preload        = read_u16(raw, &pos);
+
+    uint32_t rsrc1 = out->compute_pgm_rsrc1;
+    uint32_t rsrc2 = out->compute_pgm_rsrc2;
+    out->private_segment  = (rsrc2 & LIBORKH_KD_RSRC2_PRIVATE_SEGMENT) != 0;
+    out->user_sgpr_count  = (rsrc2 >> LIBORKH_KD_RSRC2_USER_SGPR_SHIFT) & LIBORKH_KD_RSRC2_USER_SGPR_MASK;
+    out->workgroup_ids    = (uint8_t) ((rsrc2 >> LIBORKH_KD_RSRC2_WORKGROUP_SHIFT) & 0x7);
+    out->workitem_id_dims = (uint8_t) (((rsrc2 >> LIBORKH_KD_RSRC2_WORKITEM_SHIFT) & 0x3) + 1);
+    out->dynamic_stack    = (out->kernel_code_properties & LIBORKH_KD_PROPERTY_DYNAMIC_STACK) != 0;
+
+    __liborkh_processor_t proc;
+    if (__parse_processor(processor, &proc) != LIBORKH_SUCCESS) {
+        // Raw fields only, register counts depend on the processor
+        out->wavefront_size = 64;
+        out->vgpr_count = out->sgpr_count = out->accum_offset = 0;
+        return LIBORKH_SUCCESS;
+    }
+
+    bool wave32 = proc.major >= 10 && (out->kernel_code_properties & LIBORKH_KD_PROPERTY_WAVE32);
+    out->wavefront_size = wave32 ? 32 : 64;
+
+    uint32_t vgpr_granule = 4;
+    if (proc.unified_vgprs) vgpr_granule = 8;
+    else if (wave32) vgpr_granule = 8;
+    out->vgpr_count = (((rsrc1 >> LIBORKH_KD_RSRC1_VGPR_SHIFT) & LIBORKH_KD_RSRC1_VGPR_MASK) + 1) * vgpr_granule;
+
+    uint32_t sgpr_blocks = (rsrc1 >> LIBORKH_KD_RSRC1_SGPR_SHIFT) & LIBORKH_KD_RSRC1_SGPR_MASK;
+    if (proc.major >= 10)     out->sgpr_count = 0;
+    else if (proc.major == 9) out->sgpr_count = (sgpr_blocks / 2 + 1) * 16;
+    else                      out->sgpr_count = (sgpr_blocks + 1) * 8;
+
+    out->accum_offset = proc.unified_vgprs ? ((out->compute_pgm_rsrc3 & LIBORKH_KD_RSRC3_ACCUM_MASK) + 1) * 4 : 0;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __add_name(liborkh_kernel_descriptors_t* descriptors, const char* name, size_t len, uint32_t* offset) {
+    size_t needed = descriptors->names_size + len + 1;
+    if (needed > UINT32_MAX) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    if (needed > descriptors->names_capacity) {
+        size_t capacity = descriptors->names_capacity ? descriptors->names_capacity : 4096;
+        while (capacity < needed) capacity *= 2;
+        char* names = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, descriptors->names, capacity);
+        LIBORKH_CHECK_ALLOC(names);
+        descriptors->names = names;
+        descriptors->names_capacity = capacity;
+    }
+
+    *offset = (uint32_t) descriptors->names_size;
+    memcpy(descriptors->names + descriptors->names_size, name, len);
+    descriptors->names[descriptors->names_size + len] = '\0';
+    descriptors->names_size = needed;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __reserve(liborkh_kernel_descriptors_t* descriptors, size_t count) {
+    if (descriptors->count + count <= descriptors->capacity) return LIBORKH_SUCCESS;
+
+    size_t capacity = descriptors->capacity ? descriptors->capacity : 64;
+    while (capacity < descriptors->count + count) capacity *= 2;
+    liborkh_kernel_descriptor_t* kernels = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, descriptors->kernels, capacity * sizeof(liborkh_kernel_descriptor_t));
+    LIBORKH_CHECK_ALLOC(kernels);
+    descriptors->kernels = kernels;
+    descriptors->capacity = capacity;
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Descriptors are read straight from the image: the symbol table is walked
+ * once and each .kd object is decoded from its section, found by index in
+ * the section table.
+ */
+static liborkh_status_t __add_symbols(liborkh_kernel_descriptors_t* descriptors, const liborkh_gpu_elf_entry_t* entry, const liborkh_elf_section_table_t* sections, const liborkh_elf_section_t* symtab) {
+    GElf_Shdr symtab_shdr;
+    Elf_Data* data = elf_getdata(symtab->scn, NULL);
+    if (!data || gelf_getshdr(symtab->scn, &symtab_shdr) != &symtab_shdr || symtab_shdr.sh_entsize == 0) return LIBORKH_ERROR_ELF;
+
+    size_t num_symbols = symtab_shdr.sh_size / symtab_shdr.sh_entsize;
+    LIBORKH_CHECK_CALL(__reserve(descriptors, num_symbols), "Cannot grow kernel descriptors\n");
+
+    const size_t suffix_len = sizeof(LIBORKH_KERNEL_DESCRIPTOR_SUFFIX) - 1;
+    for (size_t i = 0; i < num_symbols; i++) {
+        GElf_Sym sym;
+        if (gelf_getsym(data, (int) i, &sym) != &sym) return LIBORKH_ERROR_ELF;
+        if (GELF_ST_TYPE(sym.st_info) != STT_OBJECT || sym.st_size < LIBORKH_KERNEL_DESCRIPTOR_SIZE) continue;
+        if (sym.st_shndx == SHN_UNDEF || sym.st_shndx > sections->count) continue;
+
+        const char* name = elf_strptr(sections->elf, symtab_shdr.sh_link, sym.st_name);
+        size_t len = name ? strlen(name) : 0;
+        if (len <= suffix_len || strcmp(name + len - suffix_len, LIBORKH_KERNEL_DESCRIPTOR_SUFFIX) != 0) continue;
+
+        const liborkh_elf_section_t* section = &sections->sections[sym.st_shndx - 1];
+        if (section->type == SHT_NOBITS || sym.st_value < section->addr) continue;
+        if (sym.st_value - section->addr + LIBORKH_KERNEL_DESCRIPTOR_SIZE > section->size) continue;
+
+        size_t offset = section->offset + (sym.st_value - section->addr);
+        if (check_bounds(offset, LIBORKH_KERNEL_DESCRIPTOR_SIZE, entry->elf_size) != LIBORKH_SUCCESS) continue;
+
+        liborkh_kernel_descriptor_t* kd = &descriptors->kernels[descriptors->count];
+        memset(kd, 0, sizeof(*kd));
+        kd->entry_id = entry->id;
+        LIBORKH_CHECK_CALL(liborkh_kernel_descriptor_decode(entry->elf + offset, entry->target_arch, kd), "Cannot decode %s\n", name);
+        LIBORKH_CHECK_CALL(__add_name(descriptors, name, len - suffix_len, &kd->name), "Cannot add kernel name\n");
+        descriptors->count++;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_kernel_descriptors_add_entry(liborkh_kernel_descriptors_t* descriptors, const liborkh_gpu_elf_entry_t* entry) {
+    LIBORKH_CHECK_ARGUMENTS(!descriptors || !entry);
+    if (!entry->elf || entry->elf_size == 0) return LIBORKH_SUCCESS;
+
+    Elf* elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &elf), "Cannot open ELF from memory\n");
+
+    liborkh_elf_section_table_t* sections = NULL;
+    liborkh_status_t status = liborkh_elf_section_table_build(elf, &sections);
+    for (size_t i = 0; status == LIBORKH_SUCCESS && i < sections->count; i++) {
+        if (sections->sections[i].type == SHT_SYMTAB) {
+            status = __add_symbols(descriptors, entry, sections, &sections->sections[i]);
+            break;
+        }
+    }
+    if (sections) liborkh_elf_section_table_free(sections);
+    liborkh_close_elf(elf);
+    return status;
+}
+
+liborkh_status_t liborkh_kernel_descriptors_add_pool(liborkh_kernel_descriptors_t* descriptors, const liborkh_gpu_elf_pool_t* pool) {
+    LIBORKH_CHECK_ARGUMENTS(!descriptors || !pool);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        LIBORKH_CHECK_CALL(liborkh_kernel_descriptors_add_entry(descriptors, pool->entries[i]), "Cannot decode kernel descriptors of entry %zu\n", pool->entries[i]->id);
+    }
+    return LIBORKH_SUCCESS;
+}
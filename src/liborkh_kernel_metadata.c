@@ -7,18 +7,24 @@
 #include "liborkh_log.h"
 #include "liborkh_elf_utils.h"
 #include "liborkh_kernel_metadata.h"
+#include "liborkh_stats.h"
+#include "liborkh_trace.h"
 
 
 liborkh_status_t liborkh_get_kernels_metadata(Elf* elf, uint8_t** out_metadata, size_t* out_size) {
     LIBORKH_CHECK_ARGUMENTS(!elf || !out_metadata || !out_size);
 
+    LIBORKH_TRACE_BEGIN(span);
+
     elf_note_t note = {0};
     LIBORKH_CHECK_CALL(liborkh_get_note_data(elf, &note), "Cannot get .note data\n");
   
-    free(note.name);
+    liborkh_free(note.name);
     *out_size = note.descsz;
     *out_metadata = note.desc;
 
+    LIBORKH_TRACE_END(span, "liborkh_get_kernels_metadata", note.descsz, -1, NULL);
+
     return LIBORKH_SUCCESS;
 }
 
@@ -28,6 +34,9 @@ liborkh_status_t liborkh_get_number_kernels(const uint8_t* metadata, size_t meta
 
     *out_num_kernels = 0;
 
+    LIBORKH_STATS_TIMER_START(count_timer);
+    LIBORKH_TRACE_BEGIN(span);
+
     for (size_t i = 0; i + LIBORKH_AMDHSAMETADATA_KEY_SIZE < metadata_size; i++) {
         if (memcmp(metadata + i, LIBORKH_AMDHSAMETADATA_KEY, LIBORKH_AMDHSAMETADATA_KEY_SIZE) == 0) {
 
@@ -58,36 +67,49 @@ liborkh_status_t liborkh_get_number_kernels(const uint8_t* metadata, size_t meta
         }
     }
 
+    LIBORKH_STATS_ADD(kernels_counted, *out_num_kernels, metadata_size);
+    LIBORKH_STATS_TIMER_STOP(kernels_counted, count_timer);
+    LIBORKH_TRACE_END(span, "liborkh_get_number_kernels", metadata_size, -1, NULL);
     return LIBORKH_SUCCESS;
 }
 
 
-liborkh_status_t liborkh_get_number_kernels_in_pool(liborkh_gpu_elf_pool_t* pool, size_t* out_num_kernels) {
-    LIBORKH_CHECK_ARGUMENTS(!pool || !out_num_kernels);
+liborkh_status_t liborkh_get_number_kernels_in_entry(const liborkh_gpu_elf_entry_t* entry, size_t* out_num_kernels) {
+    LIBORKH_CHECK_ARGUMENTS(!entry || !out_num_kernels);
 
     *out_num_kernels = 0;
 
-    for (size_t i = 0; i < pool->count; ++i) {
-        liborkh_gpu_elf_entry_t *entry = pool->entries[i];
+    if (!entry->elf || entry->elf_size == 0) {
+        return LIBORKH_SUCCESS;
+    }
 
-        if (!entry->elf || entry->elf_size == 0) {
-            continue;
-        }
+    Elf * gpu_elf = NULL;
+    LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &gpu_elf), "Cannot open ELF from memory\n");
 
-        Elf * gpu_elf = NULL;
-        LIBORKH_CHECK_CALL(liborkh_open_elf_from_memory(entry->elf, entry->elf_size, &gpu_elf), "Cannot open ELF from memory for pool entry %zu\n", i);
+    uint8_t *metadata = NULL;
+    size_t metadata_size = 0;
+    liborkh_status_t status = liborkh_get_kernels_metadata(gpu_elf, &metadata, &metadata_size);
+    liborkh_close_elf(gpu_elf);
+    LIBORKH_CHECK_CALL(status, "Cannot get kernel metadata from ELF\n");
 
-        uint8_t *metadata = NULL;
-        size_t metadata_size = 0;
-        LIBORKH_CHECK_CALL(liborkh_get_kernels_metadata(gpu_elf, &metadata, &metadata_size), "Cannot get kernel metadata from ELF in pool entry %zu\n", i);
+    status = liborkh_get_number_kernels(metadata, metadata_size, out_num_kernels);
+    liborkh_free(metadata);
+    LIBORKH_CHECK_CALL(status, "Cannot get number of kernels from metadata\n");
 
+    return LIBORKH_SUCCESS;
+}
+
+
+liborkh_status_t liborkh_get_number_kernels_in_pool(liborkh_gpu_elf_pool_t* pool, size_t* out_num_kernels) {
+    LIBORKH_CHECK_ARGUMENTS(!pool || !out_num_kernels);
+
+    *out_num_kernels = 0;
+
+    for (size_t i = 0; i < pool->count; ++i) {
         size_t num_kernels = 0;
-        LIBORKH_CHECK_CALL(liborkh_get_number_kernels(metadata, metadata_size, &num_kernels), "Cannot get number of kernels from metadata in pool entry %zu\n", i);
+        LIBORKH_CHECK_CALL(liborkh_get_number_kernels_in_entry(pool->entries[i], &num_kernels), "Cannot count kernels in pool entry %zu\n", i);
 
         *out_num_kernels += num_kernels;
-
-        liborkh_close_elf(gpu_elf);
-        free(metadata);
     }
 
     return LIBORKH_SUCCESS;
@@ -1,18 +1,272 @@
 #include <stdio.h>
 #include <stdarg.h>
+#include <string.h>
+#include <strings.h>
+#include <pthread.h>
 #include "liborkh_log.h"
+#include "liborkh_utils.h"
 
-// Log function with file/line/function info
-void liborkh_log(log_level_t level, const char* file, const char* func, int line, const char* fmt, ...) {
+typedef struct {
+    uint64_t seq;
+    log_level_t level;
+    char msg[LIBORKH_LOG_MSG_SIZE];
+} __liborkh_log_slot_t;
+
+int __liborkh_log_level = LOG_INFO;
+
+static uint32_t              __log_rate_limit = LIBORKH_LOG_DEFAULT_RATE;
+static int                   __log_sink = LIBORKH_LOG_SINK_STDERR;
+
+// Bounded multi-producer ring buffer (sequence numbers per slot), single consumer at a time
+static __liborkh_log_slot_t  __log_ring[LIBORKH_LOG_RING_SIZE];
+static uint64_t              __log_enqueue_pos = 0;
+static uint64_t              __log_dequeue_pos = 0;
+static uint64_t              __log_dropped = 0;
+static pthread_mutex_t       __log_drain_lock = PTHREAD_MUTEX_INITIALIZER;
+
+static liborkh_log_site_t*   __log_suppressing_sites = NULL; // sites that suppressed at least one message
+
+static pthread_t             __log_drain_thread;
+static int                   __log_drain_running = 0;
+static liborkh_log_callback_t __log_drain_func = NULL;
+static void*                 __log_drain_user_data = NULL;
+
+
+static void __write_stderr(log_level_t level, const char* msg) {
     // Log level string & color
     switch(level) {
-        case LOG_INFO:  fprintf(stderr, "%s[INFO]%s liborkh : ", COLOR_GREEN, COLOR_RESET); break; // green
-        case LOG_WARN:  fprintf(stderr, "%s[WARN]%s liborkh : ", COLOR_YELLOW, COLOR_RESET); break; // yellow
-        case LOG_ERROR: fprintf(stderr, "%s[ERROR]%s liborkh : %s:%d %s(): ", COLOR_RED, COLOR_RESET, file, line, func); break; // red
+        case LOG_INFO:  fprintf(stderr, "%s[INFO]%s liborkh : %s", COLOR_GREEN, COLOR_RESET, msg); break; // green
+        case LOG_WARN:  fprintf(stderr, "%s[WARN]%s liborkh : %s", COLOR_YELLOW, COLOR_RESET, msg); break; // yellow
+        case LOG_ERROR: fprintf(stderr, "%s[ERROR]%s liborkh : %s", COLOR_RED, COLOR_RESET, msg); break; // red
+        default: break;
+    }
+}
+
+static void __stderr_callback(log_level_t level, const char* msg, void* user_data) {
+    (void) user_data;
+    __write_stderr(level, msg);
+}
+
+static void __enqueue(log_level_t level, const char* msg) {
+    uint64_t pos = __atomic_load_n(&__log_enqueue_pos, __ATOMIC_RELAXED);
+    __liborkh_log_slot_t* slot = NULL;
+
+    for (;;) {
+        slot = &__log_ring[pos % LIBORKH_LOG_RING_SIZE];
+        uint64_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        int64_t diff = (int64_t) seq - (int64_t) pos;
+
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&__log_enqueue_pos, &pos, pos + 1, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                break;
+            }
+        } else if (diff < 0) {
+            __atomic_fetch_add(&__log_dropped, 1, __ATOMIC_RELAXED); // ring full
+            return;
+        } else {
+            pos = __atomic_load_n(&__log_enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+
+    slot->level = level;
+    strncpy(slot->msg, msg, LIBORKH_LOG_MSG_SIZE - 1);
+    slot->msg[LIBORKH_LOG_MSG_SIZE - 1] = '\0';
+    __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+}
+
+static void __vlog(log_level_t level, const char* file, const char* func, int line, const char* fmt, va_list args) {
+    char msg[LIBORKH_LOG_MSG_SIZE];
+    size_t len = 0;
+
+    if (level == LOG_ERROR) {
+        int n = snprintf(msg, sizeof(msg), "%s:%d %s(): ", file, line, func);
+        len = n > 0 && (size_t) n < sizeof(msg) ? (size_t) n : 0;
+    }
+    vsnprintf(msg + len, sizeof(msg) - len, fmt, args);
+
+    if (__atomic_load_n(&__log_sink, __ATOMIC_RELAXED) == LIBORKH_LOG_SINK_RING) {
+        __enqueue(level, msg);
+    } else {
+        __write_stderr(level, msg);
+    }
+}
+
+static void __log(log_level_t level, const char* file, const char* func, int line, const char* fmt, ...) {
+    va_list args;
+    va_start(args, fmt);
+    __vlog(level, file, func, line, fmt, args);
+    va_end(args);
+}
+
+// Log function with file/line/function info
+void liborkh_log(log_level_t level, const char* file, const char* func, int line, const char* fmt, ...) {
+    if ((int) level < __liborkh_log_level) return;
+
+    va_list args;
+    va_start(args, fmt);
+    __vlog(level, file, func, line, fmt, args);
+    va_end(args);
+}
+
+// Push the site on the list reported by liborkh_log_flush_suppressed(), once
+static void __register_site(liborkh_log_site_t* site, log_level_t level, const char* file, const char* func, int line) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&site->registered, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) return;
+
+    site->level = level;
+    site->file  = file;
+    site->func  = func;
+    site->line  = line;
+
+    liborkh_log_site_t* head = __atomic_load_n(&__log_suppressing_sites, __ATOMIC_RELAXED);
+    do {
+        site->next = head;
+    } while (!__atomic_compare_exchange_n(&__log_suppressing_sites, &head, site, true, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+void liborkh_log_flush_suppressed(void) {
+    for (liborkh_log_site_t* site = __atomic_load_n(&__log_suppressing_sites, __ATOMIC_ACQUIRE); site; site = site->next) {
+        uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+        if (suppressed > 0) {
+            __log(site->level, site->file, site->func, site->line, "%u similar messages suppressed\n", suppressed);
+        }
+    }
+}
+
+// Same as liborkh_log, limited to a number of messages per second for the given call site
+void liborkh_log_site(liborkh_log_site_t* site, log_level_t level, const char* file, const char* func, int line, const char* fmt, ...) {
+    uint32_t limit = __atomic_load_n(&__log_rate_limit, __ATOMIC_RELAXED);
+
+    if (limit > 0) {
+        uint64_t now = liborkh_now_ns();
+        uint64_t window_start = __atomic_load_n(&site->window_start_ns, __ATOMIC_RELAXED);
+
+        if (now - window_start >= 1000000000ULL
+                && __atomic_compare_exchange_n(&site->window_start_ns, &window_start, now, false, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+            uint32_t suppressed = __atomic_exchange_n(&site->suppressed, 0, __ATOMIC_RELAXED);
+            __atomic_store_n(&site->count, 0, __ATOMIC_RELAXED);
+            if (suppressed > 0) {
+                __log(level, file, func, line, "%u similar messages suppressed\n", suppressed);
+            }
+        }
+
+        if (__atomic_fetch_add(&site->count, 1, __ATOMIC_RELAXED) >= limit) {
+            __atomic_fetch_add(&site->suppressed, 1, __ATOMIC_RELAXED);
+            __register_site(site, level, file, func, line);
+            return;
+        }
     }
 
     va_list args;
     va_start(args, fmt);
-    vfprintf(stderr, fmt, args);
+    __vlog(level, file, func, line, fmt, args);
     va_end(args);
-}
\ No newline at end of file
+}
+
+void liborkh_log_set_level(log_level_t level) {
+    __atomic_store_n(&__liborkh_log_level, level, __ATOMIC_RELAXED);
+}
+
+log_level_t liborkh_log_get_level(void) {
+    return (log_level_t) __atomic_load_n(&__liborkh_log_level, __ATOMIC_RELAXED);
+}
+
+void liborkh_log_set_rate_limit(uint32_t per_second) {
+    __atomic_store_n(&__log_rate_limit, per_second, __ATOMIC_RELAXED);
+}
+
+void liborkh_log_set_sink(liborkh_log_sink_t sink) {
+    __atomic_store_n(&__log_sink, sink, __ATOMIC_RELAXED);
+}
+
+size_t liborkh_log_drain(liborkh_log_callback_t func, void* user_data) {
+    func = func ? func : __stderr_callback;
+
+    size_t drained = 0;
+    pthread_mutex_lock(&__log_drain_lock);
+
+    for (;;) {
+        uint64_t pos = __log_dequeue_pos;
+        __liborkh_log_slot_t* slot = &__log_ring[pos % LIBORKH_LOG_RING_SIZE];
+        if (__atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE) != pos + 1) break; // empty
+
+        func(slot->level, slot->msg, user_data);
+        __atomic_store_n(&slot->seq, pos + LIBORKH_LOG_RING_SIZE, __ATOMIC_RELEASE);
+        __log_dequeue_pos = pos + 1;
+        drained++;
+    }
+
+    uint64_t dropped = __atomic_exchange_n(&__log_dropped, 0, __ATOMIC_RELAXED);
+    if (dropped > 0) {
+        char msg[LIBORKH_LOG_MSG_SIZE];
+        snprintf(msg, sizeof(msg), "%lu messages dropped (log ring buffer full)\n", (unsigned long) dropped);
+        func(LOG_WARN, msg, user_data);
+    }
+
+    pthread_mutex_unlock(&__log_drain_lock);
+    return drained;
+}
+
+static void* __drain_thread_main(void* arg) {
+    (void) arg;
+    const struct timespec period = { 0, 2 * 1000 * 1000 };
+
+    while (__atomic_load_n(&__log_drain_running, __ATOMIC_ACQUIRE)) {
+        if (liborkh_log_drain(__log_drain_func, __log_drain_user_data) == 0) {
+            nanosleep(&period, NULL);
+        }
+    }
+    liborkh_log_drain(__log_drain_func, __log_drain_user_data);
+    return NULL;
+}
+
+/**
+ * Switch to the ring buffer sink and deliver messages from a background thread.
+ * @param func Callback receiving each message, NULL to write them to stderr
+ */
+int liborkh_log_start_drain_thread(liborkh_log_callback_t func, void* user_data) {
+    int expected = 0;
+    if (!__atomic_compare_exchange_n(&__log_drain_running, &expected, 1, false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) return 0;
+
+    __log_drain_func = func;
+    __log_drain_user_data = user_data;
+
+    if (pthread_create(&__log_drain_thread, NULL, __drain_thread_main, NULL) != 0) {
+        __atomic_store_n(&__log_drain_running, 0, __ATOMIC_RELEASE);
+        return -1;
+    }
+    liborkh_log_set_sink(LIBORKH_LOG_SINK_RING);
+    return 0;
+}
+
+void liborkh_log_stop_drain_thread(void) {
+    if (!__atomic_load_n(&__log_drain_running, __ATOMIC_ACQUIRE)) return;
+
+    liborkh_log_flush_suppressed(); // delivered by the last drain
+    liborkh_log_set_sink(LIBORKH_LOG_SINK_STDERR);
+    if (__atomic_exchange_n(&__log_drain_running, 0, __ATOMIC_ACQ_REL)) {
+        pthread_join(__log_drain_thread, NULL);
+    }
+}
+
+__attribute__((constructor))
+static void __liborkh_log_init(void) {
+    for (uint64_t i = 0; i < LIBORKH_LOG_RING_SIZE; i++) {
+        __log_ring[i].seq = i;
+    }
+
+    const char* env = getenv(LIBORKH_LOG_ENV);
+    if (!env) return;
+
+    if      (strcasecmp(env, "info")  == 0) liborkh_log_set_level(LOG_INFO);
+    else if (strcasecmp(env, "warn")  == 0) liborkh_log_set_level(LOG_WARN);
+    else if (strcasecmp(env, "error") == 0) liborkh_log_set_level(LOG_ERROR);
+    else if (strcasecmp(env, "none")  == 0) liborkh_log_set_level(LOG_NONE);
+}
+
+__attribute__((destructor))
+static void __liborkh_log_fini(void) {
+    liborkh_log_stop_drain_thread();
+    liborkh_log_flush_suppressed();
+    liborkh_log_drain(NULL, NULL);
+}
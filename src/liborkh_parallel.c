@@ -0,0 +1,69 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "liborkh.h"
+#include "liborkh_parallel.h"
+
+typedef struct {
+    size_t count;
+    liborkh_parallel_cb_t func;
+    void* user_data;
+    liborkh_stats_t* stats;
+    liborkh_budget_t* budget;
+    size_t next;
+} __liborkh_parallel_t;
+
+static void* __parallel_worker(void* arg) {
+    __liborkh_parallel_t* work = (__liborkh_parallel_t*) arg;
+    liborkh_stats_bind(work->stats);
+    liborkh_budget_bind(work->budget);
+
+    for (;;) {
+        size_t index = __atomic_fetch_add(&work->next, 1, __ATOMIC_RELAXED);
+        if (index >= work->count) break;
+        work->func(index, work->user_data);
+    }
+
+    liborkh_budget_bind(NULL);
+    liborkh_stats_bind(NULL);
+    return NULL;
+}
+
+liborkh_status_t liborkh_parallel_for(size_t count, size_t num_threads, liborkh_parallel_cb_t func, void* user_data) {
+    LIBORKH_CHECK_ARGUMENTS(!func);
+
+    if (count == 0) return LIBORKH_SUCCESS;
+
+    if (num_threads == 0) {
+        long online = sysconf(_SC_NPROCESSORS_ONLN);
+        num_threads = online > 0 ? (size_t) online : 1;
+    }
+    if (num_threads > count) num_threads = count;
+
+    __liborkh_parallel_t work = {
+        .count     = count,
+        .func      = func,
+        .user_data = user_data,
+        .stats     = __liborkh_stats(), // workers account into the caller's statistics
+        .budget    = liborkh_budget_current(), // and the caller's memory budget
+        .next      = 0,
+    };
+
+    pthread_t* threads = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, num_threads * sizeof(pthread_t));
+    LIBORKH_CHECK_ALLOC(threads);
+
+    size_t num_started = 0;
+    for (; num_started < num_threads; num_started++) {
+        if (pthread_create(&threads[num_started], NULL, __parallel_worker, &work) != 0) break;
+    }
+    if (num_started == 0) {
+        __parallel_worker(&work); // no thread could be created, run on the calling thread
+    }
+    for (size_t i = 0; i < num_started; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    liborkh_free(threads);
+    return LIBORKH_SUCCESS;
+}
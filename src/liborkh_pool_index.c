@@ -0,0 +1,257 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_pool_index.h"
+
+typedef struct {
+    const char* string;
+    uint64_t number;
+    uint32_t row;
+} __liborkh_pool_key_item_t;
+
+static int __string_item_compare(const void* a, const void* b) {
+    const __liborkh_pool_key_item_t* x = (const __liborkh_pool_key_item_t*) a;
+    const __liborkh_pool_key_item_t* y = (const __liborkh_pool_key_item_t*) b;
+
+    int cmp = strcmp(x->string, y->string);
+    if (cmp != 0) return cmp;
+    return x->row < y->row ? -1 : (x->row > y->row);
+}
+
+static int __number_item_compare(const void* a, const void* b) {
+    const __liborkh_pool_key_item_t* x = (const __liborkh_pool_key_item_t*) a;
+    const __liborkh_pool_key_item_t* y = (const __liborkh_pool_key_item_t*) b;
+
+    if (x->number != y->number) return x->number < y->number ? -1 : 1;
+    return x->row < y->row ? -1 : (x->row > y->row);
+}
+
+static bool __is_string_key(liborkh_pool_key_t key) {
+    return key == LIBORKH_POOL_KEY_ARCH || key == LIBORKH_POOL_KEY_TRIPLE;
+}
+
+static bool __same_value(bool strings, const __liborkh_pool_key_item_t* a, const __liborkh_pool_key_item_t* b) {
+    return strings ? strcmp(a->string, b->string) == 0 : a->number == b->number;
+}
+
+static void __key_index_free(liborkh_pool_key_index_t* key_index) {
+    liborkh_free(key_index->strings);
+    liborkh_free(key_index->numbers);
+    liborkh_free(key_index->offsets);
+    liborkh_free(key_index->rows);
+    memset(key_index, 0, sizeof(*key_index));
+}
+
+/**
+ * Sort (value, row) pairs and compress them into distinct values and
+ * per-value row lists.
+ */
+static liborkh_status_t __build_key(const liborkh_gpu_elf_pool_t* pool, liborkh_pool_key_t key, __liborkh_pool_key_item_t* items, liborkh_pool_key_index_t* out) {
+    size_t n = 0;
+    for (size_t i = 0; i < pool->count; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        __liborkh_pool_key_item_t* item = &items[n];
+        item->row = (uint32_t) i;
+        item->string = NULL;
+        item->number = 0;
+
+        switch (key) {
+            case LIBORKH_POOL_KEY_ARCH:   item->string = entry->target_arch; break;
+            case LIBORKH_POOL_KEY_TRIPLE: item->string = entry->target_triple; break;
+            case LIBORKH_POOL_KEY_OFK:    item->number = (uint64_t) entry->ofk; break;
+            case LIBORKH_POOL_KEY_IMG:    item->number = (uint64_t) entry->img; break;
+            default:                      item->number = (uint64_t) entry->id; break;
+        }
+        if (__is_string_key(key) && !item->string) continue;
+        n++;
+    }
+
+    bool strings = __is_string_key(key);
+    qsort(items, n, sizeof(__liborkh_pool_key_item_t), strings ? __string_item_compare : __number_item_compare);
+
+    size_t num_values = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || !__same_value(strings, &items[i - 1], &items[i])) num_values++;
+    }
+
+    out->num_values = num_values;
+    out->offsets = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (num_values + 1) * sizeof(uint32_t));
+    out->rows    = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (n + 1) * sizeof(uint32_t));
+    if (strings) out->strings = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (num_values + 1) * sizeof(const char*));
+    else         out->numbers = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (num_values + 1) * sizeof(uint64_t));
+    if (!out->offsets || !out->rows || (strings ? !out->strings : !out->numbers)) return LIBORKH_ERROR_OUT_OF_MEMORY;
+
+    size_t v = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || !__same_value(strings, &items[i - 1], &items[i])) {
+            out->offsets[v] = (uint32_t) i;
+            if (strings) out->strings[v] = items[i].string;
+            else         out->numbers[v] = items[i].number;
+            v++;
+        }
+        out->rows[i] = items[i].row;
+    }
+    out->offsets[num_values] = (uint32_t) n;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_pool_index_build(const liborkh_gpu_elf_pool_t* pool, liborkh_pool_index_t** index) {
+    LIBORKH_CHECK_ARGUMENTS(!pool || !index);
+    LIBORKH_CHECK_CALL(pool->count > UINT32_MAX ? LIBORKH_ERROR_OUT_OF_BOUNDS : LIBORKH_SUCCESS, "Pool too large to index\n");
+
+    *index = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_pool_index_t));
+    LIBORKH_CHECK_ALLOC(*index);
+    (*index)->pool  = pool;
+    (*index)->count = pool->count;
+
+    __liborkh_pool_key_item_t* items = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (pool->count + 1) * sizeof(__liborkh_pool_key_item_t));
+    liborkh_status_t status = items ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_MEMORY;
+    for (int key = 0; key < LIBORKH_POOL_KEY_COUNT && status == LIBORKH_SUCCESS; key++) {
+        status = __build_key(pool, (liborkh_pool_key_t) key, items, &(*index)->keys[key]);
+    }
+    liborkh_free(items);
+
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to index pool\n");
+        liborkh_pool_index_free(*index);
+        *index = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_pool_index_free(liborkh_pool_index_t* index) {
+    LIBORKH_CHECK_ARGUMENTS(!index);
+
+    for (int key = 0; key < LIBORKH_POOL_KEY_COUNT; key++) __key_index_free(&index->keys[key]);
+    liborkh_free(index);
+    return LIBORKH_SUCCESS;
+}
+
+static void __value_rows(const liborkh_pool_key_index_t* key_index, size_t value, const uint32_t** rows, size_t* num_rows) {
+    *rows = key_index->rows + key_index->offsets[value];
+    *num_rows = key_index->offsets[value + 1] - key_index->offsets[value];
+}
+
+liborkh_status_t liborkh_pool_index_find_string(const liborkh_pool_index_t* index, liborkh_pool_key_t key, const char* value, const uint32_t** rows, size_t* num_rows) {
+    LIBORKH_CHECK_ARGUMENTS(!index || !value || !rows || !num_rows || !__is_string_key(key));
+
+    const liborkh_pool_key_index_t* key_index = &index->keys[key];
+    *rows = NULL;
+    *num_rows = 0;
+
+    size_t lo = 0, hi = key_index->num_values;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(key_index->strings[mid], value);
+        if (cmp == 0) {
+            __value_rows(key_index, mid, rows, num_rows);
+            break;
+        }
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_pool_index_find_number(const liborkh_pool_index_t* index, liborkh_pool_key_t key, uint64_t value, const uint32_t** rows, size_t* num_rows) {
+    LIBORKH_CHECK_ARGUMENTS(!index || !rows || !num_rows || key >= LIBORKH_POOL_KEY_COUNT || __is_string_key(key));
+
+    const liborkh_pool_key_index_t* key_index = &index->keys[key];
+    *rows = NULL;
+    *num_rows = 0;
+
+    size_t lo = 0, hi = key_index->num_values;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (key_index->numbers[mid] == value) {
+            __value_rows(key_index, mid, rows, num_rows);
+            break;
+        }
+        if (key_index->numbers[mid] < value) lo = mid + 1;
+        else hi = mid;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+static bool __contains(const uint32_t* rows, size_t num_rows, uint32_t row) {
+    size_t lo = 0, hi = num_rows;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (rows[mid] == row) return true;
+        if (rows[mid] < row) lo = mid + 1;
+        else hi = mid;
+    }
+    return false;
+}
+
+liborkh_status_t liborkh_pool_index_query(const liborkh_pool_index_t* index, const liborkh_entry_filter_t* filter, size_t id, uint32_t* rows, size_t* num_rows) {
+    LIBORKH_CHECK_ARGUMENTS(!index || !rows || !num_rows);
+
+    // Posting list of each predicate of the query
+    const uint32_t* lists[LIBORKH_POOL_KEY_COUNT];
+    size_t sizes[LIBORKH_POOL_KEY_COUNT];
+    size_t num_lists = 0;
+
+    if (filter && filter->target_arch) {
+        liborkh_pool_index_find_string(index, LIBORKH_POOL_KEY_ARCH, filter->target_arch, &lists[num_lists], &sizes[num_lists]);
+        num_lists++;
+    }
+    if (filter && filter->target_triple) {
+        liborkh_pool_index_find_string(index, LIBORKH_POOL_KEY_TRIPLE, filter->target_triple, &lists[num_lists], &sizes[num_lists]);
+        num_lists++;
+    }
+    if (filter && filter->ofk != OFK_None) {
+        liborkh_pool_index_find_number(index, LIBORKH_POOL_KEY_OFK, (uint64_t) filter->ofk, &lists[num_lists], &sizes[num_lists]);
+        num_lists++;
+    }
+    if (filter && filter->img != IMG_None) {
+        liborkh_pool_index_find_number(index, LIBORKH_POOL_KEY_IMG, (uint64_t) filter->img, &lists[num_lists], &sizes[num_lists]);
+        num_lists++;
+    }
+    if (id != LIBORKH_POOL_INDEX_ANY_ID) {
+        liborkh_pool_index_find_number(index, LIBORKH_POOL_KEY_ID, (uint64_t) id, &lists[num_lists], &sizes[num_lists]);
+        num_lists++;
+    }
+
+    size_t limit = filter && filter->limit > 0 ? filter->limit : SIZE_MAX;
+    *num_rows = 0;
+    if (num_lists == 0) {
+        for (size_t i = 0; i < index->count && *num_rows < limit; i++) rows[(*num_rows)++] = (uint32_t) i;
+        return LIBORKH_SUCCESS;
+    }
+
+    // Walk the shortest list, probe the others
+    size_t shortest = 0;
+    for (size_t l = 1; l < num_lists; l++) {
+        if (sizes[l] < sizes[shortest]) shortest = l;
+    }
+
+    for (size_t i = 0; i < sizes[shortest] && *num_rows < limit; i++) {
+        uint32_t row = lists[shortest][i];
+        bool match = true;
+        for (size_t l = 0; l < num_lists && match; l++) {
+            if (l != shortest) match = __contains(lists[l], sizes[l], row);
+        }
+        if (match) rows[(*num_rows)++] = row;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_pool_index_query_bitmap(const liborkh_pool_index_t* index, const liborkh_entry_filter_t* filter, size_t id, uint64_t* bitmap) {
+    LIBORKH_CHECK_ARGUMENTS(!index || !bitmap);
+
+    uint32_t* rows = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (index->count + 1) * sizeof(uint32_t));
+    LIBORKH_CHECK_ALLOC(rows);
+
+    size_t num_rows = 0;
+    liborkh_status_t status = liborkh_pool_index_query(index, filter, id, rows, &num_rows);
+
+    memset(bitmap, 0, ((index->count + 63) / 64) * sizeof(uint64_t));
+    for (size_t i = 0; i < num_rows && status == LIBORKH_SUCCESS; i++) {
+        bitmap[rows[i] / 64] |= UINT64_C(1) << (rows[i] % 64);
+    }
+    liborkh_free(rows);
+    return status;
+}
@@ -0,0 +1,356 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <elf.h>
+#include <sys/uio.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
+
+#include "liborkh.h"
+#include "liborkh_process.h"
+
+static liborkh_status_t __read_remote(pid_t pid, uintptr_t addr, void* out, size_t size) {
+    size_t done = 0;
+    while (done < size) {
+        struct iovec local  = { (uint8_t*) out + done, size - done };
+        struct iovec remote = { (void*) (addr + done), size - done };
+
+        ssize_t n = process_vm_readv(pid, &local, 1, &remote, 1, 0);
+        if (n <= 0) return LIBORKH_ERROR_IO; // callers report, unreadable mappings are common
+        done += (size_t) n;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+// Read from the file backing an image, only used for the (small) section header table:
+// it is not covered by any PT_LOAD segment, so it is either not mapped or zeroed in memory
+static liborkh_status_t __read_file(const liborkh_process_image_t* image, uint64_t offset, void* out, size_t size) {
+    int fd = open(image->path, O_RDONLY);
+    if (fd < 0) {
+        liborkh_log_err("Failed to open file: %s\n", image->path);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    // The file may have been replaced since it was mapped
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (uint64_t) st.st_ino != image->inode || (uint64_t) st.st_dev != image->dev) {
+        liborkh_log_warn("File %s changed since it was mapped\n", image->path);
+        close(fd);
+        return LIBORKH_ERROR_IO;
+    }
+
+    ssize_t n = pread(fd, out, size, (off_t) offset);
+    close(fd);
+    return n == (ssize_t) size ? LIBORKH_SUCCESS : LIBORKH_ERROR_IO;
+}
+
+// Whether [addr, addr + size) is covered by mappings of the image file
+static bool __is_mapped(const liborkh_process_t* process, const liborkh_process_image_t* image, uintptr_t addr, size_t size) {
+    uintptr_t end = addr + size;
+    bool progress = true;
+    while (addr < end && progress) {
+        progress = false;
+        for (size_t i = 0; i < process->num_mappings; i++) {
+            const liborkh_process_mapping_t* m = &process->mappings[i];
+            if (m->dev == image->dev && m->inode == image->inode && addr >= m->start && addr < m->end) {
+                addr = m->end;
+                progress = true;
+            }
+        }
+    }
+    return addr >= end;
+}
+
+static liborkh_status_t __add_mapping(liborkh_process_t* process, size_t* capacity, const liborkh_process_mapping_t* mapping) {
+    if (process->num_mappings >= *capacity) {
+        size_t new_capacity = *capacity ? *capacity * 2 : 64;
+        liborkh_process_mapping_t* tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, process->mappings, new_capacity * sizeof(liborkh_process_mapping_t));
+        LIBORKH_CHECK_ALLOC(tmp);
+        process->mappings = tmp;
+        *capacity = new_capacity;
+    }
+    process->mappings[process->num_mappings++] = *mapping;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_process_image_t* __find_image(liborkh_process_t* process, uintptr_t start, uint64_t dev, uint64_t inode) {
+    for (size_t i = 0; i < process->count; i++) {
+        liborkh_process_image_t* image = &process->images[i];
+        if (image->start == start && image->dev == dev && image->inode == inode) return image;
+    }
+    return NULL;
+}
+
+static liborkh_status_t __add_image(liborkh_process_t* process, const liborkh_process_mapping_t* mapping, const char* path, size_t* num_unreadable) {
+    liborkh_process_image_t* image = __find_image(process, mapping->start, mapping->dev, mapping->inode);
+    if (image) {
+        image->seen = true; // cached
+        return LIBORKH_SUCCESS;
+    }
+
+    uint8_t ident[SELFMAG];
+    if (__read_remote(process->pid, mapping->start, ident, sizeof(ident)) != LIBORKH_SUCCESS) {
+        (*num_unreadable)++;
+        return LIBORKH_SUCCESS;
+    }
+    if (memcmp(ident, ELFMAG, SELFMAG) != 0) {
+        return LIBORKH_SUCCESS; // not an ELF image
+    }
+
+    if (process->count >= process->capacity) {
+        size_t new_capacity = process->capacity ? process->capacity * 2 : 16;
+        liborkh_process_image_t* tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_POOL, process->images, new_capacity * sizeof(liborkh_process_image_t));
+        LIBORKH_CHECK_ALLOC(tmp);
+        process->images = tmp;
+        process->capacity = new_capacity;
+    }
+
+    image = &process->images[process->count];
+    memset(image, 0, sizeof(*image));
+    image->path = liborkh_strdup(LIBORKH_ALLOC_STAGE_IO, path);
+    LIBORKH_CHECK_ALLOC(image->path);
+    image->start = mapping->start;
+    image->dev   = mapping->dev;
+    image->inode = mapping->inode;
+    image->seen  = true;
+    process->count++;
+    return LIBORKH_SUCCESS;
+}
+
+static void __release_image(liborkh_process_image_t* image) {
+    liborkh_free(image->path);
+    liborkh_free(image->fatbin.buf);
+    image->path = NULL;
+    image->fatbin.buf = NULL;
+}
+
+liborkh_status_t liborkh_process_refresh(liborkh_process_t* process) {
+    LIBORKH_CHECK_ARGUMENTS(!process);
+
+    char maps_path[64];
+    snprintf(maps_path, sizeof(maps_path), "/proc/%d/maps", (int) process->pid);
+
+    FILE* f = fopen(maps_path, "r");
+    if (!f) {
+        liborkh_log_err("Failed to open file: %s\n", maps_path);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    for (size_t i = 0; i < process->count; i++) {
+        process->images[i].seen = false;
+    }
+    liborkh_free(process->mappings);
+    process->mappings = NULL;
+    process->num_mappings = 0;
+    size_t mappings_capacity = 0;
+    size_t num_unreadable = 0;
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    char line[4096 + 256];
+    while (status == LIBORKH_SUCCESS && fgets(line, sizeof(line), f)) {
+        unsigned long start, end, offset, inode;
+        unsigned int major, minor;
+        char perms[8];
+        int path_pos = 0;
+
+        if (sscanf(line, "%lx-%lx %7s %lx %x:%x %lu %n", &start, &end, perms, &offset, &major, &minor, &inode, &path_pos) < 7) continue;
+        if (inode == 0 || path_pos == 0 || line[path_pos] != '/') continue; // anonymous or special mapping
+
+        line[strcspn(line, "\n")] = '\0';
+
+        liborkh_process_mapping_t mapping = {
+            .start  = start,
+            .end    = end,
+            .offset = offset,
+            .dev    = makedev(major, minor),
+            .inode  = inode,
+        };
+        status = __add_mapping(process, &mappings_capacity, &mapping);
+
+        if (status == LIBORKH_SUCCESS && offset == 0 && perms[0] == 'r') {
+            status = __add_image(process, &mapping, line + path_pos, &num_unreadable);
+        }
+    }
+    fclose(f);
+
+    if (num_unreadable > 0) {
+        liborkh_log_warn("%zu mappings of pid %d could not be read\n", num_unreadable, (int) process->pid);
+    }
+
+    // Drop the images that are not mapped anymore
+    size_t kept = 0;
+    for (size_t i = 0; i < process->count; i++) {
+        if (process->images[i].seen) {
+            process->images[kept++] = process->images[i];
+        } else {
+            __release_image(&process->images[i]);
+        }
+    }
+    process->count = kept;
+    return status;
+}
+
+liborkh_status_t liborkh_process_open(pid_t pid, liborkh_process_t** process) {
+    LIBORKH_CHECK_ARGUMENTS(!process || pid <= 0);
+
+    *process = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_process_t));
+    LIBORKH_CHECK_ALLOC(*process);
+    (*process)->pid = pid;
+
+    liborkh_status_t status = liborkh_process_refresh(*process);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_process_close(*process);
+        *process = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_process_close(liborkh_process_t* process) {
+    LIBORKH_CHECK_ARGUMENTS(!process);
+
+    for (size_t i = 0; i < process->count; i++) {
+        __release_image(&process->images[i]);
+    }
+    liborkh_free(process->images);
+    liborkh_free(process->mappings);
+    liborkh_free(process);
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Locate the offload section of an image from its ELF header and section header table,
+ * then read its loaded copy from the process memory.
+ */
+static liborkh_status_t __load_fatbin(liborkh_process_t* process, liborkh_process_image_t* image) {
+    Elf64_Ehdr ehdr;
+    LIBORKH_CHECK_CALL(__read_remote(process->pid, image->start, &ehdr, sizeof(ehdr)), "Cannot read ELF header of %s\n", image->path);
+
+    if (ehdr.e_ident[EI_CLASS] != ELFCLASS64 || ehdr.e_shnum == 0 || ehdr.e_shstrndx >= ehdr.e_shnum
+            || ehdr.e_shentsize != sizeof(Elf64_Shdr) || ehdr.e_phentsize != sizeof(Elf64_Phdr)) {
+        return LIBORKH_SUCCESS; // nothing we can locate
+    }
+
+    // Load bias from the first PT_LOAD segment (mapped at image->start)
+    size_t phdrs_size = (size_t) ehdr.e_phnum * sizeof(Elf64_Phdr);
+    Elf64_Phdr* phdrs = liborkh_malloc(LIBORKH_ALLOC_STAGE_SECTION, phdrs_size);
+    LIBORKH_CHECK_ALLOC(phdrs);
+
+    liborkh_status_t status = __read_remote(process->pid, image->start + ehdr.e_phoff, phdrs, phdrs_size);
+    uintptr_t bias = 0;
+    bool has_load = false;
+    uint64_t page_mask = ~((uint64_t) sysconf(_SC_PAGESIZE) - 1);
+    for (size_t i = 0; status == LIBORKH_SUCCESS && i < ehdr.e_phnum; i++) {
+        if (phdrs[i].p_type == PT_LOAD) {
+            bias = image->start - (phdrs[i].p_vaddr & page_mask);
+            has_load = true;
+            break;
+        }
+    }
+    liborkh_free(phdrs);
+    if (status != LIBORKH_SUCCESS || !has_load) return status;
+
+    size_t shdrs_size = (size_t) ehdr.e_shnum * sizeof(Elf64_Shdr);
+    Elf64_Shdr* shdrs = liborkh_malloc(LIBORKH_ALLOC_STAGE_SECTION, shdrs_size);
+    LIBORKH_CHECK_ALLOC(shdrs);
+
+    status = __read_file(image, ehdr.e_shoff, shdrs, shdrs_size);
+
+    char* shstrtab = NULL;
+    const Elf64_Shdr* strtab_hdr = &shdrs[ehdr.e_shstrndx];
+    if (status == LIBORKH_SUCCESS) {
+        shstrtab = liborkh_malloc(LIBORKH_ALLOC_STAGE_SECTION, strtab_hdr->sh_size + 1);
+        status = shstrtab ? __read_file(image, strtab_hdr->sh_offset, shstrtab, strtab_hdr->sh_size) : LIBORKH_ERROR_OUT_OF_MEMORY;
+    }
+
+    for (size_t i = 0; status == LIBORKH_SUCCESS && i < ehdr.e_shnum; i++) {
+        const Elf64_Shdr* shdr = &shdrs[i];
+        if (shdr->sh_name >= strtab_hdr->sh_size) continue;
+
+        shstrtab[strtab_hdr->sh_size] = '\0';
+        const char* name = shstrtab + shdr->sh_name;
+
+        liborkh_offload_encoding_kind kind = UNKNOWN_KIND;
+        if (strcmp(name, LIBORKH_HIP_FATBIN_SECTION_NAME) == 0) {
+            kind = CLANG_OFFLOAD_BUNDLER_KIND;
+        } else if (strcmp(name, LIBORKH_LLVM_OFFLOADING_FATBIN_SECTION_NAME) == 0) {
+            kind = CLANG_OFFLOAD_PACKAGER_KIND;
+        } else {
+            continue;
+        }
+
+        if (!(shdr->sh_flags & SHF_ALLOC) || shdr->sh_type == SHT_NOBITS || shdr->sh_size == 0) {
+            liborkh_log_warn("Section %s of %s is not loaded in memory\n", name, image->path);
+            continue;
+        }
+
+        if (!__is_mapped(process, image, bias + shdr->sh_addr, shdr->sh_size)) {
+            liborkh_log_warn("Section %s of %s is not mapped at 0x%lx\n", name, image->path, (unsigned long) (bias + shdr->sh_addr));
+            continue;
+        }
+
+        LIBORKH_STATS_TIMER_START(read_timer);
+
+        uint8_t* buf = liborkh_malloc(LIBORKH_ALLOC_STAGE_FATBIN, shdr->sh_size);
+        if (!buf) {
+            status = LIBORKH_ERROR_OUT_OF_MEMORY;
+            break;
+        }
+        status = __read_remote(process->pid, bias + shdr->sh_addr, buf, shdr->sh_size);
+        if (status != LIBORKH_SUCCESS) {
+            liborkh_free(buf);
+            break;
+        }
+
+        image->fatbin.kind = kind;
+        image->fatbin.buf  = buf;
+        image->fatbin.size = shdr->sh_size;
+
+        LIBORKH_STATS_ADD(offload_read, 1, shdr->sh_size);
+        LIBORKH_STATS_TIMER_STOP(offload_read, read_timer);
+        break;
+    }
+
+    liborkh_free(shstrtab);
+    liborkh_free(shdrs);
+    return status;
+}
+
+liborkh_status_t liborkh_process_read_fatbin(liborkh_process_t* process, size_t index, const liborkh_offload_buffer** fatbin) {
+    LIBORKH_CHECK_ARGUMENTS(!process || !fatbin || index >= process->count);
+
+    liborkh_process_image_t* image = &process->images[index];
+    if (!image->loaded) {
+        LIBORKH_CHECK_CALL(__load_fatbin(process, image), "Failed to read offload section of %s\n", image->path);
+        image->loaded = true; // images without offload section are cached as well
+    }
+
+    *fatbin = &image->fatbin;
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Entry ids restart at 0 for every image, entries are tagged with the path of
+ * their image (member_name) so that they stay distinguishable.
+ */
+liborkh_status_t liborkh_process_get_gpu_elfs(liborkh_process_t* process, liborkh_gpu_elf_pool_t* pool, liborkh_entry_filter_t* filter) {
+    LIBORKH_CHECK_ARGUMENTS(!process || !pool);
+
+    for (size_t i = 0; i < process->count; i++) {
+        const liborkh_offload_buffer* fatbin = NULL;
+        if (liborkh_process_read_fatbin(process, i, &fatbin) != LIBORKH_SUCCESS || !fatbin->buf) continue;
+
+        size_t first = pool->count;
+        LIBORKH_CHECK_CALL(liborkh_get_gpu_elfs((liborkh_offload_buffer*) fatbin, pool, filter), "Failed to decode offload section of %s\n", process->images[i].path);
+
+        for (size_t j = first; j < pool->count; j++) {
+            liborkh_gpu_elf_entry_t* entry = pool->entries[j];
+            if (entry->member_name) continue;
+            entry->member_name = liborkh_strdup(LIBORKH_ALLOC_STAGE_ENTRY_ID, process->images[i].path);
+            LIBORKH_CHECK_ALLOC(entry->member_name);
+        }
+    }
+    return LIBORKH_SUCCESS;
+}
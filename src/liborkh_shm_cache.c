@@ -0,0 +1,239 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <unistd.h>
+#include <dirent.h>
+#include <stddef.h>
+#include <sys/file.h>
+#include <sys/stat.h>
+
+#include "liborkh.h"
+#include "liborkh_shm_cache.h"
+
+// File identity hashed into the object name
+typedef struct {
+    uint64_t dev;
+    uint64_t ino;
+    uint64_t size;
+    int64_t  mtime_sec;
+    int64_t  mtime_nsec;
+    uint64_t version;
+} __liborkh_shm_cache_key_t;
+
+static const char* __cache_dir(void) {
+    const char* dir = getenv(LIBORKH_SHM_CACHE_DIR_ENV);
+    return dir && dir[0] ? dir : LIBORKH_SHM_CACHE_DEFAULT_DIR;
+}
+
+/*
+ * Object names are liborkh-<uid>-<file>-<key><suffix>: <file> hashes the
+ * device and inode only, so that the objects of older versions of a binary
+ * can be found (and removed) when a new one is published.
+ */
+static liborkh_status_t __cache_path(const char* filename, const char* suffix, char* path, size_t size) {
+    struct stat st;
+    if (stat(filename, &st) != 0) {
+        liborkh_log_err("Failed to stat file: %s\n", filename);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    __liborkh_shm_cache_key_t key = {
+        .dev        = (uint64_t) st.st_dev,
+        .ino        = (uint64_t) st.st_ino,
+        .size       = (uint64_t) st.st_size,
+        .mtime_sec  = (int64_t) st.st_mtim.tv_sec,
+        .mtime_nsec = (int64_t) st.st_mtim.tv_nsec,
+        .version    = LIBORKH_SNAPSHOT_VERSION,
+    };
+
+    uint64_t file = liborkh_hash128(&key, offsetof(__liborkh_shm_cache_key_t, size), 0).lo;
+    char hash[LIBORKH_HASH128_STRING_SIZE];
+    liborkh_hash128_to_string(liborkh_hash128(&key, sizeof(key), 0), hash);
+
+    int len = snprintf(path, size, "%s/liborkh-%u-%016llx-%s%s", __cache_dir(), (unsigned) geteuid(), (unsigned long long) file, hash, suffix);
+    return len > 0 && (size_t) len < size ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_BOUNDS;
+}
+
+static int __compare_names(const void* a, const void* b) {
+    return strcmp(*(char* const*) a, *(char* const*) b);
+}
+
+// Length of the object name without suffix (.orkh, .lock, .orkh.tmp.<pid>)
+static size_t __stem_length(const char* name) {
+    return strcspn(name, ".");
+}
+
+/**
+ * Remove the objects of the cache directory whose name starts with prefix,
+ * except the ones of stem `keep`. The files of an object (snapshot, leftover
+ * temporary files) are only removed while holding its lock without waiting, an
+ * object being published is left alone. Attached processes keep their mapping.
+ * Lock files are kept, see liborkh_shm_cache_open().
+ */
+static liborkh_status_t __remove_objects(const char* prefix, const char* keep, size_t* num_removed) {
+    const char* dir_path = __cache_dir();
+    DIR* dir = opendir(dir_path);
+    if (!dir) {
+        liborkh_log_err("Failed to open cache directory: %s\n", dir_path);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    size_t count = 0, capacity = 0;
+    char** names = NULL;
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    for (struct dirent* de; (de = readdir(dir)) != NULL && status == LIBORKH_SUCCESS; ) {
+        if (strncmp(de->d_name, prefix, strlen(prefix)) != 0) continue;
+        if (keep && __stem_length(de->d_name) == strlen(keep) && strncmp(de->d_name, keep, strlen(keep)) == 0) continue;
+
+        if (count == capacity) {
+            capacity = capacity ? capacity * 2 : 16;
+            char** tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_IO, names, capacity * sizeof(char*));
+            if (!tmp) { status = LIBORKH_ERROR_OUT_OF_MEMORY; break; }
+            names = tmp;
+        }
+        names[count] = liborkh_strdup(LIBORKH_ALLOC_STAGE_IO, de->d_name);
+        if (!names[count]) { status = LIBORKH_ERROR_OUT_OF_MEMORY; break; }
+        count++;
+    }
+    closedir(dir);
+
+    // Group the files of each object
+    qsort(names, count, sizeof(char*), __compare_names);
+
+    size_t removed = 0;
+    char path[PATH_MAX];
+    for (size_t first = 0; first < count && status == LIBORKH_SUCCESS; ) {
+        size_t stem_len = __stem_length(names[first]);
+        size_t next = first + 1;
+        while (next < count && __stem_length(names[next]) == stem_len && strncmp(names[next], names[first], stem_len) == 0) next++;
+
+        snprintf(path, sizeof(path), "%s/%.*s.lock", dir_path, (int) stem_len, names[first]);
+        int fd = open(path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+        if (fd >= 0 && flock(fd, LOCK_EX | LOCK_NB) == 0) {
+            for (size_t i = first; i < next; i++) {
+                snprintf(path, sizeof(path), "%s/%s", dir_path, names[i]);
+                if (strcmp(names[i] + stem_len, ".lock") != 0 && unlink(path) == 0) removed++;
+            }
+            flock(fd, LOCK_UN);
+        }
+        if (fd >= 0) close(fd);
+        first = next;
+    }
+
+    for (size_t i = 0; i < count; i++) liborkh_free(names[i]);
+    liborkh_free(names);
+
+    if (num_removed) *num_removed = removed;
+    return status;
+}
+
+liborkh_status_t liborkh_shm_cache_get_path(const char* filename, char* path, size_t size) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !path || size == 0);
+    return __cache_path(filename, ".orkh", path, size);
+}
+
+/**
+ * Attach to a published object. Only objects owned by the caller and not
+ * writable by others are trusted, anything else is treated as a miss.
+ */
+static bool __try_attach(const char* path, liborkh_snapshot_t** snapshot) {
+    struct stat st;
+    if (lstat(path, &st) != 0) return false;
+
+    if (!S_ISREG(st.st_mode) || st.st_uid != geteuid() || (st.st_mode & (S_IWGRP | S_IWOTH))) {
+        liborkh_log_warn("Ignoring untrusted cache object %s\n", path);
+        return false;
+    }
+    return liborkh_snapshot_open(path, snapshot) == LIBORKH_SUCCESS;
+}
+
+// Objects are private to the user: other users can neither read the images nor replace the file
+static liborkh_status_t __publish(const char* filename, const char* path) {
+    liborkh_binary_t* binary = NULL;
+    LIBORKH_CHECK_CALL(liborkh_binary_open(filename, NULL, &binary), "Failed to decode %s\n", filename);
+
+    liborkh_status_t status = __liborkh_write_pool_to_snapshot(binary->pool, path, 0600);
+    liborkh_binary_close(binary);
+    if (status != LIBORKH_SUCCESS) return status;
+
+    // Objects of previous versions of the binary (same device and inode) can no longer be hit
+    const char* name = strrchr(path, '/') + 1;
+    size_t stem_len = __stem_length(name);
+    char prefix[NAME_MAX + 1], stem[NAME_MAX + 1];
+    snprintf(stem, sizeof(stem), "%.*s", (int) stem_len, name);
+    snprintf(prefix, sizeof(prefix), "%.*s", (int) (strrchr(stem, '-') - stem + 1), stem);
+
+    size_t num_removed = 0;
+    if (__remove_objects(prefix, stem, &num_removed) == LIBORKH_SUCCESS && num_removed > 0) {
+        liborkh_log_info("Removed %zu stale cache files of %s\n", num_removed, filename);
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_shm_cache_open(const char* filename, liborkh_snapshot_t** snapshot, bool* created) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !snapshot);
+
+    if (created) *created = false;
+
+    char path[PATH_MAX];
+    LIBORKH_CHECK_CALL(__cache_path(filename, ".orkh", path, sizeof(path)), "Cache path too long for %s\n", filename);
+
+    // Fast path: already published (the writer renames a complete snapshot in place)
+    if (__try_attach(path, snapshot)) return LIBORKH_SUCCESS;
+
+    char lock_path[PATH_MAX];
+    LIBORKH_CHECK_CALL(__cache_path(filename, ".lock", lock_path, sizeof(lock_path)), "Cache path too long for %s\n", filename);
+
+    // The lock file is never removed, unlinking it would let two processes hold different locks
+    int fd = open(lock_path, O_RDWR | O_CREAT | O_NOFOLLOW | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        liborkh_log_err("Failed to open lock file: %s\n", lock_path);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+    if (flock(fd, LOCK_EX) != 0) {
+        liborkh_log_err("Failed to lock %s\n", lock_path);
+        close(fd);
+        return LIBORKH_ERROR_IO;
+    }
+
+    // Another process may have published while we were waiting
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    if (!__try_attach(path, snapshot)) {
+        status = __publish(filename, path);
+        if (status == LIBORKH_SUCCESS) {
+            status = liborkh_snapshot_open(path, snapshot);
+            if (status == LIBORKH_SUCCESS && created) *created = true;
+        }
+    }
+
+    flock(fd, LOCK_UN);
+    close(fd);
+    return status;
+}
+
+liborkh_status_t liborkh_shm_cache_remove(const char* filename) {
+    LIBORKH_CHECK_ARGUMENTS(!filename);
+
+    char path[PATH_MAX];
+    LIBORKH_CHECK_CALL(__cache_path(filename, ".orkh", path, sizeof(path)), "Cache path too long for %s\n", filename);
+
+    // Processes attached keep their mapping, the memory is released with the last one
+    if (unlink(path) != 0 && errno != ENOENT) {
+        liborkh_log_err("Failed to remove %s\n", path);
+        return LIBORKH_ERROR_IO;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Remove every cache object of the calling user (all binaries), e.g. at the
+ * end of a job. Objects being published are skipped.
+ */
+liborkh_status_t liborkh_shm_cache_purge(size_t* num_removed) {
+    char prefix[64];
+    snprintf(prefix, sizeof(prefix), "liborkh-%u-", (unsigned) geteuid());
+    return __remove_objects(prefix, NULL, num_removed);
+}
@@ -0,0 +1,400 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "liborkh.h"
+#include "liborkh_snapshot.h"
+
+#define LIBORKH_SNAPSHOT_ENTRY_FLAGS (LIBORKH_ENTRY_COMPRESSED | LIBORKH_ENTRY_HASHED)
+
+static size_t __align_up(size_t value, size_t alignment) {
+    return (value + alignment - 1) / alignment * alignment;
+}
+
+bool liborkh_is_snapshot_file(const char* filename) {
+    if (!filename) return false;
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) return false;
+
+    char magic[LIBORKH_SNAPSHOT_MAGIC_SIZE];
+    bool is_snapshot = read(fd, magic, sizeof(magic)) == (ssize_t) sizeof(magic)
+                    && memcmp(magic, LIBORKH_SNAPSHOT_MAGIC, LIBORKH_SNAPSHOT_MAGIC_SIZE) == 0;
+    close(fd);
+    return is_snapshot;
+}
+
+
+typedef struct {
+    char* data;
+    size_t size;
+    size_t capacity;
+} __liborkh_string_table_t;
+
+static liborkh_status_t __string_table_add(__liborkh_string_table_t* table, const char* str, uint64_t* offset) {
+    if (!str) {
+        *offset = 0;
+        return LIBORKH_SUCCESS;
+    }
+
+    size_t len = strlen(str) + 1;
+    if (table->size + len > table->capacity) {
+        size_t new_capacity = table->capacity ? table->capacity * 2 : 4096;
+        while (new_capacity < table->size + len) new_capacity *= 2;
+        char* tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_IO, table->data, new_capacity);
+        LIBORKH_CHECK_ALLOC(tmp);
+        table->data = tmp;
+        table->capacity = new_capacity;
+    }
+
+    memcpy(table->data + table->size, str, len);
+    *offset = table->size;
+    table->size += len;
+    return LIBORKH_SUCCESS;
+}
+
+typedef struct {
+    const uint8_t* elf;
+    uint64_t offset;
+} __liborkh_stored_image_t;
+
+static __liborkh_stored_image_t* __find_stored_image(__liborkh_stored_image_t* table, size_t capacity, const uint8_t* elf) {
+    size_t i = ((uintptr_t) elf >> 4) % capacity;
+    while (table[i].elf && table[i].elf != elf) {
+        i = (i + 1) % capacity;
+    }
+    return &table[i];
+}
+
+/**
+ * Fill the entry table and string table, and assign a file offset to every image
+ * (shared images get the offset of their first occurrence).
+ * @param file_size Offset of the end of the file
+ */
+static liborkh_status_t __snapshot_layout(const liborkh_gpu_elf_pool_t* pool, size_t page_size, liborkh_snapshot_entry_t* records, __liborkh_string_table_t* strings, uint64_t* file_size) {
+    size_t capacity = pool->count * 2 + 1;
+    __liborkh_stored_image_t* stored = liborkh_calloc(LIBORKH_ALLOC_STAGE_IO, capacity, sizeof(__liborkh_stored_image_t));
+    LIBORKH_CHECK_ALLOC(stored);
+
+    // Offset 0 encodes NULL strings
+    uint64_t unused = 0;
+    liborkh_status_t status = __string_table_add(strings, "", &unused);
+
+    for (size_t i = 0; i < pool->count && status == LIBORKH_SUCCESS; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        liborkh_snapshot_entry_t* record = &records[i];
+
+        memset(record, 0, sizeof(*record));
+        record->id            = entry->id;
+        record->img           = (uint32_t) entry->img;
+        record->ofk           = (uint32_t) entry->ofk;
+        record->flags         = entry->flags & LIBORKH_SNAPSHOT_ENTRY_FLAGS;
+        record->member_offset = entry->member_offset;
+        record->bundle_offset = entry->bundle_offset;
+        record->image_offset  = entry->image_offset;
+        record->elf_size      = entry->elf_size;
+
+        if (entry->elf) {
+            liborkh_hash128_t hash = (entry->flags & LIBORKH_ENTRY_HASHED) ? entry->hash : liborkh_hash128(entry->elf, entry->elf_size, 0);
+            record->hash_lo = hash.lo;
+            record->hash_hi = hash.hi;
+            record->flags  |= LIBORKH_ENTRY_HASHED;
+        }
+
+        status = __string_table_add(strings, entry->target_triple, &record->target_triple);
+        if (status == LIBORKH_SUCCESS) status = __string_table_add(strings, entry->target_arch, &record->target_arch);
+        if (status == LIBORKH_SUCCESS) status = __string_table_add(strings, entry->member_name, &record->member_name);
+    }
+
+    uint64_t offset = sizeof(liborkh_snapshot_header_t) + pool->count * sizeof(liborkh_snapshot_entry_t) + strings->size;
+    for (size_t i = 0; i < pool->count && status == LIBORKH_SUCCESS; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        if (!entry->elf || entry->elf_size == 0) continue;
+
+        __liborkh_stored_image_t* slot = NULL;
+        if (entry->flags & LIBORKH_ENTRY_SHARED_ELF) {
+            slot = __find_stored_image(stored, capacity, entry->elf);
+            if (slot->elf) {
+                records[i].elf_offset = slot->offset;
+                continue;
+            }
+        }
+
+        offset = __align_up(offset, page_size);
+        records[i].elf_offset = offset;
+        offset += entry->elf_size;
+
+        if (slot) {
+            slot->elf    = entry->elf;
+            slot->offset = records[i].elf_offset;
+        }
+    }
+
+    liborkh_free(stored);
+    *file_size = offset;
+    return status;
+}
+
+static liborkh_status_t __pwrite_all(int fd, const void* data, size_t size, uint64_t offset) {
+    const uint8_t* p = (const uint8_t*) data;
+    while (size > 0) {
+        ssize_t n = pwrite(fd, p, size, (off_t) offset);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            liborkh_log_err("Failed to write data to file\n");
+            return LIBORKH_ERROR_WRITE_FILE;
+        }
+        p += n;
+        size -= (size_t) n;
+        offset += (uint64_t) n;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __snapshot_write(int fd, const liborkh_gpu_elf_pool_t* pool, const liborkh_snapshot_header_t* header, const liborkh_snapshot_entry_t* records, const __liborkh_string_table_t* strings) {
+    LIBORKH_CHECK_CALL(__pwrite_all(fd, header, sizeof(*header), 0), "Failed to write snapshot header\n");
+    LIBORKH_CHECK_CALL(__pwrite_all(fd, records, pool->count * sizeof(liborkh_snapshot_entry_t), header->entry_table_offset), "Failed to write snapshot entries\n");
+    LIBORKH_CHECK_CALL(__pwrite_all(fd, strings->data, strings->size, header->string_table_offset), "Failed to write snapshot strings\n");
+
+    // Padding between images is left as holes
+    if (ftruncate(fd, (off_t) header->file_size) != 0) {
+        liborkh_log_err("Failed to resize snapshot file\n");
+        return LIBORKH_ERROR_WRITE_FILE;
+    }
+
+    uint64_t last_offset = 0;
+    for (size_t i = 0; i < pool->count; i++) {
+        const liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        if (records[i].elf_offset == 0 || records[i].elf_offset <= last_offset) continue; // no image, or shared image already written
+
+        LIBORKH_CHECK_CALL(__pwrite_all(fd, entry->elf, entry->elf_size, records[i].elf_offset), "Failed to write snapshot image\n");
+        last_offset = records[i].elf_offset;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_write_pool_to_snapshot(const liborkh_gpu_elf_pool_t* pool, const char* filename) {
+    return __liborkh_write_pool_to_snapshot(pool, filename, 0644);
+}
+
+/**
+ * Write the pool to a single snapshot file. The file is written next to its
+ * destination and renamed once complete, readers never see a partial snapshot.
+ * @param mode Permissions of the created file (before umask)
+ */
+liborkh_status_t __liborkh_write_pool_to_snapshot(const liborkh_gpu_elf_pool_t* pool, const char* filename, mode_t mode) {
+    LIBORKH_CHECK_ARGUMENTS(!pool || !filename);
+
+    long page_size = sysconf(_SC_PAGESIZE);
+    if (page_size <= 0) page_size = 4096;
+
+    liborkh_snapshot_entry_t* records = liborkh_malloc(LIBORKH_ALLOC_STAGE_IO, (pool->count + 1) * sizeof(liborkh_snapshot_entry_t));
+    LIBORKH_CHECK_ALLOC(records);
+
+    __liborkh_string_table_t strings = {0};
+    uint64_t file_size = 0;
+    liborkh_status_t status = __snapshot_layout(pool, (size_t) page_size, records, &strings, &file_size);
+
+    liborkh_snapshot_header_t header;
+    memset(&header, 0, sizeof(header));
+    memcpy(header.magic, LIBORKH_SNAPSHOT_MAGIC, LIBORKH_SNAPSHOT_MAGIC_SIZE);
+    header.version             = LIBORKH_SNAPSHOT_VERSION;
+    header.page_size           = (uint32_t) page_size;
+    header.num_entries         = pool->count;
+    header.entry_table_offset  = sizeof(liborkh_snapshot_header_t);
+    header.string_table_offset = header.entry_table_offset + pool->count * sizeof(liborkh_snapshot_entry_t);
+    header.string_table_size   = strings.size;
+    header.file_size           = file_size;
+
+    char tmp_filename[4096];
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp.%d", filename, (int) getpid());
+
+    int fd = -1;
+    if (status == LIBORKH_SUCCESS) {
+        fd = __liborkh_open_temp_file(tmp_filename, mode);
+        if (fd < 0) {
+            liborkh_log_err("Failed to open file: %s\n", tmp_filename);
+            status = LIBORKH_ERROR_OPEN_FILE;
+        }
+    }
+
+    if (status == LIBORKH_SUCCESS) {
+        status = __snapshot_write(fd, pool, &header, records, &strings);
+    }
+    if (fd >= 0 && close(fd) != 0 && status == LIBORKH_SUCCESS) {
+        liborkh_log_err("Failed to write data to file\n");
+        status = LIBORKH_ERROR_WRITE_FILE;
+    }
+    if (status == LIBORKH_SUCCESS && rename(tmp_filename, filename) != 0) {
+        liborkh_log_err("Failed to rename %s to %s\n", tmp_filename, filename);
+        status = LIBORKH_ERROR_WRITE_FILE;
+    }
+    if (fd >= 0 && status != LIBORKH_SUCCESS) {
+        unlink(tmp_filename);
+    }
+
+    if (status == LIBORKH_SUCCESS) {
+        liborkh_log_info("Wrote snapshot to file: %s (%zu entries, %lu bytes)\n", filename, pool->count, (unsigned long) file_size);
+    }
+
+    liborkh_free(strings.data);
+    liborkh_free(records);
+    return status;
+}
+
+
+static liborkh_status_t __snapshot_string(const liborkh_snapshot_t* snapshot, const liborkh_snapshot_header_t* header, uint64_t offset, char** out, size_t* out_size) {
+    *out = NULL;
+    if (out_size) *out_size = 0;
+    if (offset == 0) return LIBORKH_SUCCESS;
+
+    if (offset >= header->string_table_size) return LIBORKH_ERROR_OUT_OF_BOUNDS;
+
+    char* str = (char*) snapshot->map + header->string_table_offset + offset;
+    size_t len = strnlen(str, header->string_table_size - offset);
+    if (len == header->string_table_size - offset) return LIBORKH_ERROR_OUT_OF_BOUNDS; // not NUL terminated
+
+    *out = str;
+    if (out_size) *out_size = len;
+    return LIBORKH_SUCCESS;
+}
+
+static bool __is_valid_image_kind(uint32_t img) {
+    return img <= IMG_PTX;
+}
+
+static bool __is_valid_offload_kind(uint32_t ofk) {
+    return ofk <= OFK_HIP || ofk == OFK_HOST || ofk == OFK_HIPV4;
+}
+
+static liborkh_status_t __snapshot_load_entry(liborkh_snapshot_t* snapshot, const liborkh_snapshot_header_t* header, const liborkh_snapshot_entry_t* record, liborkh_gpu_elf_entry_t** out) {
+    if (record->elf_offset != 0) {
+        LIBORKH_CHECK_CALL(check_bounds(record->elf_offset, record->elf_size, snapshot->size), "Snapshot image out of bounds\n");
+    }
+    if (!__is_valid_image_kind(record->img) || !__is_valid_offload_kind(record->ofk)) {
+        liborkh_log_err("Invalid image kind %u or offload kind %u in snapshot\n", record->img, record->ofk);
+        return LIBORKH_ERROR_INVALID_ARGUMENT;
+    }
+
+    liborkh_gpu_elf_entry_t* entry = NULL;
+    LIBORKH_CHECK_CALL(liborkh_new_entry(&entry), "Failed to create new entry\n");
+
+    entry->id            = record->id;
+    entry->img           = (image_kind_t) record->img;
+    entry->ofk           = (offload_kind_t) record->ofk;
+    entry->flags         = (record->flags & LIBORKH_SNAPSHOT_ENTRY_FLAGS) | LIBORKH_ENTRY_BORROWED_STRINGS;
+    entry->member_offset = record->member_offset;
+    entry->bundle_offset = record->bundle_offset;
+    entry->image_offset  = record->image_offset;
+    entry->elf_size      = record->elf_size;
+    entry->hash.lo       = record->hash_lo;
+    entry->hash.hi       = record->hash_hi;
+
+    if (record->elf_offset != 0) {
+        entry->elf = snapshot->map + record->elf_offset;
+        entry->flags |= LIBORKH_ENTRY_BORROWED_ELF;
+    }
+
+    liborkh_status_t status = __snapshot_string(snapshot, header, record->target_triple, &entry->target_triple, &entry->target_triple_size);
+    if (status == LIBORKH_SUCCESS) status = __snapshot_string(snapshot, header, record->target_arch, &entry->target_arch, &entry->target_arch_size);
+    if (status == LIBORKH_SUCCESS) status = __snapshot_string(snapshot, header, record->member_name, &entry->member_name, NULL);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_log_err("Snapshot string out of bounds\n");
+        liborkh_free_entry(entry);
+        return status;
+    }
+
+    *out = entry;
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __snapshot_load(liborkh_snapshot_t* snapshot) {
+    const liborkh_snapshot_header_t* header = (const liborkh_snapshot_header_t*) snapshot->map;
+
+    if (header->version != LIBORKH_SNAPSHOT_VERSION) {
+        liborkh_log_err("Unsupported snapshot version %u\n", header->version);
+        return LIBORKH_ERROR_IO;
+    }
+    // num_entries is bounded first so that the entry table size cannot overflow
+    if (header->file_size != snapshot->size
+            || header->num_entries > snapshot->size / sizeof(liborkh_snapshot_entry_t)
+            || check_bounds(header->entry_table_offset, header->num_entries * sizeof(liborkh_snapshot_entry_t), snapshot->size) != LIBORKH_SUCCESS
+            || check_bounds(header->string_table_offset, header->string_table_size, snapshot->size) != LIBORKH_SUCCESS
+            || header->entry_table_offset % sizeof(uint64_t) != 0) {
+        liborkh_log_err("Truncated or corrupted snapshot\n");
+        return LIBORKH_ERROR_OUT_OF_BOUNDS;
+    }
+
+    LIBORKH_CHECK_CALL(liborkh_gpu_elf_pool_init(&snapshot->pool, header->num_entries ? header->num_entries : 1), "Failed to initialize pool\n");
+
+    const liborkh_snapshot_entry_t* records = (const liborkh_snapshot_entry_t*) (snapshot->map + header->entry_table_offset);
+    for (uint64_t i = 0; i < header->num_entries; i++) {
+        liborkh_gpu_elf_entry_t* entry = NULL;
+        LIBORKH_CHECK_CALL(__snapshot_load_entry(snapshot, header, &records[i], &entry), "Invalid snapshot entry %lu\n", (unsigned long) i);
+
+        liborkh_status_t status = liborkh_gpu_elf_pool_push(snapshot->pool, entry);
+        if (status != LIBORKH_SUCCESS) {
+            liborkh_free_entry(entry);
+            return status;
+        }
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_snapshot_open(const char* filename, liborkh_snapshot_t** snapshot) {
+    LIBORKH_CHECK_ARGUMENTS(!filename || !snapshot);
+
+    int fd = open(filename, O_RDONLY);
+    if (fd < 0) {
+        liborkh_log_err("Failed to open file: %s\n", filename);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(liborkh_snapshot_header_t)) {
+        liborkh_log_err("Not a snapshot: %s\n", filename);
+        close(fd);
+        return LIBORKH_ERROR_IO;
+    }
+
+    uint8_t* map = mmap(NULL, st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        liborkh_log_err("Failed to map file: %s\n", filename);
+        return LIBORKH_ERROR_IO;
+    }
+
+    if (memcmp(map, LIBORKH_SNAPSHOT_MAGIC, LIBORKH_SNAPSHOT_MAGIC_SIZE) != 0) {
+        liborkh_log_err("Not a snapshot: %s\n", filename);
+        munmap(map, st.st_size);
+        return LIBORKH_ERROR_IO;
+    }
+
+    *snapshot = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_snapshot_t));
+    if (!*snapshot) munmap(map, st.st_size);
+    LIBORKH_CHECK_ALLOC(*snapshot);
+
+    (*snapshot)->map  = map;
+    (*snapshot)->size = st.st_size;
+
+    liborkh_status_t status = __snapshot_load(*snapshot);
+    if (status != LIBORKH_SUCCESS) {
+        liborkh_snapshot_close(*snapshot);
+        *snapshot = NULL;
+    }
+    return status;
+}
+
+liborkh_status_t liborkh_snapshot_close(liborkh_snapshot_t* snapshot) {
+    LIBORKH_CHECK_ARGUMENTS(!snapshot);
+
+    if (snapshot->pool) liborkh_gpu_elf_pool_free(snapshot->pool);
+    if (snapshot->map) munmap(snapshot->map, snapshot->size);
+    liborkh_free(snapshot);
+    return LIBORKH_SUCCESS;
+}
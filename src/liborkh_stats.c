@@ -0,0 +1,79 @@
+#include <stdio.h>
+#include <string.h>
+
+#include "liborkh_stats.h"
+
+static __thread liborkh_stats_t  __thread_stats;
+static __thread liborkh_stats_t* __bound_stats = NULL;
+
+liborkh_stats_t* __liborkh_stats(void) {
+    return __bound_stats ? __bound_stats : &__thread_stats;
+}
+
+void liborkh_stats_bind(liborkh_stats_t* ctx) {
+    __bound_stats = ctx;
+}
+
+void liborkh_stats_get(liborkh_stats_t* out) {
+    if (!out) return;
+
+    const uint64_t* src = (const uint64_t*) __liborkh_stats();
+    uint64_t* dst = (uint64_t*) out;
+    for (size_t i = 0; i < sizeof(liborkh_stats_t) / sizeof(uint64_t); i++) {
+        dst[i] = __atomic_load_n(&src[i], __ATOMIC_RELAXED);
+    }
+}
+
+void liborkh_stats_reset(void) {
+    uint64_t* fields = (uint64_t*) __liborkh_stats();
+    for (size_t i = 0; i < sizeof(liborkh_stats_t) / sizeof(uint64_t); i++) {
+        __atomic_store_n(&fields[i], 0, __ATOMIC_RELAXED);
+    }
+}
+
+void liborkh_stats_merge(liborkh_stats_t* dst, const liborkh_stats_t* src) {
+    if (!dst || !src) return;
+
+    // liborkh_stats_t is only made of uint64_t counters
+    uint64_t* d = (uint64_t*) dst;
+    const uint64_t* s = (const uint64_t*) src;
+    for (size_t i = 0; i < sizeof(liborkh_stats_t) / sizeof(uint64_t); i++) {
+        __liborkh_stats_add(d[i], __atomic_load_n(&s[i], __ATOMIC_RELAXED));
+    }
+}
+
+const char* liborkh_compression_to_string(liborkh_ccob_compression_t codec) {
+    switch (codec) {
+        case CCOB_COMPRESSION_ZLIB: return "zlib";
+        case CCOB_COMPRESSION_ZSTD: return "zstd";
+        default:                    return "unknown";
+    }
+}
+
+static void __print_counter(FILE* out, const char* name, const liborkh_stats_counter_t* c) {
+    fprintf(out, "  %-20s %12lu %14lu %14.3f ms\n", name,
+            (unsigned long) c->count, (unsigned long) c->bytes, (double) c->ns / 1e6);
+}
+
+void liborkh_stats_print(FILE* out, const liborkh_stats_t* stats) {
+    out = out ? out : stderr;
+    if (!stats) return;
+
+    fprintf(out, "  %-20s %12s %14s %17s\n", "stage", "count", "bytes", "time");
+    __print_counter(out, "offload_read",     &stats->offload_read);
+    __print_counter(out, "magic_scan",       &stats->magic_scan);
+    __print_counter(out, "bundles",          &stats->bundles);
+    __print_counter(out, "blobs",            &stats->blobs);
+    for (int i = 0; i < CCOB_COMPRESSION_COUNT; i++) {
+        char name[32];
+        snprintf(name, sizeof(name), "decompress_%s", liborkh_compression_to_string((liborkh_ccob_compression_t) i));
+        __print_counter(out, name, &stats->decompress[i]);
+    }
+    __print_counter(out, "entries_decoded",  &stats->entries_decoded);
+    __print_counter(out, "entries_rejected", &stats->entries_rejected);
+    __print_counter(out, "images_copied",    &stats->images_copied);
+    __print_counter(out, "gpu_elfs_opened",  &stats->gpu_elfs_opened);
+    __print_counter(out, "kernels_counted",  &stats->kernels_counted);
+    __print_counter(out, "spilled",          &stats->spilled);
+    __print_counter(out, "budget_waits",     &stats->budget_waits);
+}
@@ -0,0 +1,255 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#include "liborkh.h"
+#include "liborkh_strip.h"
+#include "liborkh_compress.h"
+
+#define LIBORKH_STRIP_BLOCK_SIZE 4096
+#define LIBORKH_STRIP_COPY_SIZE  (1 << 20)
+
+// Offload section of a host ELF, with its index and header
+static liborkh_status_t __find_offload_section(Elf* elf, Elf_Scn** out_scn, GElf_Shdr* out_shdr, liborkh_offload_encoding_kind* kind) {
+    size_t shstrndx = 0;
+    if (elf_getshdrstrndx(elf, &shstrndx) != 0) {
+        liborkh_log_err("elf_getshdrstrndx() failed: %s\n", elf_errmsg(-1));
+        return LIBORKH_ERROR_ELF;
+    }
+
+    Elf_Scn* scn = NULL;
+    while ((scn = elf_nextscn(elf, scn)) != NULL) {
+        if (gelf_getshdr(scn, out_shdr) != out_shdr) return LIBORKH_ERROR_ELF;
+
+        const char* name = elf_strptr(elf, shstrndx, out_shdr->sh_name);
+        if (!name) return LIBORKH_ERROR_ELF;
+
+        if (strcmp(name, LIBORKH_HIP_FATBIN_SECTION_NAME) == 0) {
+            *kind = CLANG_OFFLOAD_BUNDLER_KIND;
+        } else if (strcmp(name, LIBORKH_LLVM_OFFLOADING_FATBIN_SECTION_NAME) == 0) {
+            *kind = CLANG_OFFLOAD_PACKAGER_KIND;
+        } else {
+            continue;
+        }
+        *out_scn = scn;
+        return out_shdr->sh_type == SHT_NOBITS ? LIBORKH_ERROR_SECTION_NOT_FOUND : LIBORKH_SUCCESS;
+    }
+    return LIBORKH_ERROR_SECTION_NOT_FOUND;
+}
+
+static liborkh_status_t __pwrite_all(int fd, const uint8_t* data, size_t size, off_t offset) {
+    while (size > 0) {
+        ssize_t written = pwrite(fd, data, size, offset);
+        if (written < 0 && errno == EINTR) continue;
+        if (written <= 0) return LIBORKH_ERROR_WRITE_FILE;
+        data += written;
+        size -= (size_t) written;
+        offset += written;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_status_t __copy_file(int in_fd, int out_fd, size_t size) {
+    size_t copied = 0;
+    while (copied < size) {
+        ssize_t n = copy_file_range(in_fd, NULL, out_fd, NULL, size - copied, 0);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) break;
+        copied += (size_t) n;
+    }
+    if (copied == size) return LIBORKH_SUCCESS;
+
+    // copy_file_range is not supported across every pair of file systems
+    uint8_t* buf = liborkh_malloc(LIBORKH_ALLOC_STAGE_IO, LIBORKH_STRIP_COPY_SIZE);
+    LIBORKH_CHECK_ALLOC(buf);
+
+    liborkh_status_t status = LIBORKH_SUCCESS;
+    while (copied < size && status == LIBORKH_SUCCESS) {
+        ssize_t n = pread(in_fd, buf, LIBORKH_STRIP_COPY_SIZE, (off_t) copied);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            status = LIBORKH_ERROR_IO;
+            break;
+        }
+        status = __pwrite_all(out_fd, buf, (size_t) n, (off_t) copied);
+        copied += (size_t) n;
+    }
+    liborkh_free(buf);
+    return status;
+}
+
+static bool __is_zero(const uint8_t* buf, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+        if (buf[i]) return false;
+    }
+    return true;
+}
+
+/**
+ * Write the new section content over the copy of the input. Blocks that
+ * became empty are punched out of the file, other blocks are written only
+ * when they changed.
+ */
+static liborkh_status_t __write_section(int fd, size_t offset, const uint8_t* old_data, const uint8_t* new_data, size_t size) {
+    size_t pos = 0;
+    while (pos < size) {
+        size_t file_pos = offset + pos;
+        size_t block_end = (file_pos / LIBORKH_STRIP_BLOCK_SIZE + 1) * LIBORKH_STRIP_BLOCK_SIZE;
+        size_t len = block_end - file_pos < size - pos ? block_end - file_pos : size - pos;
+
+        if (memcmp(old_data + pos, new_data + pos, len) != 0) {
+            bool punched = false;
+            if (len == LIBORKH_STRIP_BLOCK_SIZE && __is_zero(new_data + pos, len)) {
+                punched = fallocate(fd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE, (off_t) file_pos, (off_t) len) == 0;
+            }
+            if (!punched) {
+                LIBORKH_CHECK_CALL(__pwrite_all(fd, new_data + pos, len, (off_t) file_pos), "Failed to write section data\n");
+            }
+        }
+        pos += len;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+// Patch sh_size in the section header table of the output
+static liborkh_status_t __write_section_size(int fd, Elf* elf, Elf_Scn* scn, uint64_t size) {
+    GElf_Ehdr ehdr;
+    if (gelf_getehdr(elf, &ehdr) != &ehdr) return LIBORKH_ERROR_ELF;
+
+    uint16_t probe = 1;
+    int host_data = *(uint8_t*) &probe ? ELFDATA2LSB : ELFDATA2MSB;
+    if (ehdr.e_ident[EI_DATA] != host_data) {
+        liborkh_log_warn("Foreign byte order, section size left unchanged\n");
+        return LIBORKH_SUCCESS;
+    }
+
+    off_t offset = (off_t) (ehdr.e_shoff + elf_ndxscn(scn) * ehdr.e_shentsize);
+    if (ehdr.e_ident[EI_CLASS] == ELFCLASS64) {
+        return __pwrite_all(fd, (const uint8_t*) &size, sizeof(uint64_t), offset + offsetof(Elf64_Shdr, sh_size));
+    }
+    uint32_t size32 = (uint32_t) size;
+    return __pwrite_all(fd, (const uint8_t*) &size32, sizeof(uint32_t), offset + offsetof(Elf32_Shdr, sh_size));
+}
+
+/*
+ * Compute the new content of the offload section into `out` (same size as
+ * the section) and return the last used byte in `new_size`.
+ */
+typedef liborkh_status_t (*__rewrite_section_cb_t)(const uint8_t* buf, size_t size, liborkh_offload_encoding_kind kind, uint8_t* out, size_t* new_size, void* user_data);
+
+static liborkh_status_t __rewrite_to_fd(Elf* elf, int in_fd, int out_fd, size_t file_size, __rewrite_section_cb_t func, void* user_data) {
+    Elf_Scn* scn = NULL;
+    GElf_Shdr shdr;
+    liborkh_offload_encoding_kind kind = UNKNOWN_KIND;
+    LIBORKH_CHECK_CALL(__find_offload_section(elf, &scn, &shdr, &kind), "No offload section to rewrite\n");
+    LIBORKH_CHECK_CALL(check_bounds(shdr.sh_offset, shdr.sh_size, file_size), "Offload section out of bounds\n");
+
+    Elf_Data* data = elf_getdata(scn, NULL);
+    if (!data || data->d_size != shdr.sh_size || shdr.sh_size == 0) return LIBORKH_ERROR_ELF;
+
+    uint8_t* out = liborkh_malloc(LIBORKH_ALLOC_STAGE_SECTION, shdr.sh_size);
+    LIBORKH_CHECK_ALLOC(out);
+
+    size_t new_size = shdr.sh_size;
+    liborkh_status_t status = func(data->d_buf, data->d_size, kind, out, &new_size, user_data);
+
+    if (status == LIBORKH_SUCCESS) status = __copy_file(in_fd, out_fd, file_size);
+    if (status == LIBORKH_SUCCESS) status = __write_section(out_fd, shdr.sh_offset, data->d_buf, out, shdr.sh_size);
+    if (status == LIBORKH_SUCCESS && new_size < shdr.sh_size) status = __write_section_size(out_fd, elf, scn, new_size);
+
+    liborkh_free(out);
+    return status;
+}
+
+static liborkh_status_t __rewrite_gpu_elfs(const char* input, const char* output, __rewrite_section_cb_t func, void* user_data) {
+    LIBORKH_CHECK_ARGUMENTS(!input || !output);
+
+    int in_fd = open(input, O_RDONLY | O_CLOEXEC);
+    if (in_fd < 0) {
+        liborkh_log_err("Failed to open file: %s\n", input);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    struct stat st;
+    Elf* elf = NULL;
+    liborkh_status_t status = fstat(in_fd, &st) == 0 ? LIBORKH_SUCCESS : LIBORKH_ERROR_IO;
+    if (status == LIBORKH_SUCCESS) status = liborkh_open_elf(input, &elf);
+    if (status != LIBORKH_SUCCESS) {
+        close(in_fd);
+        return status;
+    }
+
+    char tmp_filename[4096];
+    snprintf(tmp_filename, sizeof(tmp_filename), "%s.tmp.%d", output, (int) getpid());
+    int out_fd = __liborkh_open_temp_file(tmp_filename, st.st_mode & 07777);
+    if (out_fd < 0) {
+        liborkh_log_err("Failed to open file: %s\n", tmp_filename);
+        status = LIBORKH_ERROR_OPEN_FILE;
+    } else {
+        status = __rewrite_to_fd(elf, in_fd, out_fd, (size_t) st.st_size, func, user_data);
+        if (close(out_fd) != 0 && status == LIBORKH_SUCCESS) status = LIBORKH_ERROR_WRITE_FILE;
+
+        if (status == LIBORKH_SUCCESS && rename(tmp_filename, output) != 0) {
+            liborkh_log_err("Failed to rename %s to %s\n", tmp_filename, output);
+            status = LIBORKH_ERROR_WRITE_FILE;
+        }
+        if (status != LIBORKH_SUCCESS) unlink(tmp_filename);
+    }
+
+    liborkh_close_elf(elf);
+    close(in_fd);
+    return status;
+}
+
+typedef struct {
+    liborkh_entry_filter_t* filter;
+    liborkh_strip_result_t* result;
+} __strip_ctx_t;
+
+static liborkh_status_t __strip_section(const uint8_t* buf, size_t size, liborkh_offload_encoding_kind kind, uint8_t* out, size_t* new_size, void* user_data) {
+    __strip_ctx_t* ctx = (__strip_ctx_t*) user_data;
+    liborkh_status_t status = kind == CLANG_OFFLOAD_BUNDLER_KIND
+        ? liborkh_strip_clang_offload_bundler(buf, size, ctx->filter, out, ctx->result)
+        : liborkh_strip_clang_offload_packager(buf, size, ctx->filter, out, ctx->result);
+    *new_size = ctx->result->new_size;
+    return status;
+}
+
+liborkh_status_t liborkh_strip_gpu_elfs(const char* input, const char* output, liborkh_entry_filter_t* filter, liborkh_strip_result_t* result) {
+    liborkh_strip_result_t local_result;
+    __strip_ctx_t ctx = { .filter = filter, .result = result ? result : &local_result };
+    return __rewrite_gpu_elfs(input, output, __strip_section, &ctx);
+}
+
+typedef struct {
+    const liborkh_ccob_options_t* options;
+    liborkh_transcode_result_t* result;
+} __transcode_ctx_t;
+
+static liborkh_status_t __transcode_section(const uint8_t* buf, size_t size, liborkh_offload_encoding_kind kind, uint8_t* out, size_t* new_size, void* user_data) {
+    __transcode_ctx_t* ctx = (__transcode_ctx_t*) user_data;
+    if (kind != CLANG_OFFLOAD_BUNDLER_KIND) {
+        liborkh_log_err("Only %s sections hold compressed bundles\n", LIBORKH_HIP_FATBIN_SECTION_NAME);
+        return LIBORKH_ERROR_SECTION_NOT_FOUND;
+    }
+    LIBORKH_CHECK_CALL(liborkh_transcode_clang_offload_bundler(buf, size, ctx->options, out, ctx->result), "Failed to transcode bundles\n");
+    if (ctx->result->num_kept > 0) {
+        liborkh_log_err("%zu compressed bundles do not fit in place once recompressed, nothing is written\n", ctx->result->num_kept);
+        return LIBORKH_ERROR_OUT_OF_BOUNDS;
+    }
+    *new_size = ctx->result->new_size;
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_transcode_gpu_elfs(const char* input, const char* output, const liborkh_ccob_options_t* options, liborkh_transcode_result_t* result) {
+    LIBORKH_CHECK_ARGUMENTS(!options);
+
+    liborkh_transcode_result_t local_result;
+    __transcode_ctx_t ctx = { .options = options, .result = result ? result : &local_result };
+    return __rewrite_gpu_elfs(input, output, __transcode_section, &ctx);
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "liborkh.h"
+#include "liborkh_target_id.h"
+
+static const char* __feature_names[LIBORKH_TARGET_FEATURE_COUNT] = {
+    [LIBORKH_TARGET_FEATURE_SRAMECC] = "sramecc",
+    [LIBORKH_TARGET_FEATURE_XNACK]   = "xnack",
+};
+
+const char* liborkh_target_feature_to_string(liborkh_target_feature_t feature) {
+    return feature < LIBORKH_TARGET_FEATURE_COUNT ? __feature_names[feature] : "unknown";
+}
+
+liborkh_status_t liborkh_target_id_parse(const char* str, liborkh_target_id_t* out) {
+    LIBORKH_CHECK_ARGUMENTS(!str || !out);
+
+    memset(out, 0, sizeof(*out));
+
+    size_t processor_len = strcspn(str, ":");
+    if (processor_len == 0 || processor_len >= LIBORKH_TARGET_ID_PROCESSOR_SIZE) {
+        return LIBORKH_ERROR_INVALID_ARGUMENT;
+    }
+    memcpy(out->processor, str, processor_len);
+
+    for (const char* p = str + processor_len; *p == ':';) {
+        p++;
+        size_t len = strcspn(p, ":");
+        if (len < 2 || (p[len - 1] != '+' && p[len - 1] != '-')) return LIBORKH_ERROR_INVALID_ARGUMENT;
+
+        int feature = -1;
+        for (int i = 0; i < LIBORKH_TARGET_FEATURE_COUNT; i++) {
+            if (strlen(__feature_names[i]) == len - 1 && strncmp(p, __feature_names[i], len - 1) == 0) {
+                feature = i;
+                break;
+            }
+        }
+
+        uint32_t bit = feature >= 0 ? 1u << feature : 0;
+        if (!bit || ((out->on | out->off) & bit)) return LIBORKH_ERROR_INVALID_ARGUMENT; // unknown or repeated feature
+
+        if (p[len - 1] == '+') out->on |= bit;
+        else                   out->off |= bit;
+        p += len;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_target_id_to_string(const liborkh_target_id_t* id, char* buf, size_t size) {
+    LIBORKH_CHECK_ARGUMENTS(!id || !buf || size == 0);
+
+    size_t pos = (size_t) snprintf(buf, size, "%s", id->processor);
+    for (int i = 0; i < LIBORKH_TARGET_FEATURE_COUNT && pos < size; i++) {
+        uint32_t bit = 1u << i;
+        if (!((id->on | id->off) & bit)) continue;
+        pos += (size_t) snprintf(buf + pos, size - pos, ":%s%c", __feature_names[i], (id->on & bit) ? '+' : '-');
+    }
+    return pos < size ? LIBORKH_SUCCESS : LIBORKH_ERROR_OUT_OF_BOUNDS;
+}
+
+bool liborkh_target_id_is_compatible(const liborkh_target_id_t* code_object, const liborkh_target_id_t* device) {
+    if (!code_object || !device) return false;
+    if (strcmp(code_object->processor, device->processor) != 0) return false;
+
+    // Features set by the code object must be set to the same value by the device
+    return (code_object->on & ~device->on) == 0 && (code_object->off & ~device->off) == 0;
+}
+
+
+static int __item_compare(const void* a, const void* b) {
+    const liborkh_target_table_item_t* x = (const liborkh_target_table_item_t*) a;
+    const liborkh_target_table_item_t* y = (const liborkh_target_table_item_t*) b;
+
+    int cmp = strcmp(x->id.processor, y->id.processor);
+    if (cmp != 0) return cmp;
+    if (x->num_features != y->num_features) return x->num_features > y->num_features ? -1 : 1;
+    return x->index < y->index ? -1 : (x->index > y->index);
+}
+
+/**
+ * Parse the target ID of every device code object of the pool once.
+ * @param target_triple Only keep entries of this triple, NULL to keep all of them
+ */
+liborkh_status_t liborkh_target_table_build(const liborkh_gpu_elf_pool_t* pool, const char* target_triple, liborkh_target_table_t** table) {
+    LIBORKH_CHECK_ARGUMENTS(!pool || !table);
+
+    *table = liborkh_calloc(LIBORKH_ALLOC_STAGE_POOL, 1, sizeof(liborkh_target_table_t));
+    LIBORKH_CHECK_ALLOC(*table);
+
+    (*table)->items = liborkh_malloc(LIBORKH_ALLOC_STAGE_POOL, (pool->count + 1) * sizeof(liborkh_target_table_item_t));
+    if (!(*table)->items) {
+        liborkh_free(*table);
+        *table = NULL;
+    }
+    LIBORKH_CHECK_ALLOC(*table);
+
+    for (size_t i = 0; i < pool->count; i++) {
+        liborkh_gpu_elf_entry_t* entry = pool->entries[i];
+        if (!entry->target_arch || entry->ofk == OFK_HOST) continue;
+        if (target_triple && (!entry->target_triple || strcmp(entry->target_triple, target_triple) != 0)) continue;
+
+        liborkh_target_table_item_t* item = &(*table)->items[(*table)->count];
+        if (liborkh_target_id_parse(entry->target_arch, &item->id) != LIBORKH_SUCCESS) {
+            liborkh_log_warn("Ignoring entry %zu with invalid target ID %s\n", entry->id, entry->target_arch);
+            continue;
+        }
+        item->num_features = (uint32_t) __builtin_popcount(item->id.on | item->id.off);
+        item->entry = entry;
+        item->index = i;
+        (*table)->count++;
+    }
+
+    qsort((*table)->items, (*table)->count, sizeof(liborkh_target_table_item_t), __item_compare);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_target_table_free(liborkh_target_table_t* table) {
+    LIBORKH_CHECK_ARGUMENTS(!table);
+
+    liborkh_free(table->items);
+    liborkh_free(table);
+    return LIBORKH_SUCCESS;
+}
+
+static liborkh_gpu_elf_entry_t* __lookup(const liborkh_target_table_t* table, const liborkh_target_id_t* device) {
+    // First item of the processor
+    size_t lo = 0, hi = table->count;
+    while (lo < hi) {
+        size_t mid = lo + (hi - lo) / 2;
+        if (strcmp(table->items[mid].id.processor, device->processor) < 0) lo = mid + 1;
+        else hi = mid;
+    }
+
+    // Items are sorted best match first
+    for (size_t i = lo; i < table->count && strcmp(table->items[i].id.processor, device->processor) == 0; i++) {
+        if (liborkh_target_id_is_compatible(&table->items[i].id, device)) return table->items[i].entry;
+    }
+    return NULL;
+}
+
+liborkh_status_t liborkh_target_table_lookup(const liborkh_target_table_t* table, const char* device_id, liborkh_gpu_elf_entry_t** entry) {
+    LIBORKH_CHECK_ARGUMENTS(!table || !device_id || !entry);
+
+    liborkh_target_id_t device;
+    LIBORKH_CHECK_CALL(liborkh_target_id_parse(device_id, &device), "Invalid target ID: %s\n", device_id);
+
+    *entry = __lookup(table, &device);
+    return LIBORKH_SUCCESS;
+}
+
+liborkh_status_t liborkh_target_table_lookup_many(const liborkh_target_table_t* table, const char* const* device_ids, size_t num_devices, liborkh_gpu_elf_entry_t** entries) {
+    LIBORKH_CHECK_ARGUMENTS(!table || (num_devices > 0 && (!device_ids || !entries)));
+
+    for (size_t i = 0; i < num_devices; i++) {
+        LIBORKH_CHECK_CALL(liborkh_target_table_lookup(table, device_ids[i], &entries[i]), "Failed to look up device %zu\n", i);
+    }
+    return LIBORKH_SUCCESS;
+}
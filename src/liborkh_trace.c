@@ -0,0 +1,179 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/syscall.h>
+
+#include "liborkh_trace.h"
+#include "liborkh_stats.h"
+
+typedef struct __liborkh_trace_buffer {
+    struct __liborkh_trace_buffer* next;
+    pid_t tid;
+    size_t capacity;
+    uint64_t written; // total events recorded, ring position = written % capacity
+    liborkh_trace_event_t events[];
+} __liborkh_trace_buffer_t;
+
+int __liborkh_trace_enabled = 0;
+
+static pthread_mutex_t            __trace_lock = PTHREAD_MUTEX_INITIALIZER;
+static __liborkh_trace_buffer_t*  __trace_buffers = NULL;
+static char*                      __trace_filename = NULL;
+static __thread __liborkh_trace_buffer_t* __thread_buffer = NULL;
+
+static size_t __trace_capacity(void) {
+    const char* env = getenv(LIBORKH_TRACE_BUFFER_ENV);
+    long capacity = env ? strtol(env, NULL, 10) : 0;
+    return capacity > 0 ? (size_t) capacity : LIBORKH_TRACE_DEFAULT_EVENTS;
+}
+
+static __liborkh_trace_buffer_t* __get_thread_buffer(void) {
+    if (__thread_buffer) return __thread_buffer;
+
+    size_t capacity = __trace_capacity();
+    __liborkh_trace_buffer_t* buffer = malloc(sizeof(*buffer) + capacity * sizeof(liborkh_trace_event_t));
+    if (!buffer) return NULL;
+
+    buffer->tid      = (pid_t) syscall(SYS_gettid);
+    buffer->capacity = capacity;
+    buffer->written  = 0;
+
+    // Buffers outlive their thread so that they can be flushed at shutdown
+    pthread_mutex_lock(&__trace_lock);
+    buffer->next = __trace_buffers;
+    __trace_buffers = buffer;
+    pthread_mutex_unlock(&__trace_lock);
+
+    __thread_buffer = buffer;
+    return buffer;
+}
+
+void __liborkh_trace_record(const char* name, uint64_t start_ns, uint64_t size, int32_t codec, const char* arch) {
+    uint64_t end_ns = liborkh_now_ns();
+
+    __liborkh_trace_buffer_t* buffer = __get_thread_buffer();
+    if (!buffer) return;
+
+    liborkh_trace_event_t* event = &buffer->events[buffer->written % buffer->capacity];
+    event->name   = name;
+    event->ts_ns  = start_ns;
+    event->dur_ns = end_ns - start_ns;
+    event->size   = size;
+    event->codec  = codec;
+    if (arch) {
+        strncpy(event->arch, arch, LIBORKH_TRACE_ARCH_SIZE - 1);
+        event->arch[LIBORKH_TRACE_ARCH_SIZE - 1] = '\0';
+    } else {
+        event->arch[0] = '\0';
+    }
+
+    __atomic_store_n(&buffer->written, buffer->written + 1, __ATOMIC_RELEASE);
+}
+
+liborkh_status_t liborkh_trace_start(const char* filename) {
+    LIBORKH_CHECK_ARGUMENTS(!filename);
+
+    pthread_mutex_lock(&__trace_lock);
+    free(__trace_filename);
+    __trace_filename = strdup(filename);
+    pthread_mutex_unlock(&__trace_lock);
+    LIBORKH_CHECK_ALLOC(__trace_filename);
+
+    __atomic_store_n(&__liborkh_trace_enabled, 1, __ATOMIC_RELEASE);
+    return LIBORKH_SUCCESS;
+}
+
+// Quoted JSON string, target IDs come from the binary and may hold any byte (non-ASCII is escaped too)
+static void __write_json_string(FILE* f, const char* str) {
+    fputc('"', f);
+    for (const unsigned char* c = (const unsigned char*) str; *c; c++) {
+        if (*c == '"' || *c == '\\') {
+            fprintf(f, "\\%c", *c);
+        } else if (*c < 0x20 || *c >= 0x7f) {
+            fprintf(f, "\\u%04x", *c);
+        } else {
+            fputc(*c, f);
+        }
+    }
+    fputc('"', f);
+}
+
+static void __write_event(FILE* f, pid_t pid, pid_t tid, const liborkh_trace_event_t* event, bool first) {
+    fprintf(f, "%s\n{\"name\":", first ? "" : ",");
+    __write_json_string(f, event->name);
+    fprintf(f, ",\"cat\":\"liborkh\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":%d,\"tid\":%d,\"args\":{\"size\":%lu",
+            (double) event->ts_ns / 1e3, (double) event->dur_ns / 1e3,
+            (int) pid, (int) tid, (unsigned long) event->size);
+    if (event->codec >= 0) {
+        fprintf(f, ",\"codec\":\"%s\"", liborkh_compression_to_string((liborkh_ccob_compression_t) event->codec));
+    }
+    if (event->arch[0]) {
+        fprintf(f, ",\"arch\":");
+        __write_json_string(f, event->arch);
+    }
+    fprintf(f, "}}");
+}
+
+/**
+ * Disable tracing and write every buffered event to the trace file.
+ * Should be called once decoding threads are done recording.
+ */
+liborkh_status_t liborkh_trace_stop(void) {
+    __atomic_store_n(&__liborkh_trace_enabled, 0, __ATOMIC_RELEASE);
+
+    pthread_mutex_lock(&__trace_lock);
+
+    if (!__trace_filename) {
+        pthread_mutex_unlock(&__trace_lock);
+        return LIBORKH_SUCCESS;
+    }
+
+    FILE* f = fopen(__trace_filename, "w");
+    if (!f) {
+        liborkh_log_err("Failed to open trace file: %s\n", __trace_filename);
+        pthread_mutex_unlock(&__trace_lock);
+        return LIBORKH_ERROR_OPEN_FILE;
+    }
+
+    pid_t pid = getpid();
+    bool first = true;
+    size_t num_events = 0;
+
+    fprintf(f, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+    for (__liborkh_trace_buffer_t* buffer = __trace_buffers; buffer; buffer = buffer->next) {
+        uint64_t written = __atomic_load_n(&buffer->written, __ATOMIC_ACQUIRE);
+        uint64_t begin = written > buffer->capacity ? written - buffer->capacity : 0;
+
+        for (uint64_t i = begin; i < written; i++) {
+            __write_event(f, pid, buffer->tid, &buffer->events[i % buffer->capacity], first);
+            first = false;
+            num_events++;
+        }
+        buffer->written = 0;
+    }
+    fprintf(f, "\n]}\n");
+    fclose(f);
+
+    liborkh_log_info("Wrote trace to file: %s (%zu events)\n", __trace_filename, num_events);
+
+    free(__trace_filename);
+    __trace_filename = NULL;
+
+    pthread_mutex_unlock(&__trace_lock);
+    return LIBORKH_SUCCESS;
+}
+
+__attribute__((constructor))
+static void __liborkh_trace_init(void) {
+    const char* filename = getenv(LIBORKH_TRACE_ENV);
+    if (filename && filename[0]) {
+        liborkh_trace_start(filename);
+    }
+}
+
+__attribute__((destructor))
+static void __liborkh_trace_fini(void) {
+    liborkh_trace_stop();
+}
@@ -0,0 +1,187 @@
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+
+#include "liborkh_uncompress.h"
+#include "liborkh_budget.h"
+
+#define LIBORKH_UNCOMPRESS_STREAM_CHUNK 4096
+
+// Output buffers of the internal variants come from the memory budget, the public ones from liborkh_malloc()
+static uint8_t *__output_alloc(size_t size, bool budget) {
+    return (uint8_t*) (budget ? liborkh_budget_alloc(LIBORKH_ALLOC_STAGE_DECOMPRESS, size) : liborkh_malloc(LIBORKH_ALLOC_STAGE_DECOMPRESS, size));
+}
+
+static void __output_free(uint8_t *out, bool budget) {
+    if (budget) {
+        liborkh_budget_free(out);
+    } else {
+        liborkh_free(out);
+    }
+}
+
+static liborkh_status_t __uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, bool budget, uint8_t **out_buf, size_t *out_size) {
+    uint8_t *out = __output_alloc(uncompressed_size, budget);
+    if (!out) return LIBORKH_ERROR_OUT_OF_MEMORY;
+
+    uLongf dest_len = uncompressed_size;
+
+    int ret = uncompress(out, &dest_len, buf, compressed_size);
+
+    if (ret != Z_OK) {
+        __output_free(out, budget);
+        return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+    }
+
+    if (dest_len != uncompressed_size) {
+        liborkh_log_warn("Size mismatch after zlib decompress\n");
+    }
+
+    *out_buf = out;
+    *out_size = dest_len;
+    return LIBORKH_SUCCESS;
+}
+
+
+static liborkh_status_t __uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, bool budget, uint8_t **out_buf, size_t *out_size) {
+    // The size announced by the CCOB header must agree with the zstd frame before it is allocated
+    unsigned long long frame_size = ZSTD_getFrameContentSize(buf, compressed_size);
+    if (frame_size == ZSTD_CONTENTSIZE_ERROR
+            || (frame_size != ZSTD_CONTENTSIZE_UNKNOWN && frame_size != uncompressed_size)) {
+        liborkh_log_warn("zstd frame size does not match the bundle header (%zu bytes announced)\n", uncompressed_size);
+        return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+    }
+
+    uint8_t *out = __output_alloc(uncompressed_size, budget);
+    if (!out) return LIBORKH_ERROR_OUT_OF_MEMORY;
+
+    size_t ret = ZSTD_decompress(out, uncompressed_size, buf, compressed_size);
+
+    if (ZSTD_isError(ret)) {
+        liborkh_log_warn("ZSTD error: %s\n", ZSTD_getErrorName(ret));
+        __output_free(out, budget);
+        return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+    }
+
+    *out_buf = out;
+    *out_size = ret;
+    return LIBORKH_SUCCESS;
+}
+
+
+liborkh_status_t libokrh_uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
+    return __uncompress_zlib(buf, compressed_size, uncompressed_size, false, out_buf, out_size);
+}
+
+liborkh_status_t libokrh_uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
+    return __uncompress_zstd(buf, compressed_size, uncompressed_size, false, out_buf, out_size);
+}
+
+liborkh_status_t __liborkh_uncompress_zlib(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
+    return __uncompress_zlib(buf, compressed_size, uncompressed_size, true, out_buf, out_size);
+}
+
+liborkh_status_t __liborkh_uncompress_zstd(const uint8_t *buf, size_t compressed_size, size_t uncompressed_size, uint8_t **out_buf, size_t *out_size) {
+    return __uncompress_zstd(buf, compressed_size, uncompressed_size, true, out_buf, out_size);
+}
+
+
+liborkh_status_t liborkh_uncompress_stream_init(liborkh_uncompress_stream_t *stream, liborkh_ccob_compression_t codec, const uint8_t *buf, size_t compressed_size, size_t uncompressed_size) {
+    LIBORKH_CHECK_ARGUMENTS(!stream || !buf);
+
+    memset(stream, 0, sizeof(*stream));
+    stream->codec      = codec;
+    stream->in         = buf;
+    stream->in_size    = compressed_size;
+    stream->total_size = uncompressed_size;
+
+    if (codec == CCOB_COMPRESSION_ZLIB) {
+        stream->zs.next_in  = (Bytef *) buf;
+        stream->zs.avail_in = 0; // fed by liborkh_uncompress_stream_fill()
+        if (inflateInit(&stream->zs) != Z_OK) {
+            return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+        }
+    } else if (codec == CCOB_COMPRESSION_ZSTD) {
+        stream->zds = ZSTD_createDCtx();
+        LIBORKH_CHECK_ALLOC(stream->zds);
+    } else {
+        return LIBORKH_ERROR_INVALID_ARGUMENT;
+    }
+    return LIBORKH_SUCCESS;
+}
+
+/**
+ * Decompress until at least min_size bytes (bounded by the uncompressed size) are available.
+ */
+liborkh_status_t liborkh_uncompress_stream_fill(liborkh_uncompress_stream_t *stream, size_t min_size) {
+    LIBORKH_CHECK_ARGUMENTS(!stream);
+
+    if (min_size > stream->total_size) min_size = stream->total_size;
+
+    while (stream->out_size < min_size && !stream->finished) {
+        if (stream->out_size == stream->out_capacity) {
+            size_t new_capacity = stream->out_capacity ? stream->out_capacity * 2 : LIBORKH_UNCOMPRESS_STREAM_CHUNK;
+            if (new_capacity < min_size) new_capacity = min_size;
+            if (new_capacity > stream->total_size) new_capacity = stream->total_size;
+
+            uint8_t *tmp = liborkh_realloc(LIBORKH_ALLOC_STAGE_DECOMPRESS, stream->out, new_capacity);
+            LIBORKH_CHECK_ALLOC(tmp);
+            stream->out = tmp;
+            stream->out_capacity = new_capacity;
+        }
+
+        if (stream->codec == CCOB_COMPRESSION_ZLIB) {
+            // zlib counts in uInt, payloads and outputs over 4 GB are fed in chunks
+            if (stream->zs.avail_in == 0) {
+                size_t in_left = stream->in_size - stream->in_pos;
+                stream->zs.next_in  = (Bytef *) (stream->in + stream->in_pos);
+                stream->zs.avail_in = (uInt) (in_left < UINT_MAX ? in_left : UINT_MAX);
+                stream->in_pos += stream->zs.avail_in;
+            }
+            size_t out_left = stream->out_capacity - stream->out_size;
+            stream->zs.next_out  = stream->out + stream->out_size;
+            stream->zs.avail_out = (uInt) (out_left < UINT_MAX ? out_left : UINT_MAX);
+
+            uInt avail_in  = stream->zs.avail_in;
+            uInt avail_out = stream->zs.avail_out;
+            int ret = inflate(&stream->zs, Z_NO_FLUSH);
+            if (ret != Z_OK && ret != Z_STREAM_END && ret != Z_BUF_ERROR) {
+                liborkh_log_warn("zlib stream error: %d\n", ret);
+                return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+            }
+            bool progress = stream->zs.avail_in != avail_in || stream->zs.avail_out != avail_out;
+            stream->out_size += avail_out - stream->zs.avail_out;
+            stream->finished = ret == Z_STREAM_END || !progress;
+        } else {
+            ZSTD_inBuffer  input  = { stream->in, stream->in_size, stream->in_pos };
+            ZSTD_outBuffer output = { stream->out, stream->out_capacity, stream->out_size };
+
+            size_t ret = ZSTD_decompressStream(stream->zds, &output, &input);
+            if (ZSTD_isError(ret)) {
+                liborkh_log_warn("ZSTD stream error: %s\n", ZSTD_getErrorName(ret));
+                return LIBORKH_ERROR_DECOMPRESSION_FAILED;
+            }
+            bool progress = input.pos != stream->in_pos || output.pos != stream->out_size;
+            stream->in_pos   = input.pos;
+            stream->out_size = output.pos;
+            stream->finished = ret == 0 || !progress;
+        }
+    }
+
+    return stream->out_size >= min_size ? LIBORKH_SUCCESS : LIBORKH_ERROR_DECOMPRESSION_FAILED;
+}
+
+void liborkh_uncompress_stream_free(liborkh_uncompress_stream_t *stream) {
+    if (!stream) return;
+
+    if (stream->codec == CCOB_COMPRESSION_ZLIB) {
+        inflateEnd(&stream->zs);
+    } else if (stream->zds) {
+        ZSTD_freeDCtx(stream->zds);
+    }
+    liborkh_free(stream->out);
+    stream->out = NULL;
+    stream->zds = NULL;
+}
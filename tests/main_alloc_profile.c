@@ -0,0 +1,57 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "liborkh.h"
+
+/*
+ * Runs the extract_gpu_elf / print_total_nb_kernels pipeline with the
+ * allocation profiler reset around every API call and prints a per-stage
+ * breakdown of each call.
+ */
+
+#define PROFILE_CALL(label, call)                           \
+    do {                                                    \
+        liborkh_alloc_profile_reset();                      \
+        liborkh_status_t __s = (call);                      \
+        liborkh_alloc_profile_print(stdout, label, true);   \
+        if (__s != LIBORKH_SUCCESS) {                       \
+            liborkh_log_err("%s failed (%d)\n", label, __s);\
+            return 1;                                       \
+        }                                                   \
+    } while (0)
+
+
+int main(int argc, char **argv) {
+    if (argc < 2 || argc > 3) {
+        printf("Usage: %s <input ELF file> [target arch]\n", argv[0]);
+        return 1;
+    }
+
+    if (!liborkh_alloc_profile_enabled()) {
+        liborkh_log_warn("liborkh was built without -DLIBORKH_ALLOC_PROFILING=ON, no allocation will be reported\n");
+    }
+
+    char *elf_filename = argv[1];
+
+    liborkh_entry_filter_t filter = {0};
+    filter.target_arch = argc == 3 ? argv[2] : NULL;
+
+    Elf *elf = NULL;
+    PROFILE_CALL("liborkh_open_elf", liborkh_open_elf(elf_filename, &elf));
+
+    liborkh_offload_buffer fatbin_buf = {0};
+    PROFILE_CALL("liborkh_extract_gpu_fatbin", liborkh_extract_gpu_fatbin(elf, &fatbin_buf));
+    PROFILE_CALL("liborkh_close_elf", liborkh_close_elf(elf));
+
+    liborkh_gpu_elf_pool_t *pool = NULL;
+    PROFILE_CALL("liborkh_gpu_elf_pool_init", liborkh_gpu_elf_pool_init(&pool, 4));
+    PROFILE_CALL("liborkh_get_gpu_elfs", liborkh_get_gpu_elfs(&fatbin_buf, pool, &filter));
+
+    liborkh_alloc_free(fatbin_buf.buf);
+
+    size_t total_kernels = 0;
+    PROFILE_CALL("liborkh_get_number_kernels_in_pool", liborkh_get_number_kernels_in_pool(pool, &total_kernels));
+    PROFILE_CALL("liborkh_gpu_elf_pool_free", liborkh_gpu_elf_pool_free(pool));
+
+    liborkh_log_info("Total number of kernels across all GPU ELF entries: %zu\n", total_kernels);
+    return 0;
+}
@@ -0,0 +1,100 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "liborkh.h"
+
+
+// Rows a linear scan selects, in pool order
+static size_t scan_pool(const liborkh_gpu_elf_pool_t *pool, const liborkh_entry_filter_t *filter, size_t id, uint32_t *rows) {
+    size_t limit = filter->limit > 0 ? filter->limit : SIZE_MAX;
+    size_t num_rows = 0;
+    for (size_t i = 0; i < pool->count && num_rows < limit; i++) {
+        const liborkh_gpu_elf_entry_t *entry = pool->entries[i];
+        if (!liborkh_is_entry_matching_filter(entry, filter)) continue;
+        if (id != LIBORKH_POOL_INDEX_ANY_ID && entry->id != id) continue;
+        rows[num_rows++] = (uint32_t) i;
+    }
+    return num_rows;
+}
+
+static int check_query(const liborkh_pool_index_t *index, const liborkh_entry_filter_t *filter, size_t id, uint32_t *expected, uint32_t *rows, uint64_t *bitmap) {
+    const liborkh_gpu_elf_pool_t *pool = index->pool;
+    size_t num_expected = scan_pool(pool, filter, id, expected);
+
+    size_t num_rows = 0;
+    if (liborkh_pool_index_query(index, filter, id, rows, &num_rows) != 0) return 1;
+    if (num_rows != num_expected || memcmp(rows, expected, num_rows * sizeof(uint32_t)) != 0) {
+        printf("Mismatch: arch %s, triple %s, ofk %d, img %d, id %zd, limit %zu: %zu rows, expected %zu\n",
+               filter->target_arch ? filter->target_arch : "*", filter->target_triple ? filter->target_triple : "*",
+               filter->ofk, filter->img, id == LIBORKH_POOL_INDEX_ANY_ID ? (ssize_t) -1 : (ssize_t) id,
+               filter->limit, num_rows, num_expected);
+        return 1;
+    }
+
+    if (liborkh_pool_index_query_bitmap(index, filter, id, bitmap) != 0) return 1;
+    size_t num_bits = 0;
+    for (size_t i = 0; i < pool->count; i++) {
+        bool set = (bitmap[i / 64] >> (i % 64)) & 1;
+        if (set && (num_bits >= num_expected || expected[num_bits++] != i)) return 1;
+    }
+    return num_bits != num_expected;
+}
+
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        printf("Usage: %s <input ELF file>\n", argv[0]);
+        return 1;
+    }
+
+    liborkh_binary_t *binary = NULL;
+    if (liborkh_binary_open(argv[1], NULL, &binary) != 0) {
+        return 1;
+    }
+
+    const liborkh_gpu_elf_pool_t *pool = binary->pool;
+    liborkh_pool_index_t *index = NULL;
+    if (liborkh_pool_index_build(pool, &index) != 0) {
+        liborkh_binary_close(binary);
+        return 1;
+    }
+
+    size_t count = pool->count > 0 ? pool->count : 1;
+    uint32_t *expected = malloc(count * sizeof(uint32_t));
+    uint32_t *rows = malloc(count * sizeof(uint32_t));
+    uint64_t *bitmap = malloc((count + 63) / 64 * sizeof(uint64_t));
+
+    // Every predicate alone and combined, taken from each entry, with and without id and limit
+    int ret = !expected || !rows || !bitmap;
+    size_t num_queries = 0;
+    for (size_t i = 0; i <= pool->count && ret == 0; i++) {
+        const liborkh_gpu_elf_entry_t *entry = i < pool->count ? pool->entries[i] : NULL;
+        liborkh_entry_filter_t filters[6] = {{0}};
+        filters[1].target_arch   = entry ? entry->target_arch : "gfx000";
+        filters[2].target_triple = entry ? entry->target_triple : "none-none-none";
+        filters[3].ofk = entry ? entry->ofk : OFK_None;
+        filters[4].img = entry ? entry->img : IMG_None;
+        filters[5] = (liborkh_entry_filter_t) { .target_arch = filters[1].target_arch, .target_triple = filters[2].target_triple,
+                                                .ofk = filters[3].ofk, .img = filters[4].img };
+
+        for (size_t f = 0; f < 6 && ret == 0; f++) {
+            for (size_t limit = 0; limit <= 1 && ret == 0; limit++) {
+                filters[f].limit = limit;
+                ret = check_query(index, &filters[f], LIBORKH_POOL_INDEX_ANY_ID, expected, rows, bitmap);
+                if (ret == 0) ret = check_query(index, &filters[f], entry ? entry->id : pool->count, expected, rows, bitmap);
+                num_queries += 2;
+            }
+        }
+    }
+
+    if (ret == 0) {
+        printf("%zu queries on %zu entries match the pool scan\n", num_queries, pool->count);
+    }
+
+    free(expected);
+    free(rows);
+    free(bitmap);
+    liborkh_pool_index_free(index);
+    liborkh_binary_close(binary);
+    return ret;
+}
@@ -0,0 +1,34 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "liborkh.h"
+
+
+// Exit status follows diff(1): 0 when the device code is identical, 1 when it differs, 2 on error
+int main(int argc, char **argv) {
+    if (argc != 3) {
+        printf("Usage: %s <old ELF file> <new ELF file>\n", argv[0]);
+        return 2;
+    }
+
+    liborkh_diff_t *diff = NULL;
+    if (liborkh_diff_files(argv[1], argv[2], NULL, &diff) != 0) {
+        return 2;
+    }
+
+    for (size_t i = 0; i < diff->count; i++) {
+        const liborkh_diff_record_t *record = &diff->records[i];
+        printf("%s%s\t%s\t%s\t%s\t%s\n",
+               record->kernel ? "  " : "",
+               liborkh_diff_kind_to_string(record->kind),
+               liborkh_offload_kind_to_string(record->ofk),
+               record->target_triple ? record->target_triple : "-",
+               record->target_arch ? record->target_arch : "-",
+               record->kernel ? record->kernel : "");
+    }
+    printf("%zu differences, %zu code objects and %zu kernels unchanged\n",
+           diff->count, diff->num_unchanged_entries, diff->num_unchanged_kernels);
+
+    int ret = diff->count > 0;
+    liborkh_diff_free(diff);
+    return ret;
+}
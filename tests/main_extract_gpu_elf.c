@@ -1,18 +1,39 @@
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <limits.h>
 #include <libgen.h> 
 #include "liborkh.h"
 
-int main(int argc, char **argv) {
-    if (argc != 2) {
-        printf("Usage: %s <input ELF file>\n", argv[0]);
+// Static archives are scanned member by member, in parallel
+int get_gpu_elfs_from_archive(const char *filename, liborkh_gpu_elf_pool_t *pool) {
+    liborkh_archive_t *archive = NULL;
+    if (liborkh_archive_open(filename, &archive) != 0) {
         return 1;
     }
 
-    char *elf_filename = argv[1];
+    liborkh_log_info("Found %zu archive members\n", archive->count);
+
+    int ret = liborkh_get_gpu_elfs_from_archive(archive, pool, NULL, 0) != 0;
+    liborkh_archive_close(archive);
+    return ret;
+}
 
+// Offload sections are read from the memory of the running process
+int get_gpu_elfs_from_process(pid_t pid, liborkh_gpu_elf_pool_t *pool) {
+    liborkh_process_t *process = NULL;
+    if (liborkh_process_open(pid, &process) != 0) {
+        return 1;
+    }
+
+    int ret = liborkh_process_get_gpu_elfs(process, pool, NULL) != 0;
+    liborkh_process_close(process);
+    return ret;
+}
+
+int get_gpu_elfs_from_elf(const char *filename, liborkh_gpu_elf_pool_t *pool) {
     Elf *elf = NULL;
-    if (liborkh_open_elf(elf_filename, &elf) != 0) {
+    if (liborkh_open_elf(filename, &elf) != 0) {
         return 1;
     }
 
@@ -22,27 +43,133 @@ int main(int argc, char **argv) {
         return 1;
     }
 
-    char *elf_basename = basename(elf_filename);
-
     liborkh_close_elf(elf);
 
+    int ret = liborkh_get_gpu_elfs(&fatbin_buf, pool, NULL) != 0;
+
+    liborkh_alloc_free(fatbin_buf.buf); // free fatbin buffer
+    return ret;
+}
+
+// Only the requested bundle is decoded, the others are located by the bundle index
+int extract_bundle_entry(const char *filename, size_t bundle_id, const char *arch) {
+    liborkh_binary_t *binary = NULL;
+    if (liborkh_binary_open_indexed(filename, &binary) != 0) {
+        return 1;
+    }
+
+    const liborkh_gpu_elf_entry_t *entry = NULL;
+    int ret = liborkh_binary_get_bundle_entry(binary, bundle_id, arch, &entry) != 0;
+    if (ret == 0 && !entry) {
+        liborkh_log_err("No entry for bundle %zu%s%s\n", bundle_id, arch ? " and " : "", arch ? arch : "");
+        ret = 1;
+    }
+    if (ret == 0) {
+        ret = liborkh_write_elf_to_file(entry, basename((char *) filename)) != 0;
+    }
+
+    liborkh_binary_close(binary);
+    return ret;
+}
+
+int main(int argc, char **argv) {
+    bool dedupe = false;
+    bool shm_cache = false;
+    pid_t pid = 0;
+    char *elf_filename = NULL;
+    char *snapshot_filename = NULL;
+    char *arch = NULL;
+    long bundle_id = -1;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--dedupe") == 0) {
+            dedupe = true;
+        } else if (strcmp(argv[i], "--shm-cache") == 0) {
+            shm_cache = true;
+        } else if (strcmp(argv[i], "--snapshot") == 0 && i + 1 < argc) {
+            snapshot_filename = argv[++i];
+        } else if (strcmp(argv[i], "--bundle") == 0 && i + 1 < argc) {
+            bundle_id = atol(argv[++i]);
+        } else if (strcmp(argv[i], "--arch") == 0 && i + 1 < argc) {
+            arch = argv[++i];
+        } else if (strcmp(argv[i], "--pid") == 0 && i + 1 < argc) {
+            char *end = NULL;
+            long value = strtol(argv[++i], &end, 10);
+            if (*argv[i] == '\0' || *end != '\0' || value <= 0 || value > INT_MAX) {
+                liborkh_log_err("Invalid pid: %s\n", argv[i]);
+                return 1;
+            }
+            pid = (pid_t) value;
+            elf_filename = argv[i];
+        } else {
+            elf_filename = argv[i];
+        }
+    }
+
+    if (!elf_filename) {
+        printf("Usage: %s [--dedupe] [--shm-cache] [--snapshot <output file>] [--bundle <id> [--arch <arch>]] <input ELF file, static archive or snapshot | --pid <pid>>\n", argv[0]);
+        return 1;
+    }
+
+    if (bundle_id >= 0 && pid == 0) {
+        return extract_bundle_entry(elf_filename, (size_t) bundle_id, arch);
+    }
+
     liborkh_gpu_elf_pool_t *pool = NULL;
     if (liborkh_gpu_elf_pool_init(&pool, 4) != 0) {
-        free(fatbin_buf.buf);
         return 1;
     }
 
-    if (liborkh_get_gpu_elfs(&fatbin_buf, pool, NULL) != 0) {
-        free(fatbin_buf.buf);
+    // Snapshot entries borrow their images from the mapping, which stays open until the end
+    liborkh_snapshot_t *snapshot = NULL;
+
+    int ret = 0;
+    if (pid > 0) {
+        ret = get_gpu_elfs_from_process(pid, pool);
+    } else if (liborkh_is_snapshot_file(elf_filename)) {
+        ret = liborkh_snapshot_open(elf_filename, &snapshot) != 0;
+        if (ret == 0) {
+            liborkh_gpu_elf_pool_free(pool);
+            pool = snapshot->pool;
+        }
+    } else if (liborkh_is_archive_file(elf_filename)) {
+        ret = get_gpu_elfs_from_archive(elf_filename, pool);
+    } else if (shm_cache) {
+        ret = liborkh_shm_cache_open(elf_filename, &snapshot, NULL) != 0;
+        if (ret == 0) {
+            liborkh_gpu_elf_pool_free(pool);
+            pool = snapshot->pool;
+        }
+    } else {
+        ret = get_gpu_elfs_from_elf(elf_filename, pool);
+    }
+    if (ret != 0) {
+        liborkh_gpu_elf_pool_free(pool);
         return 1;
     }
 
-    free(fatbin_buf.buf); // free fatbin buffer
+    char *elf_basename = basename(elf_filename);
 
     liborkh_log_info("Found %zu GPU ELF entries\n", pool->count);
 
-    liborkh_gpu_elf_pool_iterate(pool, (liborkh_gpu_elf_pool_iterate_cb_t) liborkh_write_elf_to_file, elf_basename);
+    if (dedupe) {
+        // Identical code objects are written once and hard linked
+        size_t num_shared = 0;
+        ret = liborkh_gpu_elf_pool_dedupe(pool, &num_shared) != 0;
+        if (ret == 0) liborkh_log_info("Found %zu duplicated GPU ELF entries\n", num_shared);
+    }
+
+    if (ret == 0 && snapshot_filename) {
+        ret = liborkh_write_pool_to_snapshot(pool, snapshot_filename) != 0;
+    } else if (ret == 0 && dedupe) {
+        ret = liborkh_write_pool_to_files(pool, elf_basename, NULL) != 0;
+    } else if (ret == 0) {
+        ret = liborkh_gpu_elf_pool_iterate(pool, (liborkh_gpu_elf_pool_iterate_cb_t) liborkh_write_elf_to_file, elf_basename) != 0;
+    }
 
-    liborkh_gpu_elf_pool_free(pool);
-    return 0;
+    if (snapshot) {
+        liborkh_snapshot_close(snapshot);
+    } else {
+        liborkh_gpu_elf_pool_free(pool);
+    }
+    return ret;
 }
@@ -0,0 +1,99 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "liborkh.h"
+
+
+liborkh_visit_action_t print_entry(liborkh_gpu_elf_entry_t *entry, void *user_data) {
+    const char *elf_filename = (const char *) user_data;
+
+    printf("%s\t%zu\t%s\t%s\t%s\t%s\t%zu\t0x%zx\t0x%zx%s\n",
+           elf_filename, entry->id,
+           liborkh_image_kind_to_string(entry->img),
+           liborkh_offload_kind_to_string(entry->ofk),
+           entry->target_triple ? entry->target_triple : "-",
+           entry->target_arch ? entry->target_arch : "-",
+           entry->elf_size, entry->bundle_offset, entry->image_offset,
+           (entry->flags & LIBORKH_ENTRY_COMPRESSED) ? "\tcompressed" : "");
+    return LIBORKH_VISIT_SKIP;
+}
+
+
+// Print the code object selected for each device, from the bundle IDs only
+int print_selection(const char *elf_filename, liborkh_offload_buffer *fatbin_buf, const char **devices, size_t num_devices) {
+    liborkh_gpu_elf_pool_t *pool = NULL;
+    if (liborkh_gpu_elf_pool_init(&pool, 4) != 0) {
+        return 1;
+    }
+
+    liborkh_target_table_t *table = NULL;
+    int ret = liborkh_get_gpu_elf_inventory(fatbin_buf, pool, NULL) != 0
+           || liborkh_target_table_build(pool, NULL, &table) != 0;
+
+    for (size_t i = 0; ret == 0 && i < num_devices; i++) {
+        liborkh_gpu_elf_entry_t *entry = NULL;
+        if (liborkh_target_table_lookup(table, devices[i], &entry) != 0) {
+            ret = 1;
+        } else if (entry) {
+            printf("%s\t%s\t%zu\t%s\t%s\n", elf_filename, devices[i], entry->id,
+                   entry->target_triple ? entry->target_triple : "-", entry->target_arch);
+        } else {
+            printf("%s\t%s\tno compatible code object\n", elf_filename, devices[i]);
+        }
+    }
+
+    if (table) liborkh_target_table_free(table);
+    liborkh_gpu_elf_pool_free(pool);
+    return ret;
+}
+
+
+int main(int argc, char **argv) {
+    const char **devices = calloc(argc, sizeof(char *));
+    size_t num_devices = 0;
+    int first_file = argc;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--device") == 0 && i + 1 < argc) {
+            devices[num_devices++] = argv[++i];
+        } else if (first_file == argc) {
+            first_file = i;
+        }
+    }
+
+    if (first_file == argc) {
+        printf("Usage: %s [--device <target ID>]... <input ELF file>...\n", argv[0]);
+        free(devices);
+        return 1;
+    }
+
+    int ret = 0;
+    for (int i = first_file; i < argc; i++) {
+        if (strcmp(argv[i], "--device") == 0) {
+            i++;
+            continue;
+        }
+
+        Elf *elf = NULL;
+        if (liborkh_open_elf(argv[i], &elf) != 0) {
+            ret = 1;
+            continue;
+        }
+
+        liborkh_offload_buffer fatbin_buf = {0};
+        liborkh_status_t status = liborkh_extract_gpu_fatbin(elf, &fatbin_buf);
+        liborkh_close_elf(elf);
+        if (status != 0) {
+            ret = 1;
+            continue;
+        }
+
+        if (num_devices > 0) {
+            ret |= print_selection(argv[i], &fatbin_buf, devices, num_devices);
+        } else if (liborkh_visit_gpu_elf_inventory(&fatbin_buf, NULL, print_entry, argv[i]) != 0) {
+            ret = 1;
+        }
+        liborkh_alloc_free(fatbin_buf.buf);
+    }
+    free(devices);
+    return ret;
+}
@@ -0,0 +1,67 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "liborkh.h"
+
+#define TOP_K 5
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <input ELF file>...\n", argv[0]);
+        return 1;
+    }
+
+    liborkh_catalog_t *catalog = NULL;
+    if (liborkh_catalog_init(&catalog) != 0) {
+        return 1;
+    }
+
+    for (int i = 1; i < argc; i++) {
+        if (liborkh_catalog_add_file(catalog, argv[i], NULL) != 0) {
+            liborkh_catalog_free(catalog);
+            return 1;
+        }
+    }
+    printf("%zu kernels\n", catalog->count);
+
+    // Kernels with the highest VGPR use per architecture
+    uint8_t *mask = NULL;
+    size_t rows[TOP_K];
+    size_t num_rows = 0;
+    const liborkh_catalog_dictionary_t *archs = &catalog->dicts[LIBORKH_CATALOG_ARCH];
+    for (size_t a = 0; a < archs->count; a++) {
+        if (liborkh_catalog_mask_init(catalog, &mask) != 0) break;
+        liborkh_catalog_filter_string(catalog, LIBORKH_CATALOG_ARCH, archs->values[a], mask);
+        liborkh_catalog_top_k(catalog, LIBORKH_CATALOG_VGPR, mask, TOP_K, rows, &num_rows);
+        liborkh_alloc_free(mask);
+
+        printf("%s: top %zu VGPR\n", archs->values[a], num_rows);
+        for (size_t r = 0; r < num_rows; r++) {
+            printf("  %u\t%s\n", catalog->columns[LIBORKH_CATALOG_VGPR][rows[r]], liborkh_catalog_get_name(catalog, rows[r]));
+        }
+    }
+
+    // Total LDS per source file
+    const liborkh_catalog_dictionary_t *sources = &catalog->dicts[LIBORKH_CATALOG_SOURCE];
+    liborkh_catalog_group_t *groups = calloc(sources->count + 1, sizeof(liborkh_catalog_group_t));
+    if (groups && liborkh_catalog_group_by(catalog, LIBORKH_CATALOG_SOURCE, LIBORKH_CATALOG_LDS, NULL, groups) == 0) {
+        printf("LDS per source\n");
+        for (size_t s = 0; s < sources->count; s++) {
+            printf("  %s\t%zu kernels\t%lu bytes total\t%u bytes max\n", sources->values[s], groups[s].count, (unsigned long) groups[s].sum, groups[s].max);
+        }
+    }
+    free(groups);
+
+    // Kernel argument size distribution
+    uint64_t buckets[LIBORKH_CATALOG_HISTOGRAM_SIZE];
+    if (liborkh_catalog_histogram(catalog, LIBORKH_CATALOG_KERNARG, NULL, buckets) == 0) {
+        printf("Kernarg size distribution\n");
+        for (int b = 0; b < LIBORKH_CATALOG_HISTOGRAM_SIZE; b++) {
+            if (!buckets[b]) continue;
+            printf("  [%lu, %lu)\t%lu\n", b ? 1UL << (b - 1) : 0UL, b ? (1UL << b) : 1UL, (unsigned long) buckets[b]);
+        }
+    }
+
+    liborkh_catalog_free(catalog);
+    return 0;
+}
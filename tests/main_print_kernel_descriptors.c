@@ -0,0 +1,41 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "liborkh.h"
+
+
+int main(int argc, char **argv) {
+    if (argc != 2) {
+        printf("Usage: %s <input ELF file>\n", argv[0]);
+        return 1;
+    }
+
+    liborkh_binary_t *binary = NULL;
+    if (liborkh_binary_open(argv[1], NULL, &binary) != 0) {
+        return 1;
+    }
+
+    liborkh_kernel_descriptors_t *kds = NULL;
+    if (liborkh_kernel_descriptors_init(&kds) != 0) {
+        liborkh_binary_close(binary);
+        return 1;
+    }
+
+    int ret = 0;
+    printf("id\tarch\tkernel\tvgpr\tsgpr\taccum\tlds\tscratch\tkernarg\twave\n");
+    for (size_t i = 0; i < binary->pool->count && ret == 0; i++) {
+        const liborkh_gpu_elf_entry_t *entry = binary->pool->entries[i];
+        size_t first = kds->count;
+        ret = liborkh_kernel_descriptors_add_entry(kds, entry) != 0;
+
+        for (size_t k = first; k < kds->count; k++) {
+            const liborkh_kernel_descriptor_t *kd = &kds->kernels[k];
+            printf("%zu\t%s\t%s\t%u\t%u\t%u\t%u\t%u\t%u\t%u\n", entry->id, entry->target_arch ? entry->target_arch : "",
+                   liborkh_kernel_descriptors_get_name(kds, k), kd->vgpr_count, kd->sgpr_count, kd->accum_offset,
+                   kd->group_segment_fixed_size, kd->private_segment_fixed_size, kd->kernarg_size, kd->wavefront_size);
+        }
+    }
+
+    liborkh_kernel_descriptors_free(kds);
+    liborkh_binary_close(binary);
+    return ret;
+}
@@ -24,8 +24,8 @@ liborkh_status_t print_nb_kernels_in_entry(liborkh_gpu_elf_entry_t *entry, void
     liborkh_log_info("Number of kernels in entry %s: %u\n", gpu_elf_name, num_kernels);
     
     liborkh_close_elf(gpu_elf);
-    free(metadata);
-    free(gpu_elf_name);
+    liborkh_alloc_free(metadata);
+    liborkh_alloc_free(gpu_elf_name);
 
     return LIBORKH_SUCCESS;
 }
@@ -56,18 +56,18 @@ int main(int argc, char **argv) {
 
     liborkh_gpu_elf_pool_t *pool = NULL;
     if (liborkh_gpu_elf_pool_init(&pool, 4) != 0) {
-        free(fatbin_buf.buf);
+        liborkh_alloc_free(fatbin_buf.buf);
         return 1;
     }
 
     liborkh_entry_filter_t filter = {0};
     filter.id_mode = FILTER_ID_MODE_ONE_BY_ID;
     if (liborkh_get_gpu_elfs(&fatbin_buf, pool, &filter) != 0) {
-        free(fatbin_buf.buf);
+        liborkh_alloc_free(fatbin_buf.buf);
         return 1;
     }
 
-    free(fatbin_buf.buf); // free fatbin buffer
+    liborkh_alloc_free(fatbin_buf.buf); // free fatbin buffer
 
     liborkh_log_info("Found %zu GPU ELF entries\n", pool->count);
 
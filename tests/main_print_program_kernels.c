@@ -0,0 +1,47 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include "liborkh.h"
+
+
+int main(int argc, char **argv) {
+    if (argc < 2) {
+        printf("Usage: %s <executable> [num_threads]\n", argv[0]);
+        return 1;
+    }
+    size_t num_threads = argc > 2 ? strtoul(argv[2], NULL, 10) : 0;
+
+    liborkh_program_t *program = NULL;
+    if (liborkh_program_open(argv[1], &program) != 0) {
+        return 1;
+    }
+
+    if (liborkh_program_scan(program, NULL, num_threads) != 0) {
+        liborkh_program_close(program);
+        return 1;
+    }
+
+    size_t num_libraries = 0;
+    for (size_t i = 0; i < program->count; i++) {
+        const liborkh_program_library_t *library = &program->libraries[i];
+        if (!library->path) {
+            printf("%s\tnot found\n", library->name);
+            continue;
+        }
+        if (library->num_entries == 0) continue;
+
+        printf("%s\t%zu entries\t%zu kernels\n", library->path, library->num_entries, library->num_kernels);
+        for (size_t j = 0; j < library->num_entries; j++) {
+            const liborkh_gpu_elf_entry_t *entry = program->pool->entries[library->first_entry + j];
+            printf("  %zu\t%s\t%s\t%zu\n", entry->id,
+                   entry->target_triple ? entry->target_triple : "-",
+                   entry->target_arch ? entry->target_arch : "-",
+                   entry->elf_size);
+        }
+        num_libraries++;
+    }
+    printf("Total: %zu kernels in %zu entries (%zu of %zu objects with device code)\n",
+           program->num_kernels, program->pool->count, num_libraries, program->count);
+
+    liborkh_program_close(program);
+    return 0;
+}
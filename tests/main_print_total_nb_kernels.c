@@ -3,6 +3,29 @@
 #include "liborkh.h"
 
 
+typedef struct {
+    size_t num_entries;
+    size_t total_kernels;
+    liborkh_status_t status;
+} count_ctx_t;
+
+
+// Count kernels on the borrowed image while decoding, nothing is kept in memory
+liborkh_visit_action_t count_kernels_in_entry(liborkh_gpu_elf_entry_t *entry, void *user_data) {
+    count_ctx_t *ctx = (count_ctx_t *) user_data;
+
+    size_t num_kernels = 0;
+    ctx->status = liborkh_get_number_kernels_in_entry(entry, &num_kernels);
+    if (ctx->status != LIBORKH_SUCCESS) {
+        return LIBORKH_VISIT_STOP;
+    }
+
+    ctx->num_entries++;
+    ctx->total_kernels += num_kernels;
+    return LIBORKH_VISIT_SKIP;
+}
+
+
 int main(int argc, char **argv) {
     if (argc != 2) {
         printf("Usage: %s <input ELF file>\n", argv[0]);
@@ -24,29 +47,18 @@ int main(int argc, char **argv) {
 
     liborkh_close_elf(elf);
 
-    liborkh_gpu_elf_pool_t *pool = NULL;
-    if (liborkh_gpu_elf_pool_init(&pool, 4) != 0) {
-        free(fatbin_buf.buf);
-        return 1;
-    }
-
     liborkh_entry_filter_t filter = {0};
     filter.id_mode = FILTER_ID_MODE_ONE_BY_ID;
-    if (liborkh_get_gpu_elfs(&fatbin_buf, pool, &filter) != 0) {
-        free(fatbin_buf.buf);
-        return 1;
-    }
 
-    free(fatbin_buf.buf); // free fatbin buffer
-
-    liborkh_log_info("Found %zu GPU ELF entries\n", pool->count);
-
-    size_t total_kernels = 0;
-    if (liborkh_get_number_kernels_in_pool(pool, &total_kernels) != 0) {
+    count_ctx_t ctx = {0};
+    if (liborkh_visit_gpu_elfs(&fatbin_buf, &filter, count_kernels_in_entry, &ctx) != 0 || ctx.status != LIBORKH_SUCCESS) {
+        liborkh_alloc_free(fatbin_buf.buf);
         return 1;
     }
-    liborkh_log_info("Total number of kernels across all GPU ELF entries: %zu\n", total_kernels);
 
-    liborkh_gpu_elf_pool_free(pool);
+    liborkh_alloc_free(fatbin_buf.buf); // free fatbin buffer
+
+    liborkh_log_info("Found %zu GPU ELF entries\n", ctx.num_entries);
+    liborkh_log_info("Total number of kernels across all GPU ELF entries: %zu\n", ctx.total_kernels);
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,36 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "liborkh.h"
+
+
+int main(int argc, char **argv) {
+    liborkh_entry_filter_t filter = {0};
+    char *input = NULL;
+    char *output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--arch") == 0 && i + 1 < argc) {
+            filter.target_arch = argv[++i];
+        } else if (strcmp(argv[i], "--triple") == 0 && i + 1 < argc) {
+            filter.target_triple = argv[++i];
+        } else if (!input) {
+            input = argv[i];
+        } else {
+            output = argv[i];
+        }
+    }
+
+    if (!input || !output || (!filter.target_arch && !filter.target_triple)) {
+        printf("Usage: %s --arch <arch> [--triple <triple>] <input ELF file> <output ELF file>\n", argv[0]);
+        return 1;
+    }
+
+    liborkh_strip_result_t result;
+    if (liborkh_strip_gpu_elfs(input, output, &filter, &result) != 0) {
+        return 1;
+    }
+
+    printf("Kept %zu and removed %zu code objects, offload section %zu -> %zu bytes\n",
+           result.num_kept, result.num_removed, result.old_size, result.new_size);
+    return 0;
+}
@@ -0,0 +1,50 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "liborkh.h"
+
+
+int main(int argc, char **argv) {
+    liborkh_ccob_options_t options = { .codec = CCOB_COMPRESSION_ZSTD, .version = 3 };
+    char *input = NULL;
+    char *output = NULL;
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--codec") == 0 && i + 1 < argc) {
+            i++;
+            if (strcmp(argv[i], "zlib") == 0) {
+                options.codec = CCOB_COMPRESSION_ZLIB;
+            } else if (strcmp(argv[i], "zstd") == 0) {
+                options.codec = CCOB_COMPRESSION_ZSTD;
+            } else {
+                fprintf(stderr, "Unknown codec: %s\n", argv[i]);
+                return 1;
+            }
+        } else if (strcmp(argv[i], "--level") == 0 && i + 1 < argc) {
+            options.level = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--ccob-version") == 0 && i + 1 < argc) {
+            options.version = (uint16_t) atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.num_threads = atoi(argv[++i]);
+        } else if (strcmp(argv[i], "--long") == 0) {
+            options.long_distance = true;
+        } else if (!input) {
+            input = argv[i];
+        } else {
+            output = argv[i];
+        }
+    }
+
+    if (!input || !output) {
+        printf("Usage: %s [--codec zstd|zlib] [--level <level>] [--ccob-version 2|3] [--threads <n>] [--long] <input ELF file> <output ELF file>\n", argv[0]);
+        return 1;
+    }
+
+    liborkh_transcode_result_t result;
+    if (liborkh_transcode_gpu_elfs(input, output, &options, &result) != 0) {
+        return 1;
+    }
+
+    printf("Transcoded %zu and kept %zu compressed bundles, %zu -> %zu bytes\n",
+           result.num_transcoded, result.num_kept, result.old_bytes, result.new_bytes);
+    return 0;
+}
@@ -25,3 +25,19 @@ for name, entry in pairs(results) do
 end
 
 print("All metadata processed and freed")
+
+local catalog = liborkh.get_kernel_catalog(elf_file)
+for i = 1, catalog.count do
+    print(string.format("  %-24s %-8s vgpr=%d sgpr=%d lds=%d kernarg=%d", catalog.name[i], catalog.arch[i], catalog.vgpr[i], catalog.sgpr[i], catalog.lds[i], catalog.kernarg[i]))
+end
+
+local stats = liborkh.get_stats()
+for stage, counter in pairs(stats) do
+    if counter.count then
+        print(string.format("  %-18s count=%d bytes=%d ns=%d", stage, counter.count, counter.bytes, counter.ns))
+    end
+end
+for codec, counter in pairs(stats.decompress) do
+    print(string.format("  decompress %-7s count=%d bytes=%d in_bytes=%d ns=%d", codec, counter.count, counter.bytes, counter.in_bytes, counter.ns))
+end
+liborkh.reset_stats()